@@ -0,0 +1,355 @@
+#ifndef SI7021_HPP_
+#define SI7021_HPP_
+
+/*
+*  Header-only C++17 front-end of the Si7021 driver. The bus, the I2C address, the resolution
+*  and the checksum policy are template parameters, so command bytes, conversion times and
+*  register values are constants and the features not used are not compiled in. The types of
+*  the C driver (messages, samples, buses) are shared, the C driver itself is not needed.
+*
+*  A bus policy is a copyable class with the members
+*      int8_t   transfer(uint16_t addr, Si7021_msg_t* msgs, uint8_t count);
+*      uint32_t now_ms();
+*  that work like the transfer and now_ms functions of Si7021_bus_t, and optionally
+*      uint32_t now_us();
+*  for the conversion times of the samples. si7021::CBus adapts a
+*  Si7021_bus_t of the C ports, e.g.
+*
+*      si7021::Sensor<si7021::CBus, si7021::Resolution::H11_T11> sensor{{&bus1}};
+*/
+
+#include <type_traits>
+#include <utility>
+
+extern "C"
+{
+#include "Si7021_driver.h"
+}
+
+namespace si7021
+{
+
+enum class Resolution : uint8_t
+{
+  H12_T14 = ::H12_T14,
+  H8_T12  = ::H8_T12,
+  H10_T13 = ::H10_T13,
+  H11_T11 = ::H11_T11
+};
+
+enum class Checksum : uint8_t
+{
+  Ignore,                              // measurement codes are read without checksum
+  Verify                               // the checksum of Hold Master measurements is read
+};
+
+enum class Register : uint8_t
+{
+  User_Register_1,
+  Heater_Control_Register
+};
+
+/* bus policy over a Si7021_bus_t, the multiplexer channel is not selected */
+struct CBus
+{
+  Si7021_bus_t* bus;
+
+  int8_t transfer(uint16_t addr, Si7021_msg_t* msgs, uint8_t count)
+  {
+    int8_t rv;
+
+    if(bus->lock != nullptr)
+      bus->lock(bus->mutex);
+
+    rv = bus->transfer(bus->ctx, addr, msgs, count);
+
+    if(bus->unlock != nullptr)
+      bus->unlock(bus->mutex);
+
+    return rv;
+  }
+
+  uint32_t now_ms()
+  {
+    return (bus->now_ms != nullptr) ? bus->now_ms() : 0;
+  }
+
+  uint32_t now_us()
+  {
+    return (bus->now_us != nullptr) ? bus->now_us() : now_ms() * 1000;
+  }
+};
+
+/* the optional now_us member of a bus policy */
+template <typename Bus, typename = void>
+struct has_now_us : std::false_type {};
+
+template <typename Bus>
+struct has_now_us<Bus, std::void_t<decltype(std::declval<Bus&>().now_us())>> : std::true_type {};
+
+template <typename Bus, Resolution Res = Resolution::H12_T14,
+          Checksum Check = Checksum::Ignore, uint16_t Address = 0x40>
+class Sensor
+{
+  static constexpr uint8_t RES_INDEX = ((static_cast<uint8_t>(Res) >> (RES1 - 1)) & 0x02) |
+                                       (static_cast<uint8_t>(Res) & 0x01);
+  static constexpr uint16_t HUMI_CONVERSION_TIME[] = {12000, 3100, 4500, 6800};
+  static constexpr uint16_t TEMP_CONVERSION_TIME[] = {10800, 3800, 6200, 2400};
+  static constexpr uint8_t MEASUREMENT_LEN = (Check == Checksum::Verify) ? 3 : 2;
+
+public:
+  /* maximum conversion times in us, a humidity measurement includes the temperature */
+  static constexpr uint32_t humidity_time = HUMI_CONVERSION_TIME[RES_INDEX] +
+                                            TEMP_CONVERSION_TIME[RES_INDEX];
+  static constexpr uint32_t temperature_time = TEMP_CONVERSION_TIME[RES_INDEX];
+  static constexpr uint8_t resolution = static_cast<uint8_t>(Res);
+
+  constexpr explicit Sensor(Bus bus) : bus_(bus) {}
+
+  /* writes the resolution, the reserved bits of User Register 1 are kept */
+  int8_t init()
+  {
+    uint8_t reg;
+
+    if(read_register<Register::User_Register_1>(reg) < 0)
+      return -1;
+
+    if((reg & RES_MASK) == resolution)
+      return 0;
+
+    return write_register<Register::User_Register_1>((reg & ~RES_MASK) | resolution);
+  }
+
+  /* humidity by Hold Master Mode and the temperature of its conversion, see r_sample_Si7021 */
+  int8_t read(Si7021_sample_t& sample)
+  {
+    uint8_t cmd[2] = {Humi_HM, Temp_AH};
+    uint8_t buffer[MEASUREMENT_LEN + 2];
+
+    Si7021_msg_t msgs[4] =
+    {
+      {I2C_Msg_Write, 1,               &cmd[0]},
+      {I2C_Msg_Read,  MEASUREMENT_LEN, &buffer[0]},
+      {I2C_Msg_Write, 1,               &cmd[1]},
+      {I2C_Msg_Read,  2,               &buffer[MEASUREMENT_LEN]}
+    };
+
+    uint32_t start_us = now_us();
+
+    sample.status = (bus_.transfer(Address, msgs, 4) < 0 || !checksum_ok(buffer)) ? -1 : 0;
+    stamp(sample, start_us, now_us());
+
+    if(sample.status == 0)
+    {
+      sample.humi_code = code_of(&buffer[0]);
+      sample.temp_code = code_of(&buffer[MEASUREMENT_LEN]);
+    }
+
+    return sample.status;
+  }
+
+  /* a single measurement by Hold Master Mode, see r_single_Si7021 */
+  template <Si7021_measurement_type_t Type>
+  int8_t read_code(uint16_t& code)
+  {
+    static_assert(Type == Humidity || Type == Temperature, "invalid measurement type");
+
+    uint8_t cmd = (Type == Humidity) ? Humi_HM : Temp_HM;
+    uint8_t buffer[MEASUREMENT_LEN];
+
+    Si7021_msg_t msgs[2] =
+    {
+      {I2C_Msg_Write, 1,               &cmd},
+      {I2C_Msg_Read,  MEASUREMENT_LEN, buffer}
+    };
+
+    if(bus_.transfer(Address, msgs, 2) < 0 || !checksum_ok(buffer))
+      return -1;
+
+    code = code_of(buffer);
+
+    return 0;
+  }
+
+  /* starts a humidity conversion by No Hold Master Mode, see start_measurement_Si7021 */
+  int8_t start()
+  {
+    uint8_t cmd = Humi_NHM;
+    Si7021_msg_t msg = {I2C_Msg_Write, 1, &cmd};
+
+    if(bus_.transfer(Address, &msg, 1) < 0)
+      return -1;
+
+    start_us_ = now_us();
+
+    return 0;
+  }
+
+  /* reads the started conversion, 1: still in progress, see fetch_sample_Si7021 */
+  int8_t fetch(Si7021_sample_t& sample)
+  {
+    uint8_t cmd = Temp_AH;
+    uint8_t buffer[MEASUREMENT_LEN + 2];
+    int8_t rv;
+
+    Si7021_msg_t msgs[3] =
+    {
+      {I2C_Msg_Read,  MEASUREMENT_LEN, &buffer[0]},
+      {I2C_Msg_Write, 1,               &cmd},
+      {I2C_Msg_Read,  2,               &buffer[MEASUREMENT_LEN]}
+    };
+
+    rv = bus_.transfer(Address, msgs, 3);
+
+    if(rv == SI7021_NACK)
+      return 1;
+
+    uint32_t end_us = now_us();
+
+    /* done by the fetch, at the latest after the maximum conversion time */
+    if((int32_t)(end_us - (start_us_ + humidity_time)) > 0)
+      end_us = start_us_ + humidity_time;
+
+    sample.status = (rv < 0 || !checksum_ok(buffer)) ? -1 : 0;
+    stamp(sample, start_us_, end_us);
+
+    if(sample.status == 0)
+    {
+      sample.humi_code = code_of(&buffer[0]);
+      sample.temp_code = code_of(&buffer[MEASUREMENT_LEN]);
+    }
+
+    return sample.status;
+  }
+
+  template <Register Reg>
+  int8_t read_register(uint8_t& value)
+  {
+    uint8_t cmd = (Reg == Register::User_Register_1) ? R_RHT_U_reg : R_Heater_C_reg;
+
+    Si7021_msg_t msgs[2] =
+    {
+      {I2C_Msg_Write, 1, &cmd},
+      {I2C_Msg_Read,  1, &value}
+    };
+
+    return (bus_.transfer(Address, msgs, 2) < 0) ? -1 : 0;
+  }
+
+  template <Register Reg>
+  int8_t write_register(uint8_t value)
+  {
+    uint8_t cmd[2] = {(Reg == Register::User_Register_1) ? W_RHT_U_reg : W_Heater_C_reg, value};
+    Si7021_msg_t msg = {I2C_Msg_Write, 2, cmd};
+
+    return (bus_.transfer(Address, &msg, 1) < 0) ? -1 : 0;
+  }
+
+  /* heater current in mA as a constant register value, see set_heater_current_Si7021 */
+  template <uint8_t Current>
+  int8_t set_heater_current()
+  {
+    static_assert(Current >= 3 && Current <= 94, "heater current is 3 ... 94 mA");
+
+    return write_register<Register::Heater_Control_Register>((Current - 3) / 6);
+  }
+
+  int8_t enable_heater(bool on)
+  {
+    uint8_t reg;
+
+    if(read_register<Register::User_Register_1>(reg) < 0)
+      return -1;
+
+    reg = on ? (reg | (1 << HTRE)) : (reg & ~(1 << HTRE));
+
+    if(write_register<Register::User_Register_1>(reg) < 0)
+      return -1;
+
+    flags_ = on ? SI7021_SAMPLE_HEATED : 0;
+
+    return 0;
+  }
+
+  /* code conversions, see code_to_humidity_Si7021 and code_to_temperature_Si7021 */
+  static constexpr float humidity(uint16_t code)
+  {
+    float value = 125.0f * code / 65536.0f - 6.0f;
+
+    return (value < 0) ? 0 : ((value > 100) ? 100 : value);
+  }
+
+  static constexpr float temperature(uint16_t code)
+  {
+    return 175.72f * code / 65536.0f - 46.85f;
+  }
+
+  /* integer conversions in 0.01 % and 0.01 C */
+  static constexpr int16_t humidity_centi(uint16_t code)
+  {
+    int32_t value = ((int32_t)12500 * code >> 16) - 600;
+
+    return (value < 0) ? 0 : ((value > 10000) ? 10000 : value);
+  }
+
+  static constexpr int16_t temperature_centi(uint16_t code)
+  {
+    return ((int32_t)17572 * code >> 16) - 4685;
+  }
+
+  static constexpr uint8_t crc8(const uint8_t* data, uint8_t len)
+  {
+    uint8_t crc = 0;
+
+    for(uint8_t i = 0; i < len; i++)
+    {
+      crc ^= data[i];
+
+      for(uint8_t bit = 0; bit < 8; bit++)
+        crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+    }
+
+    return crc;
+  }
+
+private:
+  static constexpr uint8_t RES_MASK = (1 << RES1) | (1 << RES0);
+
+  static constexpr uint16_t code_of(const uint8_t* bytes)
+  {
+    return (uint16_t)((bytes[0] << 8) | bytes[1]);
+  }
+
+  static constexpr bool checksum_ok(const uint8_t* bytes)
+  {
+    if constexpr(Check == Checksum::Verify)
+      return crc8(bytes, 2) == bytes[2];
+    else
+      return true;
+  }
+
+  uint32_t now_us()
+  {
+    if constexpr(has_now_us<Bus>::value)
+      return bus_.now_us();
+    else
+      return bus_.now_ms() * 1000;
+  }
+
+  void stamp(Si7021_sample_t& sample, uint32_t start_us, uint32_t end_us)
+  {
+    sample.timestamp = bus_.now_ms();
+    sample.start_us = start_us;
+    sample.end_us = end_us;
+    sample.resolution = resolution;
+    sample.flags = flags_;
+  }
+
+  Bus bus_;
+  uint8_t flags_ = 0;                  // SI7021_SAMPLE_HEATED while the heater is enabled
+  uint32_t start_us_ = 0;              // start of the No Hold Master conversion in us
+};
+
+}
+
+#endif /* SI7021_HPP_ */
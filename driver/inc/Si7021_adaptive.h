@@ -0,0 +1,93 @@
+#ifndef SI7021_ADAPTIVE_H_
+#define SI7021_ADAPTIVE_H_
+
+#include "Si7021_driver.h"
+
+typedef struct Si7021_adaptive
+{
+  Si7021_t*       dev;                 // sensor controlled
+  uint8_t         precise;             // level of the most precise allowed resolution
+  uint8_t         fast;                // level of the fastest allowed resolution
+  uint16_t        humi_rate;           // humidity rate threshold in codes/s
+  uint16_t        temp_rate;           // temperature rate threshold in codes/s
+  uint16_t        activity;            // filtered rate of change, 256: at the threshold
+  uint8_t         settle;              // number of calm evaluations before more precision
+  uint8_t         calm;                // consecutive calm evaluations
+  Si7021_sample_t last;                // sample the rate is measured from
+  uint8_t         has_last;
+  uint32_t        switches;            // number of resolution changes
+}Si7021_adaptive_t;
+
+/************************************************************************************************
+* NAME :            int8_t adaptive_init_Si7021(Si7021_adaptive_t* ctl, Si7021_t* dev,
+*                                               Si7021_resolution_t precise,
+*                                               Si7021_resolution_t fast, uint16_t humi_rate,
+*                                               uint16_t temp_rate)
+*
+* DESCRIPTION :     Initialises an adaptive resolution controller. The controller watches the
+*                   rate of change of the samples and selects a faster resolution during
+*                   transients and a more precise one when the readings are stable. The
+*                   resolutions ordered by conversion time (RH + Temp) are:
+*                   H12_T14 (22.8 ms), H10_T13 (10.7 ms), H11_T11 (9.2 ms), H8_T12 (6.9 ms).
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_adaptive_t*    ctl         controller to be initialised
+*            Si7021_t*             dev         sensor handle
+*            Si7021_resolution_t   precise     most precise resolution used
+*            Si7021_resolution_t   fast        fastest resolution used
+*            uint16_t              humi_rate   humidity change in 0.01 %/s that is a transient
+*            uint16_t              temp_rate   temperature change in 0.01 C/s that is a
+*                                              transient
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     invalid resolution or 'fast' is more precise than
+*                                           'precise'
+*
+* NOTES :          The resolution of the sensor is not changed until the first sample.
+*/
+int8_t adaptive_init_Si7021(Si7021_adaptive_t* ctl, Si7021_t* dev, Si7021_resolution_t precise,
+                            Si7021_resolution_t fast, uint16_t humi_rate, uint16_t temp_rate);
+
+/************************************************************************************************
+* NAME :            int8_t adaptive_sample_Si7021(Si7021_adaptive_t* ctl, Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Measures the sensor by r_sample_Si7021, then sets the resolution of the next
+*                   measurement from the rate of change.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_adaptive_t*    ctl      controller
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_sample_t*      sample   the new sample, with the resolution it was
+*                                           measured with
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error
+*
+* NOTES :          The rate is measured over at least 100 ms, so the noise of back to back
+*                  samples is not taken as a transient. A transient steps one resolution faster
+*                  at once, the resolution steps back one level after 'settle' (default 8) calm
+*                  evaluations. Changes of one LSB are not counted as change; after a switch
+*                  the LSB of each channel is the coarser one of the two resolutions, e.g. the
+*                  temperature LSB of H11_T11 from H11_T11 to H8_T12. The resolution is written
+*                  by a configuration transaction, so the local register copy and
+*                  conversion_time_Si7021 stay consistent with the sensor.
+*/
+int8_t adaptive_sample_Si7021(Si7021_adaptive_t* ctl, Si7021_sample_t* sample);
+
+#endif
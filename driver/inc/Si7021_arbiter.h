@@ -0,0 +1,243 @@
+#ifndef SI7021_ARBITER_H_
+#define SI7021_ARBITER_H_
+
+#include "Si7021_driver.h"
+
+#define SI7021_STEP_DONE   0    // job finished
+#define SI7021_STEP_WAIT   1    // job continues at the wake time it has set
+
+typedef struct Si7021_job Si7021_job_t;
+
+/************************************************************************************************
+* NAME :            int8_t (*Si7021_step_t)(Si7021_job_t* job, uint32_t now)
+*
+* DESCRIPTION :     Job step function type definition. A step shall do a short, non-blocking
+*                   piece of bus work (e.g. one transfer) and return.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_job_t*         job      the job being executed
+*            uint32_t              now      current time in ms
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  SI7021_STEP_DONE      the job is finished
+*                     SI7021_STEP_WAIT      the job has more steps, 'wake' of the job is set
+*                                           to the time of the next step
+*                    -1                     error, the job is finished
+*
+* NOTES :          The bus of the arbiter is locked while a step is executed.
+*/
+typedef int8_t (*Si7021_step_t)(Si7021_job_t* job, uint32_t now);
+
+/************************************************************************************************
+* NAME :            void (*Si7021_job_done_t)(Si7021_job_t* job, int8_t result)
+*
+* DESCRIPTION :     Job completion callback type definition.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_job_t*         job      the finished job
+*            int8_t                result   SI7021_STEP_DONE or -1
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          The job is not in the queue any more, it may be submitted again.
+*/
+typedef void (*Si7021_job_done_t)(Si7021_job_t* job, int8_t result);
+
+struct Si7021_job
+{
+  Si7021_step_t     step;          // executes the next step of the job
+  Si7021_job_done_t done;          // called when the job finished, may be NULL
+  void*             ctx;           // user data
+  uint8_t           priority;      // higher value is served first
+  uint8_t           started;       // arbiter internal, set when the first step was executed
+  uint32_t          submit_time;   // arbiter internal, time of submission in ms
+  uint32_t          wake;          // time of the next step in ms
+  Si7021_job_t*     next;          // arbiter internal, queue link
+};
+
+typedef struct Si7021_arbiter_stats
+{
+  uint16_t depth;                  // number of queued jobs
+  uint16_t max_depth;              // highest number of queued jobs
+  uint32_t completed;              // number of finished jobs
+  uint32_t total_wait;             // sum of the times from submission to first step in ms
+  uint32_t max_wait;               // longest time from submission to first step in ms
+}Si7021_arbiter_stats_t;
+
+typedef struct Si7021_arbiter
+{
+  Si7021_bus_t*          bus;      // bus the jobs are executed on
+  Si7021_job_t*          queue;    // queued jobs
+  uint16_t               aging;    // ms of waiting that raise the priority of a job by one
+  Si7021_arbiter_stats_t stats;
+}Si7021_arbiter_t;
+
+typedef struct Si7021_measure_job
+{
+  Si7021_job_t              job;
+  Si7021_t*                 dev;   // sensor to be measured
+  Si7021_measurement_type_t type;  // type of measurement
+  uint8_t                   state; // internal
+  uint8_t                   polls; // internal
+  uint16_t                  code;  // raw result of the measurement
+}Si7021_measure_job_t;
+
+/************************************************************************************************
+* NAME :            void arbiter_init_Si7021(Si7021_arbiter_t* arb, Si7021_bus_t* bus, uint16_t aging)
+*
+* DESCRIPTION :     Initialises a bus arbiter. Each bus shared by several devices has one arbiter
+*                   which executes the jobs of all the devices step by step.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_arbiter_t*     arb      arbiter to be initialised
+*            Si7021_bus_t*         bus      bus of the arbiter
+*            uint16_t              aging    waiting time in ms that raises the priority of a job
+*                                           by one, so low priority jobs are not starved;
+*                                           0 disables aging
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :
+*/
+void arbiter_init_Si7021(Si7021_arbiter_t* arb, Si7021_bus_t* bus, uint16_t aging);
+
+/************************************************************************************************
+* NAME :            int8_t arbiter_submit_Si7021(Si7021_arbiter_t* arb, Si7021_job_t* job,
+*                                                uint32_t now)
+*
+* DESCRIPTION :     Adds a job to the queue of the arbiter. The job is ready to start
+*                   immediately.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_arbiter_t*     arb      arbiter
+*            Si7021_job_t*         job      job to be queued, it must remain valid until done
+*            uint32_t              now      current time in ms
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     the job is already queued or has no step function
+*
+* NOTES :          The queue is protected by the bus lock.
+*/
+int8_t arbiter_submit_Si7021(Si7021_arbiter_t* arb, Si7021_job_t* job, uint32_t now);
+
+/************************************************************************************************
+* NAME :            int16_t arbiter_poll_Si7021(Si7021_arbiter_t* arb, uint32_t now, uint32_t* wake)
+*
+* DESCRIPTION :     Executes one step of the ready job with the highest priority. Priority is
+*                   raised by the time a job is waiting (see 'aging'), jobs of the same priority
+*                   are served in order of submission.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_arbiter_t*     arb      arbiter
+*            uint32_t              now      current time in ms
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            uint32_t*             wake     earliest wake time of the queued jobs, valid if
+*                                           the return value is greater than 0; may be NULL
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int16_t                Error code:
+*            Values: <depth>                number of jobs left in the queue, at most
+*                                           INT16_MAX
+*
+* NOTES :          Call it from the main loop or a task of the bus. The caller may sleep until
+*                  'wake' if no job was ready. The exact depth of a longer queue is returned
+*                  by arbiter_stats_Si7021.
+*/
+int16_t arbiter_poll_Si7021(Si7021_arbiter_t* arb, uint32_t now, uint32_t* wake);
+
+/************************************************************************************************
+* NAME :            void arbiter_stats_Si7021(Si7021_arbiter_t* arb, Si7021_arbiter_stats_t* stats)
+*
+* DESCRIPTION :     Returns the queue statistics of the arbiter.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_arbiter_t*     arb      arbiter
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_arbiter_stats_t* stats  copy of the statistics
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          The average waiting time is total_wait / completed.
+*/
+void arbiter_stats_Si7021(Si7021_arbiter_t* arb, Si7021_arbiter_stats_t* stats);
+
+/************************************************************************************************
+* NAME :            void measure_job_init_Si7021(Si7021_measure_job_t* mjob, Si7021_t* dev,
+*                                                Si7021_measurement_type_t type,
+*                                                uint8_t priority, Si7021_job_done_t done)
+*
+* DESCRIPTION :     Prepares a Si7021 measurement job. The job starts the conversion by the No
+*                   Hold Master Mode command, leaves the bus free for other jobs for the
+*                   conversion time and then reads the result into 'code'.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_measure_job_t*      mjob      job to be prepared
+*            Si7021_t*                  dev       sensor to be measured
+*            Si7021_measurement_type_t  type      type of measurement
+*            uint8_t                    priority  priority of the job
+*            Si7021_job_done_t          done      completion callback, may be NULL
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          Submit it by arbiter_submit_Si7021(arb, &mjob->job, now).
+*                  Jobs of the same sensor are serialised: a job does not start while the
+*                  conversion of another one is pending, and retries a sensor that does not
+*                  acknowledge the start (SI7021_NACK) 1 ms apart, up to 50 times.
+*/
+void measure_job_init_Si7021(Si7021_measure_job_t* mjob, Si7021_t* dev,
+                             Si7021_measurement_type_t type,
+                             uint8_t priority, Si7021_job_done_t done);
+
+#endif /* SI7021_ARBITER_H_ */
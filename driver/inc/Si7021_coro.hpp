@@ -0,0 +1,268 @@
+#ifndef SI7021_CORO_HPP_
+#define SI7021_CORO_HPP_
+
+/*
+*  C++20 coroutine front-end of the resumable operations. si7021::Task is a lazily started
+*  coroutine returning int8_t like the C functions; it can be awaited by another task, so
+*  multi-step sequences are written as straight-line code. si7021::Loop resumes the tasks
+*  waiting for a time. The coroutines are stackless: any number of operations on many
+*  sensors run on the stack of the loop, each takes the size of its coroutine frames.
+*
+*      si7021::Task<int8_t> app(si7021::Loop& loop, Si7021_t* dev)
+*      {
+*        Si7021_sample_t sample;
+*
+*        if(co_await si7021::set_resolution(loop, dev, H11_T11) < 0)
+*          co_return -1;
+*
+*        co_return co_await si7021::sample(loop, dev, sample);
+*      }
+*
+*      si7021::Task<int8_t> task = app(loop, dev);
+*      loop.start(task, now_ms());
+*
+*  The tasks take the time from the loop, which is updated by poll. A task started outside
+*  of poll is started by Loop::start with the current time, so its first wait does not
+*  count from the time of the last poll. An exception leaving a task is kept in it and
+*  rethrown to the awaiting task, or by Task::result of a top level task.
+*/
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+extern "C"
+{
+#include "Si7021_task.h"
+}
+
+namespace si7021
+{
+
+template <typename T>
+class Task;
+
+class Loop
+{
+public:
+  struct Timer
+  {
+    uint32_t                wake;
+    std::coroutine_handle<> handle;
+    Timer*                  next;
+  };
+
+  /* awaitable resuming the coroutine at 'wake' or later */
+  struct Sleep
+  {
+    Loop&    loop;
+    Timer    timer;
+
+    bool await_ready() const noexcept
+    {
+      return (int32_t)(loop.now_ - timer.wake) >= 0;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+      timer.handle = handle;
+      loop.add(&timer);
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  uint32_t now() const { return now_; }
+
+  Sleep sleep_until(uint32_t wake) { return Sleep{*this, {wake, nullptr, nullptr}}; }
+
+  /* runs a top level task until its first wait, 'now' is the current time */
+  template <typename T>
+  void start(Task<T>& task, uint32_t now);
+
+  /* resumes the coroutines that are due, returns 1 and the next wake time if any is waiting */
+  int8_t poll(uint32_t now, uint32_t* wake)
+  {
+    Timer* timer = timers_;
+    Timer* next;
+
+    now_ = now;
+
+    /* resumed coroutines add their new timers to the emptied list */
+    timers_ = nullptr;
+
+    for(; timer != nullptr; timer = next)
+    {
+      next = timer->next;
+
+      if((int32_t)(now - timer->wake) >= 0)
+        timer->handle.resume();
+      else
+        add(timer);
+    }
+
+    if(timers_ == nullptr)
+      return 0;
+
+    if(wake != nullptr)
+    {
+      *wake = timers_->wake;
+
+      for(timer = timers_->next; timer != nullptr; timer = timer->next)
+      {
+        if((int32_t)(timer->wake - *wake) < 0)
+          *wake = timer->wake;
+      }
+    }
+
+    return 1;
+  }
+
+private:
+  /* unordered, a poll visits every timer once */
+  void add(Timer* timer)
+  {
+    timer->next = timers_;
+    timers_ = timer;
+  }
+
+  uint32_t now_ = 0;
+  Timer*   timers_ = nullptr;
+};
+
+template <typename T>
+class Task
+{
+public:
+  struct promise_type
+  {
+    T                       value{};
+    std::coroutine_handle<> continuation;
+    std::exception_ptr      exception;
+
+    Task get_return_object()
+    {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    /* continues the awaiting task, if any */
+    auto final_suspend() noexcept
+    {
+      struct Final
+      {
+        bool await_ready() const noexcept { return false; }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+        {
+          if(h.promise().continuation)
+            return h.promise().continuation;
+          return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+      };
+
+      return Final{};
+    }
+
+    void return_value(T v) { value = v; }
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    /* the value, or the exception that ended the coroutine */
+    T get() const
+    {
+      if(exception)
+        std::rethrow_exception(exception);
+
+      return value;
+    }
+  };
+
+  explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+  ~Task()
+  {
+    if(handle_)
+      handle_.destroy();
+  }
+
+  /* runs a top level task until its first wait, from a task resumed by the loop; outside of
+     Loop::poll use Loop::start, which updates the time of the loop first */
+  void start() { handle_.resume(); }
+
+  bool done() const { return handle_.done(); }
+  T result() const { return handle_.promise().get(); }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+  {
+    handle_.promise().continuation = awaiting;
+    return handle_;
+  }
+
+  T await_resume() const { return handle_.promise().get(); }
+
+private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+template <typename T>
+void Loop::start(Task<T>& task, uint32_t now)
+{
+  now_ = now;
+  task.start();
+}
+
+/* runs a C task (see Si7021_task.h) to completion */
+inline Task<int8_t> run(Loop& loop, Si7021_job_t* job)
+{
+  int8_t rv;
+
+  while((rv = job->step(job, loop.now())) == SI7021_STEP_WAIT)
+    co_await loop.sleep_until(job->wake);
+
+  co_return rv;
+}
+
+/* humidity and temperature by No Hold Master Mode, see sample_task_init_Si7021 */
+inline Task<int8_t> sample(Loop& loop, Si7021_t* dev, Si7021_sample_t& sample)
+{
+  int8_t rv;
+  uint8_t polls = 0;
+
+  if(start_measurement_Si7021(dev, Humidity) < 0)
+    co_return -1;
+
+  co_await loop.sleep_until(loop.now() + (conversion_time_Si7021(dev, Humidity) + 999) / 1000);
+
+  while((rv = fetch_sample_Si7021(dev, &sample)) == 1 && ++polls <= 10)
+    co_await loop.sleep_until(loop.now() + 1);
+
+  co_return (rv == 0) ? 0 : -1;
+}
+
+/* read-modify-write of a register, see update_task_init_Si7021 */
+inline Task<int8_t> update_register(Loop& loop, Si7021_t* dev, Si7021_registers_t reg,
+                                    uint8_t mask, uint8_t value)
+{
+  Si7021_update_task_t task;
+
+  update_task_init_Si7021(&task, dev, reg, mask, value, 0, nullptr);
+
+  co_return co_await run(loop, &(task.job));
+}
+
+inline Task<int8_t> set_resolution(Loop& loop, Si7021_t* dev, Si7021_resolution_t resolution)
+{
+  return update_register(loop, dev, User_Register_1, (1 << RES1) | (1 << RES0), resolution);
+}
+
+}
+
+#endif /* SI7021_CORO_HPP_ */
@@ -1,7 +1,8 @@
 #ifndef SI7021_H_
 #define SI7021_H_
 
-#include "stm32f4xx_hal.h"
+#include <stdint.h>
+#include <stddef.h>
 
 #define RES0 0
 #define RES1 7
@@ -48,14 +49,511 @@ typedef enum Si7021_resolution
   H11_T11 = 0x81
 }Si7021_resolution_t;
 
+#define SI7021_USER_REG_1_DEFAULT  0b00111010   // User Register 1 value after reset
+#define SI7021_HEATER_REG_DEFAULT  0b00000000   // Heater Control Register value after reset
+#define SI7021_NO_CHANNEL          0xFF         // no multiplexer channel is selected
+#define SI7021_RESET_TIME_MS       15           // maximum time from soft reset to ready
+#define SI7021_RESET_POLLS         1000         // register reads after a reset without delay_ms
+#define SI7021_NACK                (-2)         // bus transfer result: address not acknowledged
+#define SI7021_NO_MEASUREMENT      0xFF         // pending_type: no measurement started
+
+#define SI7021_SAMPLE_HEATED       0x01         // sample flag: the heater was on
+#define SI7021_SAMPLE_COOLING      0x02         // sample flag: measured in the heater cool-down
+#define SI7021_SAMPLE_HEATER       (SI7021_SAMPLE_HEATED | SI7021_SAMPLE_COOLING)
+
+typedef enum Si7021_msg_direction
+{
+  I2C_Msg_Write,
+  I2C_Msg_Read
+}Si7021_msg_direction_t;
+
+typedef struct Si7021_msg
+{
+  Si7021_msg_direction_t dir;  // direction of the message
+  uint16_t               len;  // number of bytes to be written or read
+  uint8_t*               buf;  // data to be written or memory location of the read data
+}Si7021_msg_t;
+
 /************************************************************************************************
-* NAME :            int8_t r_firmware_rev_Si7021(void)
+* NAME :            int8_t (*Si7021_transfer_t)(void* ctx, uint16_t addr,
+*                                               Si7021_msg_t* msgs, uint8_t count)
 *
-* DESCRIPTION :     Reads the Si7021 internal firmware revision.
+* DESCRIPTION :     Bus transfer function type definition. The messages shall be executed in
+*                   order, separated by repeated starts and closed by a single STOP. A bus that
+*                   is not able to do so may split the sequence into several transactions but
+*                   it shall keep each write message together with a following read message
+*                   in one combined transaction.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                 ctx      bus specific context (e.g. HAL handle)
+*            uint16_t              addr     7 bit I2C address of the device
+*            Si7021_msg_t*         msgs     array of messages
+*            uint8_t               count    number of messages
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error
+*                    SI7021_NACK            the device did not acknowledge its address
+*
+* NOTES :          Returning -1 instead of SI7021_NACK is allowed, the driver then handles a
+*                  conversion in progress as an error.
+*/
+typedef int8_t (*Si7021_transfer_t)(void* ctx, uint16_t addr, Si7021_msg_t* msgs, uint8_t count);
+
+/************************************************************************************************
+* NAME :            int8_t (*Si7021_select_t)(void* ctx, uint8_t channel)
+*
+* DESCRIPTION :     Multiplexer channel select function type definition.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                 ctx      bus specific context
+*            uint8_t               channel  channel to be connected to the bus
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error
+*
+* NOTES :
+*/
+typedef int8_t (*Si7021_select_t)(void* ctx, uint8_t channel);
+
+/************************************************************************************************
+* NAME :            void (*Si7021_lock_t)(void* mutex)
+*
+* DESCRIPTION :     Bus lock and unlock function type definition.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                 mutex    mutex of the bus
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          The lock shall be recursive: the driver functions take the lock of the bus
+*                  themselves and the application may already hold it (e.g. around a
+*                  configuration transaction or a batch of commands).
+*/
+typedef void (*Si7021_lock_t)(void* mutex);
+
+typedef struct Si7021_bus
+{
+  Si7021_transfer_t transfer;            // executes I2C messages
+  Si7021_select_t   select;              // selects a multiplexer channel, NULL if no multiplexer
+  void              (*delay_ms)(uint32_t ms); // blocking delay in ms, NULL: init_Si7021 polls
+                                         // the sensor after a reset
+  uint32_t          (*now_ms)(void);     // monotonic time in ms, used for sample timestamps
+  void*             ctx;                 // passed to the bus functions
+  Si7021_lock_t     lock;                // takes the bus mutex, NULL if no locking is needed
+  Si7021_lock_t     unlock;              // releases the bus mutex
+  void*             mutex;               // passed to the lock functions
+  uint8_t           channels;            // number of multiplexer channels
+  uint8_t           active_channel;      // driver internal, initialise to SI7021_NO_CHANNEL
+  uint32_t          (*now_us)(void);     // monotonic time in us for the conversion times, NULL:
+                                         // taken from now_ms
+}Si7021_bus_t;
+
+typedef struct Si7021_config
+{
+  Si7021_resolution_t resolution;        // measurement resolution
+  uint8_t             heater_enable;     // 0: heater off, every other value: heater on
+  uint8_t             heater_current;    // heater current in mA, see set_heater_current_Si7021
+}Si7021_config_t;
+
+typedef struct Si7021_sample
+{
+  uint16_t humi_code;                    // raw humidity code
+  uint16_t temp_code;                    // raw temperature code
+  uint32_t timestamp;                    // time of the measurement in ms (bus now_ms)
+  uint32_t start_us;                     // conversion start in us (bus now_us)
+  uint32_t end_us;                       // conversion done at or before, in us (bus now_us)
+  int8_t   status;                       // 0: OK, -1: the measurement failed
+  uint8_t  resolution;                   // Si7021_resolution_t of the measurement
+  uint8_t  flags;                        // SI7021_SAMPLE_HEATED, SI7021_SAMPLE_COOLING
+}Si7021_sample_t;
+
+typedef struct Si7021
+{
+  Si7021_bus_t* bus;                     // bus the sensor is connected to
+  uint8_t       channel;                 // multiplexer channel of the sensor
+  uint8_t       user_register_1;         // local copy of User Register 1
+  uint8_t       heater_control_register; // local copy of Heater Control Register
+  uint8_t       staged_user_register_1;  // User Register 1 value to be written by commit
+  uint8_t       staged_heater_control_register; // Heater Control Register value to be written
+  uint8_t       firmware_rev;            // firmware revision, 0 if not read yet
+  uint32_t      serial_a;                // electronic serial number, SNA_3 ... SNA_0
+  uint32_t      serial_b;                // electronic serial number, SNB_3 ... SNB_0
+  uint32_t      snapshot_seq;            // sequence number of the snapshot, odd while updated
+  Si7021_sample_t snapshot;              // latest sample, read by latest_Si7021
+  uint32_t      rh_time;                 // time of the last RH conversion in ms
+  uint32_t      rh_seq;                  // number of RH conversions, see r_single_Si7021
+  uint16_t      rh_code;                 // result of the last RH conversion
+  uint8_t       rh_valid;                // Temp_AH holds the temperature of the last RH conversion
+  uint8_t       pending_type;            // type of the started No Hold Master measurement, or
+                                         // SI7021_NO_MEASUREMENT
+  uint32_t      pending_start_us;        // start of the No Hold Master measurement in us
+  uint32_t      conv_start_us;           // start of the last conversion read in us
+  uint32_t      conv_end_us;             // end of the last conversion read in us
+  uint16_t      coalesce_window;         // see set_coalesce_window_Si7021
+  uint8_t       sample_flags;            // flags added to the samples, e.g. by a heater schedule
+}Si7021_t;
+
+/************************************************************************************************
+* NAME :            void lock_bus_Si7021(Si7021_bus_t* bus)
+*
+* DESCRIPTION :     Takes the lock of the bus. Every driver function takes the lock of the bus
+*                   of the sensor for its bus traffic and for accessing the local register
+*                   copies, so sensors on different buses can be used in parallel.
+*                   The application can hold the lock to execute several driver functions
+*                   without other tasks using the bus in between.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_bus_t*                  bus       bus to be locked
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          Does nothing if the bus has no lock functions.
+*/
+void lock_bus_Si7021(Si7021_bus_t* bus);
+
+/************************************************************************************************
+* NAME :            void unlock_bus_Si7021(Si7021_bus_t* bus)
+*
+* DESCRIPTION :     Releases the lock of the bus taken by lock_bus_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_bus_t*                  bus       bus to be unlocked
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          Does nothing if the bus has no lock functions.
+*/
+void unlock_bus_Si7021(Si7021_bus_t* bus);
+
+/************************************************************************************************
+* NAME :            void attach_Si7021(Si7021_t* dev, Si7021_bus_t* bus, uint8_t channel)
+*
+* DESCRIPTION :     Initialises a sensor handle. No bus communication is done.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*            Si7021_bus_t*                  bus       bus the sensor is connected to
+*            uint8_t                        channel   multiplexer channel of the sensor,
+*                                                     ignored if the bus has no multiplexer
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          The local register copies are set to their reset values.
+*/
+void attach_Si7021(Si7021_t* dev, Si7021_bus_t* bus, uint8_t channel);
+
+/************************************************************************************************
+* NAME :            void set_coalesce_window_Si7021(Si7021_t* dev, uint16_t window)
+*
+* DESCRIPTION :     Sets the time window in which temperature requests are served from the last
+*                   humidity conversion. Each RH conversion also measures the temperature, so
+*                   within the window r_single_Si7021(..., Temperature) reads it by the
+*                   Temp_AH command instead of starting a new conversion.
 *
 * INPUTS :
 *       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*            uint16_t                       window    window in ms, 0 disables it
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
 *            None
+*       RETURN :
+*            None
+*
+* NOTES :          The window needs the now_ms clock of the bus, without it the window is not
+*                  used. Independently of the window, requests waiting for the bus while an RH
+*                  conversion is done are merged into it: a humidity request gets its result
+*                  and a temperature request reads Temp_AH. Requests made one after the other
+*                  are not merged. Default window is 0.
+*/
+void set_coalesce_window_Si7021(Si7021_t* dev, uint16_t window);
+
+/************************************************************************************************
+* NAME :            int8_t init_Si7021(Si7021_t* dev, const Si7021_config_t* config)
+*
+* DESCRIPTION :     Brings the sensor into the given configuration with the least bus traffic.
+*                   Both registers are read in one transfer and compared with the configuration,
+*                   only the registers which differ are written. The sensor is reset only if
+*                   its registers can not be read or their reserved bits are not as expected.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*            const Si7021_config_t*         config    configuration to be set
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error or invalid resolution
+*
+* NOTES :          The registers are written by a configuration transaction, see
+*                  config_commit_Si7021.
+*                  A sensor which is already configured (e.g. warm start of the MCU without
+*                  power cycle of the sensor) costs a single transfer.
+*                  The reset, if needed, waits SI7021_RESET_TIME_MS by the delay function of
+*                  the bus. The bus lock is released during the wait, so the other sensors of
+*                  the bus can be used; the lock stays taken if the caller holds it. A bus
+*                  without delay function polls the registers until the sensor acknowledges
+*                  again, at most SI7021_RESET_POLLS times.
+*/
+int8_t init_Si7021(Si7021_t* dev, const Si7021_config_t* config);
+
+/************************************************************************************************
+* NAME :            void config_begin_Si7021(Si7021_t* dev)
+*
+* DESCRIPTION :     Starts a configuration transaction. The staged configuration is set to the
+*                   current local copies of the registers, then it can be changed by the
+*                   stage_..._Si7021 functions and written by config_commit_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          No bus communication is done.
+*                  The bus lock is taken here and released by config_commit_Si7021, so every
+*                  call shall be followed by a commit from the same task.
+*/
+void config_begin_Si7021(Si7021_t* dev);
+
+/************************************************************************************************
+* NAME :            int8_t stage_resolution_Si7021(Si7021_t* dev, Si7021_resolution_t resolution)
+*
+* DESCRIPTION :     Stages the measurement resolution to be written by the next commit.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev         sensor handle
+*            Si7021_resolution_t            resolution  resolution value to be set
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     invalid resolution parameter
+*
+* NOTES :          No bus communication is done.
+*/
+int8_t stage_resolution_Si7021(Si7021_t* dev, Si7021_resolution_t resolution);
+
+/************************************************************************************************
+* NAME :            void stage_heater_Si7021(Si7021_t* dev, uint8_t val)
+*
+* DESCRIPTION :     Stages the enable state of the on-chip heater to be written by the next
+*                   commit.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*            uint8_t                        val       value of '0' means disable
+*                                                     every other means enable
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          No bus communication is done.
+*/
+void stage_heater_Si7021(Si7021_t* dev, uint8_t val);
+
+/************************************************************************************************
+* NAME :            void stage_heater_current_Si7021(Si7021_t* dev, uint8_t current)
+*
+* DESCRIPTION :     Stages the heater current to be written by the next commit.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*            uint8_t                        current   current in mA
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          No bus communication is done. The current is rounded as described at
+*                  set_heater_current_Si7021.
+*/
+void stage_heater_current_Si7021(Si7021_t* dev, uint8_t current);
+
+/************************************************************************************************
+* NAME :            int8_t config_commit_Si7021(Si7021_t* dev)
+*
+* DESCRIPTION :     Writes the staged configuration to the sensor. Only the registers whose
+*                   staged value differs from the local copy are written, each at most once.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error
+*
+* NOTES :          The local copy of a register is updated only if its write succeeded, so after
+*                  an error the copies still match the sensor and the staged configuration is
+*                  discarded. Nothing is written if the configuration did not change.
+*/
+int8_t config_commit_Si7021(Si7021_t* dev);
+
+/************************************************************************************************
+* NAME :            int8_t r_serial_Si7021(Si7021_t* dev, uint32_t* serial_a, uint32_t* serial_b)
+*
+* DESCRIPTION :     Reads the 64 bit electronic serial number of the sensor and verifies the
+*                   checksums of the ID bytes. The result is also stored in the sensor handle.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            uint32_t*                      serial_a  upper 32 bits of the serial number,
+*                                                     may be NULL
+*            uint32_t*                      serial_b  lower 32 bits of the serial number,
+*                                                     may be NULL
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error or checksum error
+*
+* NOTES :          Both ID accesses are passed to the bus in one transfer. The device ID is the
+*                  SNB_3 byte (serial_b >> 24): 0x15 for Si7021.
+*/
+int8_t r_serial_Si7021(Si7021_t* dev, uint32_t* serial_a, uint32_t* serial_b);
+
+/************************************************************************************************
+* NAME :            int16_t enumerate_Si7021(Si7021_bus_t* const buses[], uint8_t bus_count,
+*                                            Si7021_t table[], uint8_t table_size)
+*
+* DESCRIPTION :     Scans every channel of every given bus and fills the sensor table with the
+*                   sensors found. The serial number and the firmware revision of each sensor
+*                   are read during the scan.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_bus_t* const[]          buses       buses to be scanned
+*            uint8_t                        bus_count   number of buses
+*            uint8_t                        table_size  number of elements in the table
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_t[]                     table       sensor handles of the sensors found
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int16_t                Error code:
+*            Values: <count>                number of sensors found
+*
+* NOTES :          The table is ordered by bus then by channel, so the result is the same on
+*                  every boot for the same wiring. Buses without multiplexer are probed once.
+*                  A position without sensor costs a single not acknowledged transfer, a
+*                  sensor costs two transfers: serial number and firmware revision.
+*/
+int16_t enumerate_Si7021(Si7021_bus_t* const buses[], uint8_t bus_count,
+                         Si7021_t table[], uint8_t table_size);
+
+/************************************************************************************************
+* NAME :            int8_t r_firmware_rev_Si7021(Si7021_t* dev)
+*
+* DESCRIPTION :     Reads the Si7021 internal firmware revision.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
 *       GLOBALS :
 *            None
 * OUTPUTS :
@@ -72,10 +570,10 @@ typedef enum Si7021_resolution
 * NOTES :           
 *                   
 */
-int8_t r_firmware_rev_Si7021(void);
+int8_t r_firmware_rev_Si7021(Si7021_t* dev);
 
 /************************************************************************************************
-* NAME :            int8_t VDD_warning_Si7021(void)
+* NAME :            int8_t VDD_warning_Si7021(Si7021_t* dev)
 *
 * DESCRIPTION :     The minimum recommended operating voltage is 1.9 V. A transition
 *                   of the VDD status bit from 0 to 1 indicates that VDD is
@@ -85,7 +583,7 @@ int8_t r_firmware_rev_Si7021(void);
 *
 * INPUTS :
 *       PARAMETERS:
-*            None
+*            Si7021_t*                      dev       sensor handle
 *       GLOBALS :
 *            None
 * OUTPUTS :
@@ -102,10 +600,10 @@ int8_t r_firmware_rev_Si7021(void);
 * NOTES :           
 *                   
 */
-int8_t VDD_warning_Si7021(void);
+int8_t VDD_warning_Si7021(Si7021_t* dev);
 
 /************************************************************************************************
-* NAME :            int8_t r_single_Si7021(float* data, Si7021_measurement_type_t type)
+* NAME :            int8_t r_single_Si7021(Si7021_t* dev, float* data, Si7021_measurement_type_t type)
 *
 * DESCRIPTION :     Initiates a measurement defined by the 'type' parameter and reads
 *                   back its result. It can be either a humidity or a temperature
@@ -113,6 +611,7 @@ int8_t VDD_warning_Si7021(void);
 *
 * INPUTS :
 *       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
 *            Si7021_measurement_type_t      type      type of measurement to be done
 *       GLOBALS :
 *            None
@@ -129,12 +628,156 @@ int8_t VDD_warning_Si7021(void);
 *
 * NOTES :          The function uses the Hold Master Mode I2C command to request the measurement
 *                  and to read back the result.
-*                   
+*                  Requests may be served from a recent humidity conversion without a new one,
+*                  see set_coalesce_window_Si7021. The times of the conversion are returned by
+*                  conversion_times_Si7021.
+*/
+int8_t r_single_Si7021(Si7021_t* dev, float* data, Si7021_measurement_type_t type);
+
+/************************************************************************************************
+* NAME :            int8_t start_measurement_Si7021(Si7021_t* dev, Si7021_measurement_type_t type)
+*
+* DESCRIPTION :     Starts a measurement defined by the 'type' parameter by the No Hold Master
+*                   Mode command and returns without waiting for the result. The bus is free
+*                   during the conversion, the result is read by fetch_measurement_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*            Si7021_measurement_type_t      type      type of measurement to be done
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error or invalid measurement type parameter
+*                    SI7021_NACK            the sensor did not acknowledge, e.g. it is busy
+*                                           with a conversion
+*
+* NOTES :          The result is available after conversion_time_Si7021. SI7021_NACK is only
+*                  returned if the bus reports the not acknowledged address by it.
+*/
+int8_t start_measurement_Si7021(Si7021_t* dev, Si7021_measurement_type_t type);
+
+/************************************************************************************************
+* NAME :            int8_t fetch_measurement_Si7021(Si7021_t* dev, uint16_t* code)
+*
+* DESCRIPTION :     Reads the result of the measurement started by start_measurement_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            uint16_t*                      code      raw measurement code, see
+*                                                     code_to_humidity_Si7021 and
+*                                                     code_to_temperature_Si7021
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                     1                     conversion is still in progress
+*                    -1                     I2C error or no measurement was started
+*
+* NOTES :          Returns 1 only if the bus reports the not acknowledged address by
+*                  SI7021_NACK. A started measurement is read once, a new one has to be
+*                  started for the next result.
+*/
+int8_t fetch_measurement_Si7021(Si7021_t* dev, uint16_t* code);
+
+/************************************************************************************************
+* NAME :            int8_t fetch_sample_Si7021(Si7021_t* dev, Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Reads the result of a humidity measurement started by
+*                   start_measurement_Si7021 together with the temperature measured with it,
+*                   in one bus transfer. The sample is published as by r_sample_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_sample_t*               sample    the new sample
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                     1                     conversion is still in progress, nothing published
+*                    -1                     I2C error or the started measurement is not humidity
+*
+* NOTES :          Returns 1 only if the bus reports the not acknowledged address by
+*                  SI7021_NACK. The non-blocking counterpart of r_sample_Si7021. A started
+*                  measurement is read once, a new one has to be started for the next sample.
+*                  'start_us' is the time the start command was sent, 'end_us' the earlier of
+*                  the fetch and the end of the maximum conversion time.
 */
-int8_t r_single_Si7021(float* data, Si7021_measurement_type_t type);
+int8_t fetch_sample_Si7021(Si7021_t* dev, Si7021_sample_t* sample);
 
 /************************************************************************************************
-* NAME :            int8_t r_both_Si7021(float* humidity, float* temperature)
+* NAME :            uint32_t conversion_time_Si7021(Si7021_t* dev, Si7021_measurement_type_t type)
+*
+* DESCRIPTION :     Returns the maximum conversion time of a measurement at the resolution held
+*                   by the local copy of User Register 1.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*            Si7021_measurement_type_t      type      type of measurement
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   uint32_t
+*            Values: <time>                 conversion time in us
+*
+* NOTES :          A humidity measurement includes the temperature conversion used for its
+*                  compensation, e.g. 22.8 ms at H12_T14.
+*/
+uint32_t conversion_time_Si7021(Si7021_t* dev, Si7021_measurement_type_t type);
+
+/************************************************************************************************
+* NAME :            float code_to_humidity_Si7021(uint16_t code)
+*                   float code_to_temperature_Si7021(uint16_t code)
+*
+* DESCRIPTION :     Convert a raw measurement code to relative humidity in % or to temperature
+*                   in degree Celsius.
+*
+* INPUTS :
+*       PARAMETERS:
+*            uint16_t                       code      raw measurement code
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   float
+*            Values: <value>                humidity (limited to 0 ... 100 %) or temperature
+*
+* NOTES :
+*/
+float code_to_humidity_Si7021(uint16_t code);
+float code_to_temperature_Si7021(uint16_t code);
+
+/************************************************************************************************
+* NAME :            int8_t r_both_Si7021(Si7021_t* dev, float* humidity, float* temperature)
 *
 * DESCRIPTION :     Initiates a humidity measurement and -as each time a relative humidity measurement
 *                   is made a temperature measurement is also made- it returns both the humidity and 
@@ -142,7 +785,7 @@ int8_t r_single_Si7021(float* data, Si7021_measurement_type_t type);
 *
 * INPUTS :
 *       PARAMETERS:
-*            None
+*            Si7021_t*                      dev       sensor handle
 *       GLOBALS :
 *            None
 * OUTPUTS :
@@ -162,16 +805,128 @@ int8_t r_single_Si7021(float* data, Si7021_measurement_type_t type);
 *                  measurement and to read back the result.
 *                   
 */
-int8_t r_both_Si7021(float* humidity, float* temperature);
+int8_t r_both_Si7021(Si7021_t* dev, float* humidity, float* temperature);
+
+/************************************************************************************************
+* NAME :            int8_t r_sample_Si7021(Si7021_t* dev, Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Measures humidity and temperature like r_both_Si7021 but returns the raw codes
+*                   with the time of the measurement, and publishes the result as the latest
+*                   sample of the sensor (see latest_Si7021).
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_sample_t*               sample    the new sample
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error
+*
+* NOTES :          A failed measurement is published too, with status -1 and the codes of the
+*                  previous sample. r_both_Si7021 publishes its result the same way, its times
+*                  can be read by latest_Si7021. See conversion_times_Si7021 for the accuracy
+*                  of 'start_us' and 'end_us'.
+*/
+int8_t r_sample_Si7021(Si7021_t* dev, Si7021_sample_t* sample);
+
+/************************************************************************************************
+* NAME :            int8_t latest_Si7021(Si7021_t* dev, Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Returns the latest published sample of the sensor without bus access and
+*                   without locking, so it can be called by any number of tasks.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_sample_t*               sample    copy of the latest sample
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     the latest measurement failed or there was none yet
+*
+* NOTES :          The snapshot is protected by a sequence counter (seqlock): a reader which
+*                  overlaps with an update retries, so it never sees a partially written sample.
+*                  Do not call it from an interrupt that may preempt the writer.
+*/
+int8_t latest_Si7021(Si7021_t* dev, Si7021_sample_t* sample);
 
 /************************************************************************************************
-* NAME :            int8_t set_resolution_Si7021(Si7021_resolution_t resolution)
+* NAME :            int8_t r_latest_Si7021(Si7021_t* dev, uint32_t max_age, Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Returns the latest sample if it is not older than 'max_age', otherwise
+*                   measures a new one. Tasks asking at the same time for an outdated sample
+*                   share one measurement: the first one measures, the others get its result.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*            uint32_t                       max_age   maximum age of the sample in ms
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_sample_t*               sample    the sample
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error
+*
+* NOTES :          Without the now_ms function of the bus the age of a sample is unknown, so
+*                  it measures on each call. Tasks waiting for the bus still share a sample.
+*/
+int8_t r_latest_Si7021(Si7021_t* dev, uint32_t max_age, Si7021_sample_t* sample);
+
+/************************************************************************************************
+* NAME :            void conversion_times_Si7021(Si7021_t* dev, uint32_t* start_us,
+*                                                uint32_t* end_us)
+*
+* DESCRIPTION :     Returns the start and completion time of the last conversion read from the
+*                   sensor by any function, e.g. r_single_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            uint32_t*                      start_us  conversion start in us (bus now_us)
+*            uint32_t*                      end_us    conversion done at or before, in us
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          Both are 0 before the first conversion. In Hold Master Mode the times are
+*                  taken before and after the transfer, so the start is early by the command
+*                  (about 0.2 ms at 100 kHz) and the end is late by the result bytes.
+*/
+void conversion_times_Si7021(Si7021_t* dev, uint32_t* start_us, uint32_t* end_us);
+
+/************************************************************************************************
+* NAME :            int8_t set_resolution_Si7021(Si7021_t* dev, Si7021_resolution_t resolution)
 *
 * DESCRIPTION :     Sets the relative humidity and temperature measurements' resolution to
 *                   the one defined by the 'resolution' parameter.
 *
 * INPUTS :
 *       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
 *            Si7021_resolution_t            resolution    resolution value to be set
 *       GLOBALS :
 *            None
@@ -185,21 +940,21 @@ int8_t r_both_Si7021(float* humidity, float* temperature);
 *            Values:  0                     OK
 *                    -1                     I2C error or invalid resolution parameter
 *
-* NOTES :          
-*                   
+* NOTES :          The register is not written if the local copy already holds the requested
+*                  value, see config_commit_Si7021.
 */
-int8_t set_resolution_Si7021(Si7021_resolution_t resolution);
+int8_t set_resolution_Si7021(Si7021_t* dev, Si7021_resolution_t resolution);
 
 
 /************************************************************************************************
-* NAME :            Si7021_resolution_t r_resolution_Si7021(void)
+* NAME :            Si7021_resolution_t r_resolution_Si7021(Si7021_t* dev)
 *
 * DESCRIPTION :     Reads back and returns the current relative humidity
 *                   and temperature measurements' resolution.
 *
 * INPUTS :
 *       PARAMETERS:
-*            None
+*            Si7021_t*                      dev       sensor handle
 *       GLOBALS :
 *            None
 * OUTPUTS :
@@ -218,16 +973,17 @@ int8_t set_resolution_Si7021(Si7021_resolution_t resolution);
 * NOTES :          
 *                   
 */
-Si7021_resolution_t r_resolution_Si7021(void);
+Si7021_resolution_t r_resolution_Si7021(Si7021_t* dev);
 
 /************************************************************************************************
-* NAME :            int8_t set_heater_current_Si7021(uint8_t current)
+* NAME :            int8_t set_heater_current_Si7021(Si7021_t* dev, uint8_t current)
 *
 * DESCRIPTION :     Sets the current of the on-chip heater to the value passed
 *                   by 'current' parameter. Values are in mA.
 *
 * INPUTS :
 *       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
 *            uint8_t                        current       current in mA
 *       GLOBALS :
 *            None
@@ -247,17 +1003,19 @@ Si7021_resolution_t r_resolution_Si7021(void);
 *                  Generally values are always rounded down. For example a
 *                  parameter value of 14 mA will result the heater current to be set to
 *                  9 mA even though the closest valid step is 15 mA.
+*                  The register is not written if the local copy already holds the requested
+*                  value, see config_commit_Si7021.
 */
-int8_t set_heater_current_Si7021(uint8_t current);
+int8_t set_heater_current_Si7021(Si7021_t* dev, uint8_t current);
 
 /************************************************************************************************
-* NAME :            int8_t r_heater_current_Si7021(void)
+* NAME :            int8_t r_heater_current_Si7021(Si7021_t* dev)
 *
 * DESCRIPTION :     Reads back and returns in mA the current setting of the on-chip heater.
 *
 * INPUTS :
 *       PARAMETERS:
-*            None
+*            Si7021_t*                      dev       sensor handle
 *       GLOBALS :
 *            None
 * OUTPUTS :
@@ -272,15 +1030,16 @@ int8_t set_heater_current_Si7021(uint8_t current);
 *
 * NOTES :          Values are in mA and VDD assumed to be 3.3 V.
 */
-int8_t r_heater_current_Si7021(void);
+int8_t r_heater_current_Si7021(Si7021_t* dev);
 
 /************************************************************************************************
-* NAME :            int8_t enable_heater_Si7021(uint8_t val)
+* NAME :            int8_t enable_heater_Si7021(Si7021_t* dev, uint8_t val)
 *
 * DESCRIPTION :     Enables or disables the on-chip heater. 
 *
 * INPUTS :
 *       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
 *            uint8_t                        val      value of '0' means disable
 *                                                    every other means enable
 *       GLOBALS :
@@ -295,18 +1054,19 @@ int8_t r_heater_current_Si7021(void);
 *            Values:  0                     OK
 *                    -1                     I2C error
 *
-* NOTES :
+* NOTES :          The register is not written if the local copy already holds the requested
+*                  value, see config_commit_Si7021.
 */
-int8_t enable_heater_Si7021(uint8_t val);
+int8_t enable_heater_Si7021(Si7021_t* dev, uint8_t val);
 
 /************************************************************************************************
-* NAME :            int8_t rst_Si7021(void)
+* NAME :            int8_t rst_Si7021(Si7021_t* dev)
 *
 * DESCRIPTION :     Initiates a Si7021 software reset by the appropriate command. 
 *
 * INPUTS :
 *       PARAMETERS:
-*            None
+*            Si7021_t*                      dev       sensor handle
 *       GLOBALS :
 *            None
 * OUTPUTS :
@@ -319,17 +1079,19 @@ int8_t enable_heater_Si7021(uint8_t val);
 *            Values:  0                     OK
 *                    -1                     I2C error
 *
-* NOTES :
+* NOTES :          The local register copies are set to their reset values. The sensor needs
+*                  SI7021_RESET_TIME_MS until it accepts commands again.
 */
-int8_t rst_Si7021(void);
+int8_t rst_Si7021(Si7021_t* dev);
 
 /************************************************************************************************
-* NAME :            int8_t get_register(Si7021_registers_t reg, uint8_t* rv)
+* NAME :            int8_t get_register(Si7021_t* dev, Si7021_registers_t reg, uint8_t* rv)
 *
 * DESCRIPTION :     Returns the value of the selected register. 
 *
 * INPUTS :
 *       PARAMETERS:
+*            Si7021_t*                      dev       sensor handle
 *            Si7021_registers_t             reg        register to be queried
 *       GLOBALS :
 *            None
@@ -346,6 +1108,6 @@ int8_t rst_Si7021(void);
 *
 * NOTES :
 */
-int8_t get_register(Si7021_registers_t reg, uint8_t* rv);
+int8_t get_register(Si7021_t* dev, Si7021_registers_t reg, uint8_t* rv);
 
 #endif /* SI7021_H_ */
@@ -0,0 +1,142 @@
+#ifndef SI7021_FILTER_H_
+#define SI7021_FILTER_H_
+
+#include "Si7021_driver.h"
+
+#define SI7021_FILTER_MAX_WINDOW  255
+#define SI7021_FILTER_MAX_SHIFT   15
+
+/* number of uint16_t elements of storage needed by a filter */
+#define SI7021_FILTER_STORAGE(type, window) \
+  ((type) == Filter_Median ? 2 * (window) : ((type) == Filter_Mean ? (window) : 0))
+
+typedef enum Si7021_filter_type
+{
+  Filter_Mean,                     // moving average of the last 'window' values
+  Filter_Median,                   // moving median of the last 'window' values
+  Filter_EMA                       // exponential moving average, alpha = 2^-shift
+}Si7021_filter_type_t;
+
+typedef struct Si7021_filter
+{
+  Si7021_filter_type_t type;
+  uint16_t*            history;    // last values in order of arrival (mean, median)
+  uint16_t*            sorted;     // last values in ascending order (median)
+  uint8_t              window;     // window length, or shift of the EMA
+  uint8_t              count;      // number of values in the window
+  uint8_t              head;       // index of the oldest value in 'history'
+  uint32_t             acc;        // sum of the window, or EMA state scaled by 2^shift
+}Si7021_filter_t;
+
+/************************************************************************************************
+* NAME :            int8_t filter_init_Si7021(Si7021_filter_t* filter, Si7021_filter_type_t type,
+*                                             uint8_t window, uint16_t* storage)
+*
+* DESCRIPTION :     Initialises a filter of raw codes or unsigned fixed-point values. Every
+*                   filter updates in constant time per value, except the median which moves
+*                   at most 'window' elements of a sorted copy of the window.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_filter_t*      filter   filter to be initialised
+*            Si7021_filter_type_t  type     Filter_Mean, Filter_Median or Filter_EMA
+*            uint8_t               window   number of values averaged (Filter_Mean,
+*                                           Filter_Median), or the smoothing shift of the EMA,
+*                                           alpha = 1 / 2^window (0..SI7021_FILTER_MAX_SHIFT)
+*            uint16_t*             storage  SI7021_FILTER_STORAGE(type, window) elements,
+*                                           it must remain valid while the filter is used;
+*                                           may be NULL for Filter_EMA
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     invalid type, window or storage
+*
+* NOTES :          Signed fixed-point values shall be offset (e.g. by 0x8000) before filtering.
+*/
+int8_t filter_init_Si7021(Si7021_filter_t* filter, Si7021_filter_type_t type, uint8_t window,
+                          uint16_t* storage);
+
+/************************************************************************************************
+* NAME :            void filter_reset_Si7021(Si7021_filter_t* filter)
+*
+* DESCRIPTION :     Drops the values of the filter, the next value restarts it.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_filter_t*      filter   filter to be reset
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :
+*/
+void filter_reset_Si7021(Si7021_filter_t* filter);
+
+/************************************************************************************************
+* NAME :            uint16_t filter_update_Si7021(Si7021_filter_t* filter, uint16_t value)
+*
+* DESCRIPTION :     Adds a value to the filter and returns the filtered value.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_filter_t*      filter   filter
+*            uint16_t              value    new value
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   uint16_t
+*            Values: <filtered value>
+*
+* NOTES :          Until the window is full, the mean and the median are computed from the
+*                  values received so far; the median of an even count is the lower middle
+*                  value. The EMA starts from the first value.
+*/
+uint16_t filter_update_Si7021(Si7021_filter_t* filter, uint16_t value);
+
+/************************************************************************************************
+* NAME :            int8_t filter_sample_Si7021(Si7021_filter_t* humi, Si7021_filter_t* temp,
+*                                               Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Filters the codes of a sample in place, e.g. between r_sample_Si7021 and
+*                   the consumers of the sample.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_filter_t*      humi     filter of the humidity code, may be NULL
+*            Si7021_filter_t*      temp     filter of the temperature code, may be NULL
+*            Si7021_sample_t*      sample   sample to be filtered
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_sample_t*      sample   sample with filtered codes
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     failed sample, the filters are not updated
+*
+* NOTES :          A NULL filter leaves its code unfiltered.
+*/
+int8_t filter_sample_Si7021(Si7021_filter_t* humi, Si7021_filter_t* temp, Si7021_sample_t* sample);
+
+#endif
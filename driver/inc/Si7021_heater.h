@@ -0,0 +1,141 @@
+#ifndef SI7021_HEATER_H_
+#define SI7021_HEATER_H_
+
+#include "Si7021_driver.h"
+
+typedef struct Si7021_heater_pulse
+{
+  uint8_t  current;                    // heater current in mA, see set_heater_current_Si7021
+  uint32_t on_time;                    // heating time in ms
+  uint32_t cool_time;                  // cool-down time after the pulse in ms
+}Si7021_heater_pulse_t;
+
+typedef struct Si7021_heater
+{
+  Si7021_t*                    dev;    // sensor heated
+  const Si7021_heater_pulse_t* profile; // pulses of the running profile
+  uint8_t                      length; // number of pulses in the profile
+  uint8_t                      index;  // pulse being executed
+  uint8_t                      state;  // internal
+  uint32_t                     next;   // time of the next step in ms
+  uint32_t                     pulses; // number of finished pulses
+  uint32_t                     failed; // number of failed register writes
+}Si7021_heater_t;
+
+/************************************************************************************************
+* NAME :            void heater_init_Si7021(Si7021_heater_t* heater, Si7021_t* dev)
+*
+* DESCRIPTION :     Initialises a heater scheduler of a sensor.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_heater_t*      heater   scheduler to be initialised
+*            Si7021_t*             dev      sensor handle
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :
+*/
+void heater_init_Si7021(Si7021_heater_t* heater, Si7021_t* dev);
+
+/************************************************************************************************
+* NAME :            int8_t heater_start_Si7021(Si7021_heater_t* heater,
+*                                              const Si7021_heater_pulse_t* profile,
+*                                              uint8_t length, uint32_t now)
+*
+* DESCRIPTION :     Starts a heater profile: each pulse sets the heater current, enables the
+*                   heater for its on time and then waits for its cool-down time. The profile
+*                   is executed by heater_poll_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_heater_t*      heater   scheduler
+*            Si7021_heater_pulse_t* profile pulses, shall be valid until the profile is over
+*            uint8_t               length   number of pulses
+*            uint32_t              now      current time in ms, the first pulse starts at it
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     a profile is running or the profile is empty
+*
+* NOTES :
+*/
+int8_t heater_start_Si7021(Si7021_heater_t* heater, const Si7021_heater_pulse_t* profile,
+                           uint8_t length, uint32_t now);
+
+/************************************************************************************************
+* NAME :            int8_t heater_stop_Si7021(Si7021_heater_t* heater)
+*
+* DESCRIPTION :     Aborts the running profile and disables the heater. The samples are not
+*                   tagged as cooling down after the abort.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_heater_t*      heater   scheduler
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error, the heater may still be on
+*
+* NOTES :
+*/
+int8_t heater_stop_Si7021(Si7021_heater_t* heater);
+
+/************************************************************************************************
+* NAME :            int8_t heater_poll_Si7021(Si7021_heater_t* heater, uint32_t now,
+*                                             uint32_t* wake)
+*
+* DESCRIPTION :     Executes the steps of the running profile that are due: switching the
+*                   heater on or off and ending the cool-down. Only register writes are done,
+*                   the function does not wait.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_heater_t*      heater   scheduler
+*            uint32_t              now      current time in ms
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            uint32_t*             wake     time of the next step in ms, not changed if no
+*                                           profile is running, may be NULL
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  1                     a profile is running
+*                     0                     no profile is running
+*                    -1                     I2C error, the step is retried 1 ms later
+*
+* NOTES :          The steps are timed from the start of the profile, so a late poll does not
+*                  shift the rest of the profile. Samples measured while the heater is on are
+*                  flagged SI7021_SAMPLE_HEATED by the driver, samples of the cool-down
+*                  SI7021_SAMPLE_COOLING. The switch and the flag change under one bus lock,
+*                  so a sample of another thread is never measured untagged during the
+*                  profile. The register writes fail while a No Hold Master conversion of the
+*                  sensor is in progress.
+*/
+int8_t heater_poll_Si7021(Si7021_heater_t* heater, uint32_t now, uint32_t* wake);
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef SI7021_HISTORY_H_
+#define SI7021_HISTORY_H_
+
+#include "Si7021_driver.h"
+
+#define SI7021_HISTORY_BLOCK_DATA  51  // encoded bytes of a block, 64 bytes with the header
+
+typedef struct Si7021_history_block
+{
+  uint32_t timestamp;                  // first sample of the block, stored as it is
+  uint16_t code[2];
+  uint16_t count;                      // number of samples in the block
+  uint8_t  shift;                      // zero low bits of the humidity (7:4) and temperature
+                                       // (3:0) codes, not stored in the deltas
+  uint8_t  nibbles;                    // number of used nibbles of 'data'
+  uint8_t  resolution;                 // resolution of the samples of the block
+  uint8_t  data[SI7021_HISTORY_BLOCK_DATA]; // deltas of the following samples
+}Si7021_history_block_t;
+
+typedef struct Si7021_history
+{
+  Si7021_history_block_t* blocks;      // ring of blocks
+  uint16_t size;                       // number of blocks
+  uint16_t first;                      // oldest block
+  uint16_t used;                       // number of blocks in use
+  uint32_t first_seq;                  // sequence number of the oldest stored sample
+  uint32_t next_seq;                   // sequence number of the next sample
+  uint32_t last_time;                  // last appended sample, delta base of the next one
+  uint32_t last_interval;
+  uint16_t last_code[2];
+}Si7021_history_t;
+
+typedef struct Si7021_history_cursor
+{
+  uint32_t seq;                        // sequence number of the next sample read
+  uint16_t block;                      // block of the next sample
+  uint16_t index;                      // index of the next sample in the block
+  uint8_t  nibble;                     // position of the next sample in the block data
+  uint32_t time;                       // previous sample, delta base of the next one
+  uint32_t interval;
+  uint16_t code[2];
+}Si7021_history_cursor_t;
+
+/************************************************************************************************
+* NAME :            int8_t history_init_Si7021(Si7021_history_t* history,
+*                                              Si7021_history_block_t* blocks, uint16_t size)
+*
+* DESCRIPTION :     Initialises a compressed history of the samples of a sensor. Samples are
+*                   stored in fixed size blocks as delta-of-delta timestamps and code deltas,
+*                   zigzag encoded in variable length nibbles, so a sample of a slowly changing
+*                   environment takes about 2.5 bytes instead of 8 (two floats).
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_history_t*     history  history to be initialised
+*            Si7021_history_block_t* blocks storage of the history
+*            uint16_t              size     number of blocks
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     no blocks
+*
+* NOTES :          When the blocks are full, the oldest block is overwritten.
+*/
+int8_t history_init_Si7021(Si7021_history_t* history, Si7021_history_block_t* blocks, uint16_t size);
+
+/************************************************************************************************
+* NAME :            int8_t history_append_Si7021(Si7021_history_t* history,
+*                                                const Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Appends a sample to the history in bounded time.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_history_t*     history  history
+*            Si7021_sample_t*      sample   sample e.g. from r_sample_Si7021
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     failed sample, not stored
+*
+* NOTES :          Timestamps shall not decrease. Samples are numbered from 0 in the order
+*                  of appending. Not reentrant: a history appended in one context and read in
+*                  another shall be accessed under a lock shared by both, e.g. lock_bus_Si7021
+*                  of the sensor; a reader may release it between two samples.
+*/
+int8_t history_append_Si7021(Si7021_history_t* history, const Si7021_sample_t* sample);
+
+/************************************************************************************************
+* NAME :            int8_t history_seek_Si7021(const Si7021_history_t* history,
+*                                              Si7021_history_cursor_t* cursor, uint32_t seq)
+*
+* DESCRIPTION :     Positions a cursor to a sample of the history to read the samples from it
+*                   by history_next_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_history_t*     history  history
+*            uint32_t              seq      sequence number of the first sample to be read,
+*                                           older samples than the stored ones start from the
+*                                           oldest stored sample
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_history_cursor_t* cursor  cursor
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     no sample with the given or a greater number
+*
+* NOTES :          The sequence number of the first sample read is in 'seq' of the cursor.
+*/
+int8_t history_seek_Si7021(const Si7021_history_t* history, Si7021_history_cursor_t* cursor,
+                           uint32_t seq);
+
+/************************************************************************************************
+* NAME :            int8_t history_next_Si7021(const Si7021_history_t* history,
+*                                              Si7021_history_cursor_t* cursor,
+*                                              Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Reads the sample at the cursor and moves the cursor to the next sample.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_history_t*     history  history
+*            Si7021_history_cursor_t* cursor  cursor set by history_seek_Si7021
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_sample_t*      sample   decoded sample
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     no more samples, or the sample at the cursor has
+*                                           been overwritten since the seek
+*
+* NOTES :          Samples appended after the seek are read as well. After an overwrite, a new
+*                  seek continues at the oldest sample. The sample flags and the conversion
+*                  times are not stored, they are 0.
+*/
+int8_t history_next_Si7021(const Si7021_history_t* history, Si7021_history_cursor_t* cursor,
+                           Si7021_sample_t* sample);
+
+#endif
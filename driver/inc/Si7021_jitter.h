@@ -0,0 +1,100 @@
+#ifndef SI7021_JITTER_H_
+#define SI7021_JITTER_H_
+
+#include "Si7021_driver.h"
+
+#define SI7021_JITTER_BINS     16      // bins of the period histogram
+
+typedef struct Si7021_jitter
+{
+  uint32_t period;                     // nominal sampling period in us
+  uint32_t bin_width;                  // width of a histogram bin in us
+  uint32_t bins[SI7021_JITTER_BINS];   // number of periods by deviation, see jitter_init_Si7021
+  uint32_t count;                      // number of periods measured
+  int32_t  min_dev;                    // shortest period - 'period' in us
+  int32_t  max_dev;                    // longest period - 'period' in us
+  int64_t  sum_dev;                    // sum of the deviations in us
+  uint32_t max_conversion;             // longest end_us - start_us of a sample in us
+  uint32_t last_start;                 // start_us of the previous sample
+  uint8_t  started;                    // the previous sample is valid
+}Si7021_jitter_t;
+
+/************************************************************************************************
+* NAME :            void jitter_init_Si7021(Si7021_jitter_t* jit, uint32_t period,
+*                                           uint32_t bin_width)
+*
+* DESCRIPTION :     Initialises the jitter measurement of a sensor sampled with the nominal
+*                   'period'. Bin i of the histogram counts the periods deviating from 'period'
+*                   by (i - SI7021_JITTER_BINS / 2) * bin_width ... + bin_width - 1 us, the first
+*                   and the last bin also count the periods beyond.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_jitter_t*      jit      jitter measurement to be initialised
+*            uint32_t              period   nominal sampling period in us
+*            uint32_t              bin_width width of a histogram bin in us, at least 1
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          Also used to restart the measurement.
+*/
+void jitter_init_Si7021(Si7021_jitter_t* jit, uint32_t period, uint32_t bin_width);
+
+/************************************************************************************************
+* NAME :            void jitter_add_Si7021(Si7021_jitter_t* jit, const Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Adds the period between the conversion start of the previous sample and of
+*                   this one to the histogram, and the conversion time of the sample to
+*                   'max_conversion'.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_jitter_t*      jit      jitter measurement
+*            Si7021_sample_t*      sample   every sample of the sensor, e.g. from
+*                                           r_sample_Si7021 or fetch_sample_Si7021
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          A failed sample ends the series, the period up to the next sample is not
+*                  counted. The precision is that of the now_us function of the bus.
+*/
+void jitter_add_Si7021(Si7021_jitter_t* jit, const Si7021_sample_t* sample);
+
+/************************************************************************************************
+* NAME :            uint32_t jitter_max_Si7021(const Si7021_jitter_t* jit)
+*
+* DESCRIPTION :     Returns the largest deviation of a period from the nominal period.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_jitter_t*      jit      jitter measurement
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   uint32_t
+*            Values: <deviation>            in us, 0 if no period was measured
+*
+* NOTES :          The mean deviation is sum_dev / count.
+*/
+uint32_t jitter_max_Si7021(const Si7021_jitter_t* jit);
+
+#endif /* SI7021_JITTER_H_ */
@@ -0,0 +1,84 @@
+#ifndef SI7021_PORT_FREERTOS_H_
+#define SI7021_PORT_FREERTOS_H_
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+#include "Si7021_driver.h"
+#include "Si7021_power.h"
+
+/************************************************************************************************
+* NAME :            int8_t Si7021_freertos_lock_init(Si7021_bus_t* bus)
+*
+* DESCRIPTION :     Creates a recursive mutex for the bus and sets the FreeRTOS lock functions.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_bus_t*         bus      bus to be protected
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     the mutex could not be created
+*
+* NOTES :          Requires configUSE_RECURSIVE_MUTEXES. Shall be called before the scheduler
+*                  starts or before any task uses the bus.
+*/
+int8_t Si7021_freertos_lock_init(Si7021_bus_t* bus);
+
+/************************************************************************************************
+* NAME :            void Si7021_freertos_lock(void* mutex)
+*                   void Si7021_freertos_unlock(void* mutex)
+*
+* DESCRIPTION :     Lock functions of the FreeRTOS port, see Si7021_lock_t.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                 mutex    SemaphoreHandle_t of a recursive mutex
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :
+*/
+void Si7021_freertos_lock(void* mutex);
+void Si7021_freertos_unlock(void* mutex);
+
+/************************************************************************************************
+* NAME :            void Si7021_freertos_sleep(void* ctx, uint32_t ms)
+*
+* DESCRIPTION :     Sleep function of the FreeRTOS port, see Si7021_sleep_t. Delays the calling
+*                   task, the idle task may put the MCU into a low power state.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                 ctx      not used
+*            uint32_t              ms       time to sleep in ms
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          Saves power with configUSE_TICKLESS_IDLE only. The delay is rounded up to
+*                  whole ticks.
+*/
+void Si7021_freertos_sleep(void* ctx, uint32_t ms);
+
+#endif /* SI7021_PORT_FREERTOS_H_ */
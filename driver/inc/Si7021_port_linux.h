@@ -0,0 +1,129 @@
+#ifndef SI7021_PORT_LINUX_H_
+#define SI7021_PORT_LINUX_H_
+
+#include "Si7021_driver.h"
+
+/* Bus initialiser for an opened i2c-dev adapter without multiplexer, e.g.
+   Si7021_linux_i2c_t i2c1;
+   Si7021_bus_t bus1 = SI7021_LINUX_BUS(&i2c1); */
+#define SI7021_LINUX_BUS(i2c)   {.transfer = Si7021_linux_transfer,                         \
+                                 .delay_ms = Si7021_linux_delay_ms,                         \
+                                 .now_ms = Si7021_linux_now_ms,                             \
+                                 .now_us = Si7021_linux_now_us, .ctx = (i2c),               \
+                                 .active_channel = SI7021_NO_CHANNEL}
+
+typedef struct Si7021_linux_i2c
+{
+  int      fd;                         // file descriptor of /dev/i2c-N
+  uint32_t ioctls;                     // number of I2C_RDWR calls
+  uint32_t errors;                     // number of failed I2C_RDWR calls
+}Si7021_linux_i2c_t;
+
+/************************************************************************************************
+* NAME :            int8_t Si7021_linux_open(Si7021_linux_i2c_t* i2c, const char* device)
+*
+* DESCRIPTION :     Opens an i2c-dev adapter, e.g. "/dev/i2c-1".
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_linux_i2c_t*   i2c      adapter to be opened
+*            const char*           device   path of the device node
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     the device could not be opened or the adapter does
+*                                           not support combined transfers (I2C_FUNC_I2C)
+*
+* NOTES :          Requires the i2c-dev kernel module and access rights to the device node.
+*/
+int8_t Si7021_linux_open(Si7021_linux_i2c_t* i2c, const char* device);
+
+/************************************************************************************************
+* NAME :            void Si7021_linux_close(Si7021_linux_i2c_t* i2c)
+*
+* DESCRIPTION :     Closes an i2c-dev adapter.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_linux_i2c_t*   i2c      adapter to be closed
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :
+*/
+void Si7021_linux_close(Si7021_linux_i2c_t* i2c);
+
+/************************************************************************************************
+* NAME :            int8_t Si7021_linux_transfer(void* ctx, uint16_t addr,
+*                                                Si7021_msg_t* msgs, uint8_t count)
+*
+* DESCRIPTION :     Bus transfer function of the Linux port, see Si7021_transfer_t. All the
+*                   messages are executed by a single I2C_RDWR ioctl: one system call and one
+*                   bus transaction with repeated starts, e.g. a whole r_sample_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                 ctx      pointer to an opened Si7021_linux_i2c_t
+*            uint16_t              addr     7 bit I2C address of the device
+*            Si7021_msg_t*         msgs     array of messages
+*            uint8_t               count    number of messages, at most 42
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error
+*                    SI7021_NACK            the device did not acknowledge (ENXIO, EREMOTEIO)
+*
+* NOTES :          Hold Master Mode needs an adapter that supports clock stretching for the
+*                  conversion time; on adapters that do not, use the No Hold Master functions.
+*/
+int8_t Si7021_linux_transfer(void* ctx, uint16_t addr, Si7021_msg_t* msgs, uint8_t count);
+
+/************************************************************************************************
+* NAME :            void Si7021_linux_delay_ms(uint32_t ms)
+*                   uint32_t Si7021_linux_now_ms(void)
+*                   uint32_t Si7021_linux_now_us(void)
+*
+* DESCRIPTION :     Delay and monotonic time (CLOCK_MONOTONIC) functions of the Linux port.
+*
+* INPUTS :
+*       PARAMETERS:
+*            uint32_t              ms       time to sleep in ms
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   uint32_t
+*            Values: <time>                 ms or us since an arbitrary start, wraps around
+*
+* NOTES :          Use the pthread port for the bus lock.
+*/
+void Si7021_linux_delay_ms(uint32_t ms);
+uint32_t Si7021_linux_now_ms(void);
+uint32_t Si7021_linux_now_us(void);
+
+#endif /* SI7021_PORT_LINUX_H_ */
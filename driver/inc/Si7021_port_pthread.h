@@ -0,0 +1,58 @@
+#ifndef SI7021_PORT_PTHREAD_H_
+#define SI7021_PORT_PTHREAD_H_
+
+#include <pthread.h>
+#include "Si7021_driver.h"
+
+/************************************************************************************************
+* NAME :            int8_t Si7021_pthread_lock_init(Si7021_bus_t* bus, pthread_mutex_t* mutex)
+*
+* DESCRIPTION :     Initialises a recursive pthread mutex for the bus and sets the pthread lock
+*                   functions. Intended for host builds (Linux, simulators).
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_bus_t*         bus      bus to be protected
+*            pthread_mutex_t*      mutex    mutex to be used, it must remain valid while the
+*                                           bus is in use
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     the mutex could not be initialised
+*
+* NOTES :
+*/
+int8_t Si7021_pthread_lock_init(Si7021_bus_t* bus, pthread_mutex_t* mutex);
+
+/************************************************************************************************
+* NAME :            void Si7021_pthread_lock(void* mutex)
+*                   void Si7021_pthread_unlock(void* mutex)
+*
+* DESCRIPTION :     Lock functions of the pthread port, see Si7021_lock_t.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                 mutex    pointer to a recursive pthread_mutex_t
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :
+*/
+void Si7021_pthread_lock(void* mutex);
+void Si7021_pthread_unlock(void* mutex);
+
+#endif /* SI7021_PORT_PTHREAD_H_ */
@@ -0,0 +1,98 @@
+#ifndef SI7021_PORT_STM32_H_
+#define SI7021_PORT_STM32_H_
+
+#include "stm32f4xx_hal.h"
+#include "Si7021_driver.h"
+#include "Si7021_power.h"
+
+/* Bus initialiser for a HAL I2C handle without multiplexer, e.g.
+   Si7021_bus_t bus1 = SI7021_STM32_BUS(&hi2c1); */
+#define SI7021_STM32_BUS(hi2c)  {.transfer = Si7021_stm32_transfer, .delay_ms = HAL_Delay, \
+                                 .now_ms = HAL_GetTick, .now_us = Si7021_stm32_now_us,    \
+                                 .ctx = (hi2c), .active_channel = SI7021_NO_CHANNEL}
+
+/************************************************************************************************
+* NAME :            int8_t Si7021_stm32_transfer(void* ctx, uint16_t addr,
+*                                                Si7021_msg_t* msgs, uint8_t count)
+*
+* DESCRIPTION :     Bus transfer function of the STM32 HAL port, see Si7021_transfer_t.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                 ctx      pointer to the I2C_HandleTypeDef of the bus
+*            uint16_t              addr     7 bit I2C address of the device
+*            Si7021_msg_t*         msgs     array of messages
+*            uint8_t               count    number of messages
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error
+*
+* NOTES :          The blocking HAL API has no call for arbitrary message sequences, so a write
+*                  of 1 or 2 bytes followed by a read is done by HAL_I2C_Mem_Read (repeated
+*                  start) and any other message is a transaction of its own.
+*/
+int8_t Si7021_stm32_transfer(void* ctx, uint16_t addr, Si7021_msg_t* msgs, uint8_t count);
+
+/************************************************************************************************
+* NAME :            void Si7021_stm32_sleep(void* ctx, uint32_t ms)
+*
+* DESCRIPTION :     Sleep function of the STM32 HAL port, see Si7021_sleep_t. The core is put
+*                   into Sleep mode (WFI) until 'ms' HAL ticks have elapsed.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                 ctx      not used
+*            uint32_t              ms       time to sleep in ms
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          The HAL tick interrupt wakes the core every ms. Stop mode saves more but
+*                  needs a wake-up timer of the application (LPTIM or RTC).
+*/
+void Si7021_stm32_sleep(void* ctx, uint32_t ms);
+
+/************************************************************************************************
+* NAME :            uint32_t Si7021_stm32_now_us(void)
+*
+* DESCRIPTION :     High resolution time function of the STM32 HAL port (now_us of the bus).
+*                   The HAL tick in us plus the part of the tick counted by SysTick.
+*
+* INPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   uint32_t
+*            Values: <time>                 us since the start of the HAL tick, wraps around
+*                                           with HAL_GetTick() * 1000
+*
+* NOTES :          Needs no calls in between, so it is exact after any idle time. A tick that
+*                  elapses while the tick interrupt is masked is counted once; longer masking
+*                  loses time like HAL_GetTick. The SysTick shall run the HAL tick, e.g. not
+*                  with a FreeRTOS tick on SysTick and the HAL tick on another timer. Any
+*                  Cortex-M, the resolution is 1 us.
+*/
+uint32_t Si7021_stm32_now_us(void);
+
+#endif /* SI7021_PORT_STM32_H_ */
@@ -0,0 +1,163 @@
+#ifndef SI7021_POWER_H_
+#define SI7021_POWER_H_
+
+#include "Si7021_driver.h"
+
+/* Typical currents of the datasheet, 4.7k pull-ups at 3.3 V, 100 kHz bus and an STM32 at
+   16 MHz running or in Sleep mode (WFI) as Si7021_stm32_sleep; set about 5 uA for Stop mode */
+#define SI7021_ENERGY_MODEL_DEFAULT  {.rh_current = 150, .temp_current = 90,            \
+                                      .standby_current = 60, .pullup_current = 700,     \
+                                      .bus_clock = 100, .run_current = 3000,            \
+                                      .sleep_current = 1000}
+
+typedef enum Si7021_acquisition
+{
+  Acquire_Hold_Master,               // r_sample_Si7021, the MCU waits in the bus transfer
+  Acquire_Sleep                      // lowpower_sample_Si7021, the MCU sleeps during conversion
+}Si7021_acquisition_t;
+
+typedef struct Si7021_energy_model
+{
+  uint16_t rh_current;               // sensor current during an RH conversion in uA
+  uint16_t temp_current;             // sensor current during a temperature conversion in uA
+  uint16_t standby_current;          // sensor standby current in nA
+  uint16_t pullup_current;           // current of a pull-up resistor while its line is low in uA
+  uint16_t bus_clock;                // I2C clock in kHz
+  uint16_t run_current;              // MCU current while running in uA
+  uint16_t sleep_current;            // MCU current while sleeping in uA
+}Si7021_energy_model_t;
+
+typedef struct Si7021_energy
+{
+  uint32_t sensor;                   // charge of the sensor incl. the heater in nC
+  uint32_t bus;                      // charge of the pull-up resistors in nC
+  uint32_t mcu;                      // charge of the MCU in nC
+  uint32_t total;                    // sum of the above in nC
+  uint32_t active;                   // time from the start to the end of the measurement in us
+}Si7021_energy_t;
+
+/************************************************************************************************
+* NAME :            void (*Si7021_sleep_t)(void* ctx, uint32_t ms)
+*
+* DESCRIPTION :     Sleep function type definition. Shall put the MCU into a low power state
+*                   for at least 'ms' milliseconds.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                 ctx      user data of the acquisition
+*            uint32_t              ms       time to sleep in ms
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          E.g. Stop mode with an LPTIM or RTC wake-up, or a task delay with a tickless
+*                  idle. The bus is not locked while sleeping.
+*/
+typedef void (*Si7021_sleep_t)(void* ctx, uint32_t ms);
+
+typedef struct Si7021_lowpower
+{
+  Si7021_t*      dev;                // sensor measured
+  Si7021_sleep_t sleep;              // sleeps during the conversion
+  void*          ctx;                // user data passed to 'sleep'
+  uint32_t       samples;            // number of samples measured
+  uint32_t       polls;              // fetches that found the conversion still in progress
+  uint32_t       slept;              // total sleep time requested in ms
+}Si7021_lowpower_t;
+
+/************************************************************************************************
+* NAME :            void lowpower_init_Si7021(Si7021_lowpower_t* lp, Si7021_t* dev,
+*                                             Si7021_sleep_t sleep, void* ctx)
+*
+* DESCRIPTION :     Initialises a low power acquisition of a sensor.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_lowpower_t*    lp       acquisition to be initialised
+*            Si7021_t*             dev      sensor handle
+*            Si7021_sleep_t        sleep    sleep function, NULL: delay_ms of the bus
+*            void*                 ctx      user data passed to the sleep function
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :
+*/
+void lowpower_init_Si7021(Si7021_lowpower_t* lp, Si7021_t* dev, Si7021_sleep_t sleep, void* ctx);
+
+/************************************************************************************************
+* NAME :            int8_t lowpower_sample_Si7021(Si7021_lowpower_t* lp, Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Measures humidity and temperature like r_sample_Si7021, but starts the
+*                   conversion by the No Hold Master Mode command and sleeps for the conversion
+*                   time of the active resolution before fetching the result.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_lowpower_t*    lp       acquisition
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_sample_t*      sample   the new sample
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     I2C error or the conversion did not finish
+*
+* NOTES :          The Hold Master Mode keeps the MCU in the bus transfer (and SCL low) for the
+*                  whole conversion, up to 22.8 ms at H12_T14. If the sensor is still converting
+*                  after the sleep, the fetch is retried every ms for a few times.
+*/
+int8_t lowpower_sample_Si7021(Si7021_lowpower_t* lp, Si7021_sample_t* sample);
+
+/************************************************************************************************
+* NAME :            void energy_estimate_Si7021(const Si7021_energy_model_t* model,
+*                                               Si7021_t* dev, Si7021_acquisition_t mode,
+*                                               uint32_t period, Si7021_energy_t* energy)
+*
+* DESCRIPTION :     Estimates the charge drawn by one sample from the currents of the model and
+*                   the state times of the sensor, the bus and the MCU. Configurations can be
+*                   compared without a current probe.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_energy_model_t* model   currents and bus clock
+*            Si7021_t*             dev      sensor handle, its resolution and heater settings
+*                                           (local register copies) are used
+*            Si7021_acquisition_t  mode     acquisition method
+*            uint32_t              period   sampling period in ms, the time after the
+*                                           measurement is spent in standby and sleep.
+*                                           0: the measurement only
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_energy_t*      energy   charge per sample by consumer
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          Maximum conversion times are used. The enabled heater is counted for the
+*                  whole period, charges above 4.29 C saturate. Multiply by the supply voltage
+*                  for the energy, divide the total by the period for the average current.
+*/
+void energy_estimate_Si7021(const Si7021_energy_model_t* model, Si7021_t* dev,
+                            Si7021_acquisition_t mode, uint32_t period, Si7021_energy_t* energy);
+
+#endif /* SI7021_POWER_H_ */
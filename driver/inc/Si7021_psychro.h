@@ -0,0 +1,166 @@
+#ifndef SI7021_PSYCHRO_H_
+#define SI7021_PSYCHRO_H_
+
+#include "Si7021_driver.h"
+
+/************************************************************************************************
+* NAME :            float dew_point_Si7021(float humidity, float temperature)
+*
+* DESCRIPTION :     Calculates the dew point by the Magnus formula
+*                   (b = 17.62, c = 243.12 C) without logf/expf calls.
+*
+* INPUTS :
+*       PARAMETERS:
+*            float                 humidity     relative humidity in %
+*            float                 temperature  temperature in C
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   float
+*            Values: <dew point in C>
+*
+* NOTES :          Humidity is limited to 0.1 .. 100 %. The difference from the Magnus formula
+*                  evaluated by logf is below 0.0001 C over -40 .. 125 C, 0.1 .. 100 %RH.
+*/
+float dew_point_Si7021(float humidity, float temperature);
+
+/************************************************************************************************
+* NAME :            float absolute_humidity_Si7021(float humidity, float temperature)
+*
+* DESCRIPTION :     Calculates the absolute humidity from the Magnus saturation vapour pressure
+*                   (6.112 hPa * exp(17.62 * T / (243.12 + T))).
+*
+* INPUTS :
+*       PARAMETERS:
+*            float                 humidity     relative humidity in %
+*            float                 temperature  temperature in C
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   float
+*            Values: <absolute humidity in g/m3>
+*
+* NOTES :          Humidity is limited to 0 .. 100 %. The relative difference from the formula
+*                  evaluated by expf is below 0.001 %.
+*/
+float absolute_humidity_Si7021(float humidity, float temperature);
+
+/************************************************************************************************
+* NAME :            float heat_index_Si7021(float humidity, float temperature)
+*
+* DESCRIPTION :     Calculates the heat index by the NWS algorithm (Steadman's simple formula,
+*                   Rothfusz regression above 80 F with the low and high humidity
+*                   adjustments).
+*
+* INPUTS :
+*       PARAMETERS:
+*            float                 humidity     relative humidity in %
+*            float                 temperature  temperature in C
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   float
+*            Values: <heat index in C>
+*
+* NOTES :          Humidity is limited to 0 .. 100 %. The regression is meaningful up to about
+*                  50 C. The difference from the algorithm evaluated in double is below 0.001 C.
+*/
+float heat_index_Si7021(float humidity, float temperature);
+
+/************************************************************************************************
+* NAME :            int16_t dew_point_fixed_Si7021(uint16_t humi_code, uint16_t temp_code)
+*
+* DESCRIPTION :     Integer version of dew_point_Si7021, calculated directly from the raw codes
+*                   of a sample.
+*
+* INPUTS :
+*       PARAMETERS:
+*            uint16_t              humi_code    raw humidity code
+*            uint16_t              temp_code    raw temperature code
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int16_t
+*            Values: <dew point in 0.01 C>
+*
+* NOTES :          The difference from the Magnus formula evaluated by logf is at most 0.02 C
+*                  over -40 .. 125 C, 0.1 .. 100 %RH, including the rounding of the result and
+*                  of the temperature to 0.01 C.
+*/
+int16_t dew_point_fixed_Si7021(uint16_t humi_code, uint16_t temp_code);
+
+/************************************************************************************************
+* NAME :            uint32_t absolute_humidity_fixed_Si7021(uint16_t humi_code, uint16_t temp_code)
+*
+* DESCRIPTION :     Integer version of absolute_humidity_Si7021, calculated directly from the
+*                   raw codes of a sample.
+*
+* INPUTS :
+*       PARAMETERS:
+*            uint16_t              humi_code    raw humidity code
+*            uint16_t              temp_code    raw temperature code
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   uint32_t
+*            Values: <absolute humidity in mg/m3>
+*
+* NOTES :          The relative difference from the formula evaluated by expf is below 0.1 %
+*                  above 1 g/m3, and below 1 mg/m3 under it.
+*/
+uint32_t absolute_humidity_fixed_Si7021(uint16_t humi_code, uint16_t temp_code);
+
+/************************************************************************************************
+* NAME :            int32_t heat_index_fixed_Si7021(uint16_t humi_code, uint16_t temp_code)
+*
+* DESCRIPTION :     Integer version of heat_index_Si7021, calculated directly from the raw codes
+*                   of a sample.
+*
+* INPUTS :
+*       PARAMETERS:
+*            uint16_t              humi_code    raw humidity code
+*            uint16_t              temp_code    raw temperature code
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int32_t
+*            Values: <heat index in 0.01 C>
+*
+* NOTES :          The difference from the NWS algorithm is at most 0.15 C up to 50 C, except
+*                  next to the switches between the simple formula, the regression and its
+*                  adjustments where the algorithm itself is discontinuous, and the rounded
+*                  inputs may fall on the other side of a switch.
+*/
+int32_t heat_index_fixed_Si7021(uint16_t humi_code, uint16_t temp_code);
+
+#endif
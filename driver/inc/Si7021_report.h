@@ -0,0 +1,173 @@
+#ifndef SI7021_REPORT_H_
+#define SI7021_REPORT_H_
+
+#include "Si7021_driver.h"
+
+/************************************************************************************************
+* NAME :            void (*Si7021_report_t)(void* ctx, const Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Report callback type definition, receives the reported samples.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                 ctx      user data of the reporter
+*            Si7021_sample_t*      sample   reported sample
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          Called from report_poll_Si7021.
+*/
+typedef void (*Si7021_report_t)(void* ctx, const Si7021_sample_t* sample);
+
+typedef struct Si7021_reporter
+{
+  Si7021_t*       dev;                 // sensor measured
+  Si7021_report_t report;              // receives the reported samples
+  void*           ctx;                 // user data passed to 'report'
+  uint16_t        humi_delta;          // change of the humidity code to be reported
+  uint16_t        temp_delta;          // change of the temperature code to be reported
+  uint32_t        heartbeat;           // longest time between reports in ms, 0: none
+  uint32_t        base_period;         // measurement period in ms
+  uint32_t        max_period;          // longest measurement period when stable
+  uint32_t        period;              // current measurement period
+  uint32_t        next;                // time of the next measurement in ms
+  Si7021_sample_t last;                // last reported sample
+  uint32_t        last_time;           // time of the last report in ms
+  uint8_t         has_last;            // a sample was reported
+  uint8_t         started;             // the first measurement was done
+  uint32_t        measured;            // number of measurements
+  uint32_t        reported;            // number of reported samples
+  uint32_t        suppressed;          // number of measurements not reported
+  uint32_t        failed;              // number of failed measurements
+}Si7021_reporter_t;
+
+/************************************************************************************************
+* NAME :            void report_init_Si7021(Si7021_reporter_t* rep, Si7021_t* dev, uint32_t period,
+*                                           Si7021_report_t report, void* ctx)
+*
+* DESCRIPTION :     Initialises a change detection reporter. The sensor is measured with the
+*                   given period and every sample is reported until a deadband is set.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_reporter_t*    rep      reporter to be initialised
+*            Si7021_t*             dev      sensor handle
+*            uint32_t              period   measurement period in ms
+*            Si7021_report_t       report   report callback
+*            void*                 ctx      user data passed to the callback
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          The first measurement is done by the first report_poll_Si7021 call.
+*/
+void report_init_Si7021(Si7021_reporter_t* rep, Si7021_t* dev, uint32_t period,
+                        Si7021_report_t report, void* ctx);
+
+/************************************************************************************************
+* NAME :            void report_set_deadband_Si7021(Si7021_reporter_t* rep, uint16_t humidity,
+*                                                   uint16_t temperature, uint32_t heartbeat)
+*
+* DESCRIPTION :     Sets the changes that are reported. A sample is reported if its humidity or
+*                   temperature differs from the last reported sample by more than the
+*                   deadband, or if no sample was reported for 'heartbeat' ms.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_reporter_t*    rep          reporter
+*            uint16_t              humidity     humidity deadband in 0.01 %
+*            uint16_t              temperature  temperature deadband in 0.01 C
+*            uint32_t              heartbeat    longest time between reports in ms,
+*                                               0 disables it
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          A deadband of 0 reports every change. It may be called while another task
+*                  polls the reporter, the settings are changed under the bus lock.
+*/
+void report_set_deadband_Si7021(Si7021_reporter_t* rep, uint16_t humidity, uint16_t temperature,
+                                uint32_t heartbeat);
+
+/************************************************************************************************
+* NAME :            void report_set_backoff_Si7021(Si7021_reporter_t* rep, uint32_t max_period)
+*
+* DESCRIPTION :     Enables sampling rate back-off. Each measurement that is not reported
+*                   doubles the measurement period up to 'max_period', a reported change
+*                   restores the base period.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_reporter_t*    rep          reporter
+*            uint32_t              max_period   longest measurement period in ms, the base
+*                                               period disables back-off
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          Reports due to the heartbeat do not restore the base period. The sensor is
+*                  measured at the heartbeat even if the period is longer. It may be called
+*                  while another task polls the reporter.
+*/
+void report_set_backoff_Si7021(Si7021_reporter_t* rep, uint32_t max_period);
+
+/************************************************************************************************
+* NAME :            int8_t report_poll_Si7021(Si7021_reporter_t* rep, uint32_t now, uint32_t* wake)
+*
+* DESCRIPTION :     Measures the sensor when the measurement is due and reports the sample if
+*                   it changed enough.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_reporter_t*    rep      reporter
+*            uint32_t              now      current time in ms
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            uint32_t*             wake     time of the next measurement in ms, may be NULL
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  1                     a sample was reported
+*                     0                     no measurement was due or it was suppressed
+*                    -1                     measurement error
+*
+* NOTES :          Call it from the main loop or a timer of one task, the caller may sleep
+*                  until 'wake'. Measurements are scheduled one period after the previous
+*                  scheduled one, so late polls do not make the period drift; after a poll
+*                  late by a whole period the missed measurements are skipped. Samples
+*                  measured during heating or heater cool-down are suppressed.
+*                  The state and the counters are updated under the bus lock of the sensor,
+*                  other tasks shall read them under lock_bus_Si7021 as well. The report
+*                  function is called without the lock.
+*/
+int8_t report_poll_Si7021(Si7021_reporter_t* rep, uint32_t now, uint32_t* wake);
+
+#endif
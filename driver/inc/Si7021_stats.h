@@ -0,0 +1,184 @@
+#ifndef SI7021_STATS_H_
+#define SI7021_STATS_H_
+
+#include "Si7021_driver.h"
+
+#define SI7021_STATS_CHANNELS  2       // humidity and temperature
+
+typedef struct Si7021_stats_slot
+{
+  uint32_t timestamp;                  // time of the sample in ms
+  uint16_t code[SI7021_STATS_CHANNELS];// humidity and temperature codes of the sample
+  uint16_t deque[2 * SI7021_STATS_CHANNELS]; // element of the min and max deques
+}Si7021_stats_slot_t;
+
+typedef struct Si7021_stats_window Si7021_stats_window_t;
+
+struct Si7021_stats_window
+{
+  uint32_t             length;         // window length in ms
+  Si7021_stats_slot_t* slots;          // samples of the window in order of arrival
+  uint16_t             capacity;       // number of slots
+  uint16_t             head;           // slot of the oldest sample
+  uint16_t             count;          // number of samples in the window
+  uint16_t             dq_head[2 * SI7021_STATS_CHANNELS];  // min, max deque of each channel
+  uint16_t             dq_count[2 * SI7021_STATS_CHANNELS];
+  uint32_t             sum[SI7021_STATS_CHANNELS];
+  uint64_t             sum_sq[SI7021_STATS_CHANNELS];
+  uint32_t             overflows;      // samples dropped before leaving the window
+  Si7021_stats_window_t* next;
+};
+
+typedef struct Si7021_stats
+{
+  Si7021_stats_window_t* windows;      // windows fed by the sensor
+}Si7021_stats_t;
+
+typedef struct Si7021_stats_result
+{
+  uint16_t count;                      // number of samples in the window
+  uint16_t min[SI7021_STATS_CHANNELS]; // lowest code, [0] humidity, [1] temperature
+  uint16_t max[SI7021_STATS_CHANNELS]; // highest code
+  uint16_t mean[SI7021_STATS_CHANNELS];// mean code
+  uint32_t variance[SI7021_STATS_CHANNELS]; // variance in code^2
+}Si7021_stats_result_t;
+
+/************************************************************************************************
+* NAME :            void stats_init_Si7021(Si7021_stats_t* stats)
+*
+* DESCRIPTION :     Initialises the statistics of a sensor without windows.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_stats_t*       stats    statistics to be initialised
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :
+*/
+void stats_init_Si7021(Si7021_stats_t* stats);
+
+/************************************************************************************************
+* NAME :            int8_t stats_add_window_Si7021(Si7021_stats_t* stats, Si7021_stats_window_t* win,
+*                                                  uint32_t length, Si7021_stats_slot_t* slots,
+*                                                  uint16_t capacity)
+*
+* DESCRIPTION :     Adds a sliding time window to the statistics, e.g. one for the last minute
+*                   and one for the last hour. Each window keeps min and max by monotonic deques
+*                   and mean and variance by running sums, so queries take constant time.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_stats_t*       stats    statistics
+*            Si7021_stats_window_t* win     window to be added, it must remain valid
+*            uint32_t              length   window length in ms
+*            Si7021_stats_slot_t*  slots    storage of the samples of the window
+*            uint16_t              capacity number of slots, at least the number of samples
+*                                           taken during 'length'
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     no slots
+*
+* NOTES :          A window uses sizeof(Si7021_stats_window_t) + capacity *
+*                  sizeof(Si7021_stats_slot_t) bytes. When the slots run out, the oldest sample
+*                  is dropped early and 'overflows' is incremented, so the window covers a
+*                  shorter time.
+*/
+int8_t stats_add_window_Si7021(Si7021_stats_t* stats, Si7021_stats_window_t* win, uint32_t length,
+                               Si7021_stats_slot_t* slots, uint16_t capacity);
+
+/************************************************************************************************
+* NAME :            void stats_add_Si7021(Si7021_stats_t* stats, const Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Feeds a sample to every window of the statistics.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_stats_t*       stats    statistics
+*            Si7021_sample_t*      sample   sample e.g. from r_sample_Si7021
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          Failed samples are ignored. Timestamps shall not decrease. Amortised
+*                  constant time per window. Not reentrant: the statistics shall be fed and
+*                  queried from one context, or under a lock shared by the feeder and the
+*                  readers, e.g. lock_bus_Si7021 of the sensor.
+*/
+void stats_add_Si7021(Si7021_stats_t* stats, const Si7021_sample_t* sample);
+
+/************************************************************************************************
+* NAME :            void stats_query_Si7021(const Si7021_stats_window_t* win, uint32_t now,
+*                                           Si7021_stats_result_t* result)
+*
+* DESCRIPTION :     Returns the statistics of the samples taken in the last 'length' ms.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_stats_window_t* win     window
+*            uint32_t              now      current time in ms
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            Si7021_stats_result_t* result  statistics of the window, only 'count' is valid
+*                                           if it is 0
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          The window is not modified: samples older than the window are left out of
+*                  the result and dropped by the next stats_add_Si7021, so the time per call
+*                  grows with their number. It may run concurrently with other queries, but
+*                  not with stats_add_Si7021 of the same statistics. The codes can be
+*                  converted by code_to_humidity_Si7021 and code_to_temperature_Si7021.
+*/
+void stats_query_Si7021(const Si7021_stats_window_t* win, uint32_t now,
+                        Si7021_stats_result_t* result);
+
+/************************************************************************************************
+* NAME :            uint32_t stats_memory_Si7021(const Si7021_stats_t* stats)
+*
+* DESCRIPTION :     Returns the memory used by the statistics and its windows.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_stats_t*       stats    statistics
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   uint32_t
+*            Values: <bytes>
+*
+* NOTES :
+*/
+uint32_t stats_memory_Si7021(const Si7021_stats_t* stats);
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef SI7021_TASK_H_
+#define SI7021_TASK_H_
+
+#include "Si7021_arbiter.h"
+
+/*
+*  Protothread-style resumable operations. A task is an arbiter job whose step function
+*  continues where it returned the last time: SI7021_TASK_WAIT_UNTIL returns SI7021_STEP_WAIT
+*  and the next step resumes after it. Local variables do not survive a wait, the state of a
+*  task lives in its structure. A task needs no stack of its own, so any number of them can
+*  be interleaved by an arbiter or by an event loop that calls the step functions at their
+*  wake times.
+*
+*  int8_t my_step(Si7021_job_t* job, uint32_t now)
+*  {
+*    my_task_t* t = (my_task_t*)job;
+*
+*    SI7021_TASK_BEGIN(t->line);
+*    ...
+*    SI7021_TASK_WAIT_UNTIL(t->line, job, now + 10);
+*    ...
+*    SI7021_TASK_AWAIT(t->line, job, &(t->child.job), now);
+*    SI7021_TASK_END(t->line);
+*  }
+*/
+
+#define SI7021_TASK_BEGIN(line)      switch(line) { case 0:
+
+/* returns from the step, the next step continues here at 'at' or later */
+#define SI7021_TASK_WAIT_UNTIL(line, job, at)                                                 \
+  do { (job)->wake = (at); (line) = __LINE__; return SI7021_STEP_WAIT; case __LINE__:; }       \
+  while(0)
+
+/* runs a child task within the steps of the parent, fails the parent if the child fails */
+#define SI7021_TASK_AWAIT(line, job, child, now)                                              \
+  do {                                                                                        \
+    (line) = __LINE__; __attribute__((fallthrough)); case __LINE__:                           \
+    switch((child)->step((child), (now)))                                                     \
+    {                                                                                         \
+      case SI7021_STEP_DONE: break;                                                           \
+      case SI7021_STEP_WAIT: (job)->wake = (child)->wake; return SI7021_STEP_WAIT;            \
+      default: (line) = 0; return -1;                                                         \
+    }                                                                                         \
+  } while(0)
+
+/* finishes the task, the next step starts it again */
+#define SI7021_TASK_FAIL(line)       do { (line) = 0; return -1; } while(0)
+#define SI7021_TASK_END(line)        } (line) = 0; return SI7021_STEP_DONE
+
+typedef struct Si7021_sample_task
+{
+  Si7021_job_t              job;
+  Si7021_t*                 dev;    // sensor to be measured
+  uint16_t                  line;   // internal, resume point
+  uint8_t                   polls;  // internal
+  Si7021_sample_t           sample; // result
+}Si7021_sample_task_t;
+
+typedef struct Si7021_update_task
+{
+  Si7021_job_t              job;
+  Si7021_t*                 dev;    // sensor to be configured
+  uint16_t                  line;   // internal, resume point
+  uint8_t                   polls;  // internal
+  Si7021_registers_t        reg;    // register to be updated
+  uint8_t                   mask;   // bits to be changed
+  uint8_t                   value;  // new value of the bits in 'mask'
+}Si7021_update_task_t;
+
+typedef struct Si7021_resolution_task
+{
+  Si7021_job_t              job;
+  uint16_t                  line;   // internal, resume point
+  Si7021_update_task_t      update; // sets the resolution
+  Si7021_sample_task_t      sample; // measures at the resolution, holds the result
+}Si7021_resolution_task_t;
+
+/************************************************************************************************
+* NAME :            void sample_task_init_Si7021(Si7021_sample_task_t* task, Si7021_t* dev,
+*                                                uint8_t priority, Si7021_job_done_t done)
+*
+* DESCRIPTION :     Prepares a sample task: the resumable form of r_sample_Si7021. It starts a
+*                   No Hold Master humidity conversion, waits for the conversion time and reads
+*                   humidity and temperature by fetch_sample_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_sample_task_t* task     task to be prepared
+*            Si7021_t*             dev      sensor to be measured
+*            uint8_t               priority priority of the job
+*            Si7021_job_done_t     done     completion callback, may be NULL
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          The task can be submitted to an arbiter or stepped by the application.
+*/
+void sample_task_init_Si7021(Si7021_sample_task_t* task, Si7021_t* dev, uint8_t priority,
+                             Si7021_job_done_t done);
+
+/************************************************************************************************
+* NAME :            void update_task_init_Si7021(Si7021_update_task_t* task, Si7021_t* dev,
+*                                                Si7021_registers_t reg, uint8_t mask,
+*                                                uint8_t value, uint8_t priority,
+*                                                Si7021_job_done_t done)
+*
+* DESCRIPTION :     Prepares a register update task: reads the register, changes the bits in
+*                   'mask' to 'value' and writes it by a configuration transaction, so the
+*                   local register copies follow. While the sensor is busy (e.g. converting)
+*                   the update is retried every ms instead of blocking.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_update_task_t* task     task to be prepared
+*            Si7021_t*             dev      sensor to be configured
+*            Si7021_registers_t    reg      register to be updated
+*            uint8_t               mask     bits to be changed
+*            uint8_t               value    new value of the bits
+*            uint8_t               priority priority of the job
+*            Si7021_job_done_t     done     completion callback, may be NULL
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :
+*/
+void update_task_init_Si7021(Si7021_update_task_t* task, Si7021_t* dev, Si7021_registers_t reg,
+                             uint8_t mask, uint8_t value, uint8_t priority,
+                             Si7021_job_done_t done);
+
+/************************************************************************************************
+* NAME :            void resolution_task_init_Si7021(Si7021_resolution_task_t* task,
+*                                                    Si7021_t* dev,
+*                                                    Si7021_resolution_t resolution,
+*                                                    uint8_t priority, Si7021_job_done_t done)
+*
+* DESCRIPTION :     Prepares a task composed of an update task setting the resolution and a
+*                   sample task measuring at it. The result is in task->sample.sample.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_resolution_task_t* task task to be prepared
+*            Si7021_t*             dev      sensor to be measured
+*            Si7021_resolution_t   resolution  measurement resolution
+*            uint8_t               priority priority of the job
+*            Si7021_job_done_t     done     completion callback, may be NULL
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :          An example of composing tasks by SI7021_TASK_AWAIT.
+*/
+void resolution_task_init_Si7021(Si7021_resolution_task_t* task, Si7021_t* dev,
+                                 Si7021_resolution_t resolution, uint8_t priority,
+                                 Si7021_job_done_t done);
+
+#endif /* SI7021_TASK_H_ */
@@ -0,0 +1,148 @@
+#include <Si7021_adaptive.h>
+
+#define LEVELS           4
+#define ACTIVITY_FAST    256           // rate at the threshold
+#define ACTIVITY_CALM    64            // a quarter of the threshold
+#define DEFAULT_SETTLE   8
+#define BASELINE_MS      100           // shortest time the rate is measured over
+
+/* resolutions from the most precise to the fastest */
+static const Si7021_resolution_t LEVEL_RESOLUTION[LEVELS] = {H12_T14, H10_T13, H11_T11, H8_T12};
+
+/* one LSB of the level in codes */
+static const uint16_t HUMI_LSB[LEVELS] = {16, 64, 32, 256};
+static const uint16_t TEMP_LSB[LEVELS] = {4, 8, 32, 16};
+
+static int8_t level_of(uint8_t resolution);
+static uint16_t coarser(const uint16_t* lsb, int8_t a, int8_t b);
+static uint32_t activity_of(uint16_t a, uint16_t b, uint16_t lsb, uint32_t dt, uint16_t rate);
+
+static int8_t level_of(uint8_t resolution)
+{
+  uint8_t i;
+
+  for(i = 0; i < LEVELS; i++)
+  {
+    if(LEVEL_RESOLUTION[i] == resolution)
+      return i;
+  }
+
+  return -1;
+}
+
+/* LSB of the coarser of two levels, the levels are not ordered by the LSB of each channel */
+static uint16_t coarser(const uint16_t* lsb, int8_t a, int8_t b)
+{
+  return (lsb[a] > lsb[b]) ? lsb[a] : lsb[b];
+}
+
+/* change above one LSB relative to the threshold rate, 256 at the threshold */
+static uint32_t activity_of(uint16_t a, uint16_t b, uint16_t lsb, uint32_t dt, uint16_t rate)
+{
+  uint32_t change = (a > b) ? (a - b) : (b - a);
+
+  if(change <= lsb)
+    return 0;
+
+  return (uint32_t)(((uint64_t)(change - lsb) * 1000 * ACTIVITY_FAST) / ((uint64_t)dt * rate));
+}
+
+int8_t adaptive_init_Si7021(Si7021_adaptive_t* ctl, Si7021_t* dev, Si7021_resolution_t precise,
+                            Si7021_resolution_t fast, uint16_t humi_rate, uint16_t temp_rate)
+{
+  int8_t p = level_of(precise);
+  int8_t f = level_of(fast);
+  uint32_t humi = ((uint32_t)humi_rate << 16) / 12500;
+  uint32_t temp = ((uint32_t)temp_rate << 16) / 17572;
+
+  if(p < 0 || f < 0 || f < p)
+    return -1;
+
+  ctl->dev = dev;
+  ctl->precise = p;
+  ctl->fast = f;
+  ctl->humi_rate = (humi == 0) ? 1 : ((humi > UINT16_MAX) ? UINT16_MAX : humi);
+  ctl->temp_rate = (temp == 0) ? 1 : ((temp > UINT16_MAX) ? UINT16_MAX : temp);
+  ctl->activity = 0;
+  ctl->settle = DEFAULT_SETTLE;
+  ctl->calm = 0;
+  ctl->has_last = 0;
+  ctl->switches = 0;
+
+  return 0;
+}
+
+int8_t adaptive_sample_Si7021(Si7021_adaptive_t* ctl, Si7021_sample_t* sample)
+{
+  int8_t level, target, last_level;
+  uint32_t dt, humi, temp, activity = 0;
+
+  if(r_sample_Si7021(ctl->dev, sample) < 0)
+    return -1;
+
+  level = level_of(sample->resolution);
+  target = level;
+
+  dt = sample->timestamp - ctl->last.timestamp;
+
+  /* over a few ms the noise would look like a fast change */
+  if(ctl->has_last && dt < BASELINE_MS)
+    return 0;
+
+  if(ctl->has_last)
+  {
+    /* a change of resolution may move the codes by the coarser LSB of each channel */
+    last_level = level_of(ctl->last.resolution);
+
+    humi = activity_of(sample->humi_code, ctl->last.humi_code,
+                       coarser(HUMI_LSB, level, last_level), dt, ctl->humi_rate);
+    temp = activity_of(sample->temp_code, ctl->last.temp_code,
+                       coarser(TEMP_LSB, level, last_level), dt, ctl->temp_rate);
+    activity = (humi > temp) ? humi : temp;
+
+    if(activity > UINT16_MAX)
+      activity = UINT16_MAX;
+
+    ctl->activity = ctl->activity - ctl->activity / 4 + activity / 4;
+
+    if(activity >= ACTIVITY_FAST)
+    {
+      ctl->calm = 0;
+
+      if(level < ctl->fast)
+        target = level + 1;
+    }
+    else if(ctl->activity < ACTIVITY_CALM)
+    {
+      if(++ctl->calm >= ctl->settle)
+      {
+        ctl->calm = 0;
+
+        if(level > ctl->precise)
+          target = level - 1;
+      }
+    }
+    else
+      ctl->calm = 0;
+  }
+
+  /* keep the resolution within the bounds */
+  if(target < ctl->precise)
+    target = ctl->precise;
+  else if(target > ctl->fast)
+    target = ctl->fast;
+
+  if(target != level)
+  {
+    config_begin_Si7021(ctl->dev);
+    stage_resolution_Si7021(ctl->dev, LEVEL_RESOLUTION[target]);
+
+    if(config_commit_Si7021(ctl->dev) == 0)
+      ctl->switches++;
+  }
+
+  ctl->last = *sample;
+  ctl->has_last = 1;
+
+  return 0;
+}
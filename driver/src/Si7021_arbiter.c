@@ -0,0 +1,228 @@
+#include <Si7021_arbiter.h>
+
+#define START_RETRIES    50            // retries of a busy sensor before the start, 1 ms apart
+#define FETCH_POLLS      10            // retries of a conversion in progress, 1 ms apart
+
+enum measure_job_state
+{
+  Measure_Start,
+  Measure_Fetch
+};
+
+static uint32_t effective_priority(Si7021_arbiter_t* arb, Si7021_job_t* job, uint32_t now);
+static void remove_job(Si7021_arbiter_t* arb, Si7021_job_t* job);
+static int8_t measure_job_step(Si7021_job_t* job, uint32_t now);
+
+static uint32_t effective_priority(Si7021_arbiter_t* arb, Si7021_job_t* job, uint32_t now)
+{
+  if(arb->aging == 0)
+    return job->priority;
+
+  return job->priority + (now - job->submit_time) / arb->aging;
+}
+
+static void remove_job(Si7021_arbiter_t* arb, Si7021_job_t* job)
+{
+  Si7021_job_t** link = &(arb->queue);
+
+  while(*link != NULL && *link != job)
+    link = &((*link)->next);
+
+  if(*link != NULL)
+  {
+    *link = job->next;
+    job->next = NULL;
+    arb->stats.depth--;
+  }
+}
+
+static int8_t measure_job_step(Si7021_job_t* job, uint32_t now)
+{
+  Si7021_measure_job_t* mjob = (Si7021_measure_job_t*)job;
+  int8_t rv;
+
+  if(mjob->state == Measure_Start)
+  {
+    /* a new command would abort the conversion another job started on the sensor,
+       a sensor busy with a conversion of another master does not acknowledge */
+    if(mjob->dev->pending_type != SI7021_NO_MEASUREMENT)
+      rv = SI7021_NACK;
+    else
+      rv = start_measurement_Si7021(mjob->dev, mjob->type);
+
+    if(rv == SI7021_NACK && ++mjob->polls <= START_RETRIES)
+    {
+      job->wake = now + 1;
+      return SI7021_STEP_WAIT;
+    }
+
+    if(rv < 0)
+    {
+      mjob->polls = 0;
+      return -1;
+    }
+
+    /* the bus is free for the other jobs during the conversion */
+    job->wake = now + (conversion_time_Si7021(mjob->dev, mjob->type) + 999) / 1000;
+    mjob->state = Measure_Fetch;
+    mjob->polls = 0;
+
+    return SI7021_STEP_WAIT;
+  }
+
+  rv = fetch_measurement_Si7021(mjob->dev, &(mjob->code));
+
+  if(rv == 1 && ++mjob->polls <= FETCH_POLLS)
+  {
+    job->wake = now + 1;
+    return SI7021_STEP_WAIT;
+  }
+
+  /* a conversion given up does not keep the other jobs of the sensor waiting */
+  if(rv != 0)
+    mjob->dev->pending_type = SI7021_NO_MEASUREMENT;
+
+  /* ready to be submitted again */
+  mjob->state = Measure_Start;
+  mjob->polls = 0;
+
+  return (rv == 0) ? SI7021_STEP_DONE : -1;
+}
+
+void arbiter_init_Si7021(Si7021_arbiter_t* arb, Si7021_bus_t* bus, uint16_t aging)
+{
+  arb->bus = bus;
+  arb->queue = NULL;
+  arb->aging = aging;
+  arb->stats.depth = 0;
+  arb->stats.max_depth = 0;
+  arb->stats.completed = 0;
+  arb->stats.total_wait = 0;
+  arb->stats.max_wait = 0;
+}
+
+int8_t arbiter_submit_Si7021(Si7021_arbiter_t* arb, Si7021_job_t* job, uint32_t now)
+{
+  Si7021_job_t** link = &(arb->queue);
+  int8_t rv = 0;
+
+  if(job->step == NULL)
+    return -1;
+
+  lock_bus_Si7021(arb->bus);
+
+  while(*link != NULL && *link != job)
+    link = &((*link)->next);
+
+  if(*link == job)
+    rv = -1;
+  else
+  {
+    job->next = NULL;
+    job->started = 0;
+    job->submit_time = now;
+    job->wake = now;
+    *link = job;
+
+    if(++arb->stats.depth > arb->stats.max_depth)
+      arb->stats.max_depth = arb->stats.depth;
+  }
+
+  unlock_bus_Si7021(arb->bus);
+
+  return rv;
+}
+
+int16_t arbiter_poll_Si7021(Si7021_arbiter_t* arb, uint32_t now, uint32_t* wake)
+{
+  Si7021_job_t* job;
+  Si7021_job_t* best = NULL;
+  uint32_t priority, best_priority = 0;
+  uint32_t wait;
+  int8_t rv = SI7021_STEP_WAIT;
+  int16_t depth;
+
+  lock_bus_Si7021(arb->bus);
+
+  for(job = arb->queue; job != NULL; job = job->next)
+  {
+    if((int32_t)(now - job->wake) < 0)
+      continue;
+
+    priority = effective_priority(arb, job, now);
+
+    if(best == NULL || priority > best_priority)
+    {
+      best = job;
+      best_priority = priority;
+    }
+  }
+
+  if(best != NULL)
+  {
+    if(!best->started)
+    {
+      best->started = 1;
+      wait = now - best->submit_time;
+      arb->stats.total_wait += wait;
+
+      if(wait > arb->stats.max_wait)
+        arb->stats.max_wait = wait;
+    }
+
+    rv = best->step(best, now);
+
+    if(rv != SI7021_STEP_WAIT)
+    {
+      remove_job(arb, best);
+      arb->stats.completed++;
+    }
+  }
+
+  if(wake != NULL && arb->queue != NULL)
+  {
+    *wake = arb->queue->wake;
+
+    for(job = arb->queue->next; job != NULL; job = job->next)
+    {
+      if((int32_t)(job->wake - *wake) < 0)
+        *wake = job->wake;
+    }
+  }
+
+  /* the return value is signed, the exact depth is in the statistics */
+  depth = (arb->stats.depth > INT16_MAX) ? INT16_MAX : (int16_t)arb->stats.depth;
+
+  unlock_bus_Si7021(arb->bus);
+
+  /* called without the bus lock so the callback can submit the job again */
+  if(best != NULL && rv != SI7021_STEP_WAIT && best->done != NULL)
+    best->done(best, rv);
+
+  return depth;
+}
+
+void arbiter_stats_Si7021(Si7021_arbiter_t* arb, Si7021_arbiter_stats_t* stats)
+{
+  lock_bus_Si7021(arb->bus);
+  *stats = arb->stats;
+  unlock_bus_Si7021(arb->bus);
+}
+
+void measure_job_init_Si7021(Si7021_measure_job_t* mjob, Si7021_t* dev,
+                             Si7021_measurement_type_t type,
+                             uint8_t priority, Si7021_job_done_t done)
+{
+  mjob->job.step = measure_job_step;
+  mjob->job.done = done;
+  mjob->job.ctx = NULL;
+  mjob->job.priority = priority;
+  mjob->job.started = 0;
+  mjob->job.wake = 0;
+  mjob->job.next = NULL;
+  mjob->dev = dev;
+  mjob->type = type;
+  mjob->state = Measure_Start;
+  mjob->polls = 0;
+  mjob->code = 0;
+}
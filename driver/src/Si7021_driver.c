@@ -1,18 +1,37 @@
 #include <Si7021_driver.h>
-#include <i2c.h>
 
-static const uint16_t I2C_ADDR = (0x40<<1);           // Si7021 I2C address
+static const uint16_t I2C_ADDR = 0x40;                // Si7021 7 bit I2C address
 static const uint8_t  HEATER_CURRENT_OFFSET = 3;      // current value in mA for register value 0
 static const uint8_t  HEATER_CURRENT_STEP   = 6;      // mA/LSB
+static const uint8_t  CRC_POLYNOMIAL = 0x31;          // x^8 + x^5 + x^4 + 1, initial value 0x00
+static const uint8_t  USER_REG_1_RSVD = 0b00111010;   // reserved bits of User Register 1
+static const uint8_t  USER_REG_1_RES  = (1<<RES1) | (1<<RES0);
 
-static uint8_t user_register_1 = 0b00111010;
-static uint8_t heater_control_register = 0b00000000;
+/* maximum conversion times in us, index: RES1:RES0 (H12_T14, H8_T12, H10_T13, H11_T11) */
+static const uint16_t HUMI_CONVERSION_TIME[] = {12000, 3100, 4500, 6800};
+static const uint16_t TEMP_CONVERSION_TIME[] = {10800, 3800, 6200, 2400};
 
 static float process_temp_code(uint16_t temp_code);
 static float process_humi_code(uint16_t humi_code);
 static uint16_t convert_to_uint16(uint8_t bytes[]);
-static int8_t w_reg(uint8_t value, Si7021_registers_t reg);
-static int8_t r_reg(Si7021_registers_t reg);
+static uint8_t crc8(uint8_t crc, uint8_t data);
+static int8_t check_id_bytes(const uint8_t* buffer, uint8_t length, uint8_t stride, uint32_t* id);
+static int8_t w_reg(Si7021_t* dev, uint8_t value, Si7021_registers_t reg);
+static int8_t r_reg(Si7021_t* dev, Si7021_registers_t reg);
+static int8_t r_regs(Si7021_t* dev);
+static uint8_t heater_current_to_reg(uint8_t current);
+static int8_t bus_transfer(Si7021_t* dev, Si7021_msg_t* msgs, uint8_t count);
+static int8_t r_reg_locked(Si7021_t* dev, Si7021_registers_t reg, uint8_t* value);
+static uint32_t bus_time(Si7021_bus_t* bus);
+static uint32_t bus_time_us(Si7021_bus_t* bus);
+static uint32_t pending_end_us(Si7021_t* dev, uint32_t now);
+static void publish_sample(Si7021_t* dev, const Si7021_sample_t* sample);
+static void note_conversion(Si7021_t* dev, Si7021_measurement_type_t type, uint16_t code,
+                            uint32_t start_us, uint32_t end_us);
+static void stamp_sample(Si7021_t* dev, Si7021_sample_t* sample, uint32_t start_us,
+                         uint32_t end_us);
+static int8_t transact(Si7021_t* dev, const uint8_t* cmd, uint8_t cmd_len,
+                       uint8_t* data, uint16_t data_len);
 
 static float process_temp_code(uint16_t temp_code)
 {
@@ -36,7 +55,203 @@ static uint16_t convert_to_uint16(uint8_t bytes[])
   return (uint16_t)((bytes[0]<<8) | bytes[1]);
 }
 
-static int8_t r_reg(Si7021_registers_t reg)
+static uint8_t crc8(uint8_t crc, uint8_t data)
+{
+  uint8_t i;
+
+  crc ^= data;
+
+  for(i = 0; i < 8; i++)
+  {
+    if(crc & 0x80)
+      crc = (uint8_t)((crc << 1) ^ CRC_POLYNOMIAL);
+    else
+      crc = (uint8_t)(crc << 1);
+  }
+
+  return crc;
+}
+
+/*
+*  Collects the ID bytes of an electronic ID access and verifies their checksums.
+*  A CRC follows every 'stride' ID bytes and covers all ID bytes of the access
+*  read so far.
+*/
+static int8_t check_id_bytes(const uint8_t* buffer, uint8_t length, uint8_t stride, uint32_t* id)
+{
+  uint8_t i, crc = 0, count = 0;
+
+  *id = 0;
+
+  for(i = 0; i < length; i++)
+  {
+    if(count == stride)
+    {
+      if(buffer[i] != crc)
+        return -1;
+
+      count = 0;
+    }
+    else
+    {
+      crc = crc8(crc, buffer[i]);
+      *id = (*id << 8) | buffer[i];
+      count++;
+    }
+  }
+
+  return 0;
+}
+
+/*
+*  Selects the multiplexer channel of the sensor if it is not the active one
+*  and passes the messages to the bus. The bus lock is held for both, so the
+*  channel can not be changed by another task in between.
+*/
+static int8_t bus_transfer(Si7021_t* dev, Si7021_msg_t* msgs, uint8_t count)
+{
+  Si7021_bus_t* bus = dev->bus;
+  int8_t rv = 0;
+
+  lock_bus_Si7021(bus);
+
+  if(bus->select != NULL && bus->active_channel != dev->channel)
+  {
+    if(bus->select(bus->ctx, dev->channel) < 0)
+    {
+      bus->active_channel = SI7021_NO_CHANNEL;
+      rv = -1;
+    }
+    else
+      bus->active_channel = dev->channel;
+  }
+
+  if(rv == 0)
+    rv = bus->transfer(bus->ctx, I2C_ADDR, msgs, count);
+
+  unlock_bus_Si7021(bus);
+
+  return rv;
+}
+
+static uint32_t bus_time(Si7021_bus_t* bus)
+{
+  if(bus->now_ms == NULL)
+    return 0;
+
+  return bus->now_ms();
+}
+
+/* high resolution time for the conversion timestamps, from now_ms without a now_us */
+static uint32_t bus_time_us(Si7021_bus_t* bus)
+{
+  if(bus->now_us != NULL)
+    return bus->now_us();
+
+  return bus_time(bus) * 1000;
+}
+
+/*
+*  The started conversion was done by the time it was read, and at the latest
+*  after the maximum conversion time.
+*/
+static uint32_t pending_end_us(Si7021_t* dev, uint32_t now)
+{
+  uint32_t end = dev->pending_start_us + conversion_time_Si7021(dev, dev->pending_type);
+
+  return ((int32_t)(now - end) < 0) ? now : end;
+}
+
+/*
+*  Seqlock writer. Writers are serialised by the bus lock, the sequence
+*  number is odd while the snapshot is being updated.
+*/
+static void publish_sample(Si7021_t* dev, const Si7021_sample_t* sample)
+{
+  uint32_t seq = __atomic_load_n(&(dev->snapshot_seq), __ATOMIC_RELAXED);
+
+  __atomic_store_n(&(dev->snapshot_seq), seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  dev->snapshot = *sample;
+
+  __atomic_store_n(&(dev->snapshot_seq), seq + 2, __ATOMIC_RELEASE);
+}
+
+/*
+*  Remembers the last humidity conversion, its temperature can be read by
+*  Temp_AH until the next temperature conversion.
+*/
+static void note_conversion(Si7021_t* dev, Si7021_measurement_type_t type, uint16_t code,
+                            uint32_t start_us, uint32_t end_us)
+{
+  dev->conv_start_us = start_us;
+  dev->conv_end_us = end_us;
+
+  if(type == Humidity)
+  {
+    dev->rh_code = code;
+    dev->rh_time = bus_time(dev->bus);
+    dev->rh_valid = 1;
+    __atomic_store_n(&(dev->rh_seq), dev->rh_seq + 1, __ATOMIC_RELAXED);
+  }
+  else
+    dev->rh_valid = 0;
+}
+
+/* times, resolution and heater state of a sample being measured */
+static void stamp_sample(Si7021_t* dev, Si7021_sample_t* sample, uint32_t start_us,
+                         uint32_t end_us)
+{
+  sample->timestamp = bus_time(dev->bus);
+  sample->start_us = start_us;
+  sample->end_us = end_us;
+  sample->resolution = dev->user_register_1 & USER_REG_1_RES;
+  sample->flags = dev->sample_flags;
+
+  if(dev->user_register_1 & (1<<HTRE))
+    sample->flags |= SI7021_SAMPLE_HEATED;
+}
+
+/* reads a register and returns its value under the bus lock */
+static int8_t r_reg_locked(Si7021_t* dev, Si7021_registers_t reg, uint8_t* value)
+{
+  int8_t rv;
+
+  lock_bus_Si7021(dev->bus);
+
+  rv = r_reg(dev, reg);
+
+  if(rv == 0 && reg == User_Register_1)
+    *value = dev->user_register_1;
+  else if(rv == 0)
+    *value = dev->heater_control_register;
+
+  unlock_bus_Si7021(dev->bus);
+
+  return rv;
+}
+
+/*
+*  Executes a command with the least number of bus transactions. A command
+*  followed by a read is done as one combined transaction with a repeated
+*  start, so no STOP/START pair is needed between the command and the data.
+*  Commands without read data (including register writes where the value is
+*  part of 'cmd') are a single write transaction.
+*/
+static int8_t transact(Si7021_t* dev, const uint8_t* cmd, uint8_t cmd_len,
+                       uint8_t* data, uint16_t data_len)
+{
+  Si7021_msg_t msgs[2] =
+  {
+    {I2C_Msg_Write, cmd_len,  (uint8_t*)cmd},
+    {I2C_Msg_Read,  data_len, data}
+  };
+
+  return bus_transfer(dev, msgs, (data_len == 0) ? 1 : 2);
+}
+
+static int8_t r_reg(Si7021_t* dev, Si7021_registers_t reg)
 {
   uint8_t cmd;
   uint8_t* data;
@@ -44,48 +259,371 @@ static int8_t r_reg(Si7021_registers_t reg)
   if(reg == User_Register_1)
   {
     cmd = R_RHT_U_reg;
-    data = &(user_register_1);
+    data = &(dev->user_register_1);
   }
   else if(reg == Heater_Control_Register)
   {
     cmd = R_Heater_C_reg;
-    data = &(heater_control_register);
+    data = &(dev->heater_control_register);
   }
   else
     return -1;
 
-  if(HAL_OK != HAL_I2C_Mem_Read(&hi2c1, I2C_ADDR, cmd, 1, data, 1, 10000))
+  return transact(dev, &cmd, 1, data, 1);
+}
+
+/* reads both registers in one transfer */
+static int8_t r_regs(Si7021_t* dev)
+{
+  uint8_t cmd[2] = {R_RHT_U_reg, R_Heater_C_reg};
+  uint8_t buffer[2];
+
+  Si7021_msg_t msgs[4] =
+  {
+    {I2C_Msg_Write, 1, &cmd[0]},
+    {I2C_Msg_Read,  1, &buffer[0]},
+    {I2C_Msg_Write, 1, &cmd[1]},
+    {I2C_Msg_Read,  1, &buffer[1]}
+  };
+
+  if(bus_transfer(dev, msgs, 4) < 0)
     return -1;
-  else
-    return 0;
+
+  dev->user_register_1 = buffer[0];
+  dev->heater_control_register = buffer[1];
+
+  return 0;
+}
+
+static uint8_t heater_current_to_reg(uint8_t current)
+{
+  uint8_t reg_val = (current - HEATER_CURRENT_OFFSET)/HEATER_CURRENT_STEP;
+
+  if(reg_val > 0x0F)
+    reg_val = 0x0F;
+
+  return reg_val;
 }
 
-static int8_t w_reg(uint8_t value, Si7021_registers_t reg)
+static int8_t w_reg(Si7021_t* dev, uint8_t value, Si7021_registers_t reg)
 {
-  uint16_t cmd;
+  uint8_t cmd[2];
 
   if(reg == User_Register_1)
   {
-    cmd = W_RHT_U_reg;
+    cmd[0] = W_RHT_U_reg;
   }
   else if(reg == Heater_Control_Register)
   {
-    cmd = W_Heater_C_reg;
+    cmd[0] = W_Heater_C_reg;
   }
   else
     return -1;
 
-  if(HAL_OK != HAL_I2C_Mem_Write(&hi2c1, I2C_ADDR, cmd, 1, &value, 1, 10000))
+  cmd[1] = value;
+
+  return transact(dev, cmd, 2, NULL, 0);
+}
+
+void lock_bus_Si7021(Si7021_bus_t* bus)
+{
+  if(bus->lock != NULL)
+    bus->lock(bus->mutex);
+}
+
+void unlock_bus_Si7021(Si7021_bus_t* bus)
+{
+  if(bus->unlock != NULL)
+    bus->unlock(bus->mutex);
+}
+
+void attach_Si7021(Si7021_t* dev, Si7021_bus_t* bus, uint8_t channel)
+{
+  dev->bus = bus;
+  dev->channel = channel;
+  dev->user_register_1 = SI7021_USER_REG_1_DEFAULT;
+  dev->heater_control_register = SI7021_HEATER_REG_DEFAULT;
+  dev->staged_user_register_1 = SI7021_USER_REG_1_DEFAULT;
+  dev->staged_heater_control_register = SI7021_HEATER_REG_DEFAULT;
+  dev->firmware_rev = 0;
+  dev->serial_a = 0;
+  dev->serial_b = 0;
+  dev->snapshot_seq = 0;
+  dev->rh_valid = 0;
+  dev->rh_seq = 0;
+  dev->pending_type = SI7021_NO_MEASUREMENT;
+  dev->pending_start_us = 0;
+  dev->coalesce_window = 0;
+  dev->sample_flags = 0;
+  dev->conv_start_us = 0;
+  dev->conv_end_us = 0;
+}
+
+void set_coalesce_window_Si7021(Si7021_t* dev, uint16_t window)
+{
+  dev->coalesce_window = window;
+}
+
+int8_t init_Si7021(Si7021_t* dev, const Si7021_config_t* config)
+{
+  uint16_t polls = 0;
+  int8_t rv = 0;
+
+  if(config->resolution & ~USER_REG_1_RES)
+    return -1;
+
+  lock_bus_Si7021(dev->bus);
+
+  if(r_regs(dev) < 0 || (dev->user_register_1 & USER_REG_1_RSVD) != USER_REG_1_RSVD)
+  {
+    /* not responding or in unknown state, start over from reset */
+    rv = rst_Si7021(dev);
+
+    if(rv == 0 && dev->bus->delay_ms != NULL)
+    {
+      /* the other sensors of the bus are not stalled by the reset */
+      unlock_bus_Si7021(dev->bus);
+      dev->bus->delay_ms(SI7021_RESET_TIME_MS);
+      lock_bus_Si7021(dev->bus);
+
+      rv = r_regs(dev);
+    }
+    else if(rv == 0)
+    {
+      /* the sensor does not acknowledge its address until the reset is done */
+      while((rv = r_regs(dev)) < 0 && ++polls < SI7021_RESET_POLLS)
+      {
+        unlock_bus_Si7021(dev->bus);
+        lock_bus_Si7021(dev->bus);
+      }
+    }
+  }
+
+  if(rv == 0)
+  {
+    config_begin_Si7021(dev);
+    stage_resolution_Si7021(dev, config->resolution);
+    stage_heater_Si7021(dev, config->heater_enable);
+    stage_heater_current_Si7021(dev, config->heater_current);
+    rv = config_commit_Si7021(dev);
+  }
+
+  unlock_bus_Si7021(dev->bus);
+
+  return rv;
+}
+
+void config_begin_Si7021(Si7021_t* dev)
+{
+  lock_bus_Si7021(dev->bus);
+
+  dev->staged_user_register_1 = dev->user_register_1;
+  dev->staged_heater_control_register = dev->heater_control_register;
+}
+
+int8_t stage_resolution_Si7021(Si7021_t* dev, Si7021_resolution_t resolution)
+{
+  if(resolution & ~USER_REG_1_RES)
     return -1;
+
+  dev->staged_user_register_1 &= (uint8_t)~USER_REG_1_RES;
+  dev->staged_user_register_1 |= resolution;
+
+  return 0;
+}
+
+void stage_heater_Si7021(Si7021_t* dev, uint8_t val)
+{
+  if(val == 0)
+    dev->staged_user_register_1 &= (uint8_t)~(1<<HTRE);
   else
-    return 0;
+    dev->staged_user_register_1 |= (1<<HTRE);
+}
+
+void stage_heater_current_Si7021(Si7021_t* dev, uint8_t current)
+{
+  dev->staged_heater_control_register &= 0xF0;
+  dev->staged_heater_control_register |= heater_current_to_reg(current);
+}
+
+int8_t config_commit_Si7021(Si7021_t* dev)
+{
+  int8_t rv = 0;
+
+  /* the local copies are only updated by successful writes, so on error they
+     still hold the register values of the sensor */
+  if(dev->staged_user_register_1 != dev->user_register_1)
+  {
+    if(w_reg(dev, dev->staged_user_register_1, User_Register_1) < 0)
+      rv = -1;
+    else
+      dev->user_register_1 = dev->staged_user_register_1;
+  }
+
+  if(rv == 0 && dev->staged_heater_control_register != dev->heater_control_register)
+  {
+    if(w_reg(dev, dev->staged_heater_control_register, Heater_Control_Register) < 0)
+      rv = -1;
+    else
+      dev->heater_control_register = dev->staged_heater_control_register;
+  }
+
+  /* drop what is left of the staged configuration */
+  dev->staged_user_register_1 = dev->user_register_1;
+  dev->staged_heater_control_register = dev->heater_control_register;
+
+  unlock_bus_Si7021(dev->bus);
+
+  return rv;
 }
 
-int8_t r_single_Si7021(float* data, Si7021_measurement_type_t type)
+float code_to_humidity_Si7021(uint16_t code)
+{
+  return process_humi_code(code);
+}
+
+float code_to_temperature_Si7021(uint16_t code)
+{
+  return process_temp_code(code);
+}
+
+uint32_t conversion_time_Si7021(Si7021_t* dev, Si7021_measurement_type_t type)
+{
+  uint8_t index = ((dev->user_register_1 >> (RES1 - 1)) & 0x02) | (dev->user_register_1 & 0x01);
+
+  /* a humidity measurement is followed by a temperature measurement */
+  if(type == Humidity)
+    return HUMI_CONVERSION_TIME[index] + TEMP_CONVERSION_TIME[index];
+  else
+    return TEMP_CONVERSION_TIME[index];
+}
+
+int8_t start_measurement_Si7021(Si7021_t* dev, Si7021_measurement_type_t type)
+{
+  uint8_t cmd;
+  int8_t rv;
+
+  if(type == Humidity)
+    cmd = Humi_NHM;
+  else if(type == Temperature)
+    cmd = Temp_NHM;
+  else
+    return -1;
+
+  lock_bus_Si7021(dev->bus);
+
+  rv = transact(dev, &cmd, 1, NULL, 0);
+
+  if(rv < 0)
+  {
+    unlock_bus_Si7021(dev->bus);
+    return (rv == SI7021_NACK) ? SI7021_NACK : -1;
+  }
+
+  dev->pending_type = type;
+  dev->pending_start_us = bus_time_us(dev->bus);
+
+  /* a started temperature conversion replaces the temperature of the last RH conversion */
+  if(type == Temperature)
+    dev->rh_valid = 0;
+
+  unlock_bus_Si7021(dev->bus);
+
+  return 0;
+}
+
+int8_t fetch_measurement_Si7021(Si7021_t* dev, uint16_t* code)
+{
+  uint8_t buffer[2];
+  int8_t rv;
+
+  Si7021_msg_t msg = {I2C_Msg_Read, 2, buffer};
+
+  lock_bus_Si7021(dev->bus);
+
+  if(dev->pending_type == SI7021_NO_MEASUREMENT)
+  {
+    unlock_bus_Si7021(dev->bus);
+    return -1;
+  }
+
+  rv = bus_transfer(dev, &msg, 1);
+
+  if(rv == 0)
+  {
+    *code = convert_to_uint16(buffer);
+    note_conversion(dev, dev->pending_type, *code, dev->pending_start_us,
+                    pending_end_us(dev, bus_time_us(dev->bus)));
+    dev->pending_type = SI7021_NO_MEASUREMENT;
+  }
+
+  unlock_bus_Si7021(dev->bus);
+
+  /* the sensor does not acknowledge its address until the conversion is done */
+  if(rv == SI7021_NACK)
+    return 1;
+
+  return (rv < 0) ? -1 : 0;
+}
+
+int8_t fetch_sample_Si7021(Si7021_t* dev, Si7021_sample_t* sample)
+{
+  uint8_t cmd = Temp_AH;
+  uint8_t buffer[4];
+  int8_t rv;
+
+  Si7021_msg_t msgs[3] =
+  {
+    {I2C_Msg_Read,  2, &buffer[0]},
+    {I2C_Msg_Write, 1, &cmd},
+    {I2C_Msg_Read,  2, &buffer[2]}
+  };
+
+  lock_bus_Si7021(dev->bus);
+
+  if(dev->pending_type != Humidity)
+  {
+    unlock_bus_Si7021(dev->bus);
+    return -1;
+  }
+
+  rv = bus_transfer(dev, msgs, 3);
+
+  if(rv == SI7021_NACK)
+  {
+    unlock_bus_Si7021(dev->bus);
+    return 1;
+  }
+
+  latest_Si7021(dev, sample);
+
+  sample->status = (rv < 0) ? -1 : 0;
+  stamp_sample(dev, sample, dev->pending_start_us, pending_end_us(dev, bus_time_us(dev->bus)));
+
+  if(sample->status == 0)
+  {
+    sample->humi_code = convert_to_uint16(&buffer[0]);
+    sample->temp_code = convert_to_uint16(&buffer[2]);
+    note_conversion(dev, Humidity, sample->humi_code, sample->start_us, sample->end_us);
+    dev->pending_type = SI7021_NO_MEASUREMENT;
+  }
+
+  publish_sample(dev, sample);
+
+  unlock_bus_Si7021(dev->bus);
+
+  return sample->status;
+}
+
+int8_t r_single_Si7021(Si7021_t* dev, float* data, Si7021_measurement_type_t type)
 {
   uint8_t cmd;
   uint8_t buffer[2];
   uint16_t code;
+  uint32_t seq;
+  uint32_t start_us;
+  uint8_t rh_done, rh_recent;
+  int8_t rv = 0;
 
   if(type == Humidity)
     cmd = Humi_HM;
@@ -94,13 +632,46 @@ int8_t r_single_Si7021(float* data, Si7021_measurement_type_t type)
   else
     return -1;
 
-  if(HAL_OK != HAL_I2C_Master_Transmit(&hi2c1, I2C_ADDR, &cmd, 1, 10000))
-    return -1;
+  /* RH conversions counted before waiting for the bus */
+  seq = __atomic_load_n(&(dev->rh_seq), __ATOMIC_RELAXED);
 
-  if(HAL_OK != HAL_I2C_Master_Receive(&hi2c1, I2C_ADDR, buffer, 2, 10000))
-    return -1;
+  lock_bus_Si7021(dev->bus);
+
+  /* an RH conversion finished while waiting for the bus, or one within the window */
+  rh_done = dev->rh_valid && dev->rh_seq != seq;
+  rh_recent = dev->rh_valid && dev->coalesce_window != 0 && dev->bus->now_ms != NULL &&
+              bus_time(dev->bus) - dev->rh_time <= dev->coalesce_window;
+
+  if(type == Humidity && rh_done)
+  {
+    /* merged with the concurrent request */
+    code = dev->rh_code;
+  }
+  else if(type == Temperature && (rh_done || rh_recent))
+  {
+    /* no conversion, read the temperature measured with the RH */
+    cmd = Temp_AH;
+    rv = transact(dev, &cmd, 1, buffer, 2);
+    code = convert_to_uint16(buffer);
+  }
+  else
+  {
+    start_us = bus_time_us(dev->bus);
+    rv = transact(dev, &cmd, 1, buffer, 2);
+    code = convert_to_uint16(buffer);
+
+    /* the command aborts a No Hold Master conversion in progress */
+    if(rv == 0)
+    {
+      note_conversion(dev, type, code, start_us, bus_time_us(dev->bus));
+      dev->pending_type = SI7021_NO_MEASUREMENT;
+    }
+  }
+
+  unlock_bus_Si7021(dev->bus);
 
-  code = convert_to_uint16(buffer);
+  if(rv < 0)
+    return -1;
 
   if(type == Humidity)
     *data = process_humi_code(code);
@@ -110,183 +681,309 @@ int8_t r_single_Si7021(float* data, Si7021_measurement_type_t type)
   return 0;
 }
 
-int8_t r_both_Si7021(float* humidity, float* temperature)
+int8_t r_both_Si7021(Si7021_t* dev, float* humidity, float* temperature)
 {
-  uint8_t cmd = Humi_HM;
-  uint8_t buffer[2];
-  uint16_t code;
+  Si7021_sample_t sample;
 
-  if(HAL_OK != HAL_I2C_Master_Transmit(&hi2c1, I2C_ADDR, &cmd, 1, 10000))
+  if(r_sample_Si7021(dev, &sample) < 0)
     return -1;
 
-  if(HAL_OK != HAL_I2C_Master_Receive(&hi2c1, I2C_ADDR, buffer, 2, 10000))
-    return -1;
+  *humidity = process_humi_code(sample.humi_code);
+  *temperature = process_temp_code(sample.temp_code);
+
+  return 0;
+}
 
-  code = convert_to_uint16(buffer);
-  *humidity = process_humi_code(code);
+int8_t r_sample_Si7021(Si7021_t* dev, Si7021_sample_t* sample)
+{
+  uint8_t cmd[2] = {Humi_HM, Temp_AH};
+  uint8_t buffer[4];
+  uint32_t start_us;
 
   /* There is a temperature measurement with each RH measurement */
-  cmd = Temp_AH;
+  Si7021_msg_t msgs[4] =
+  {
+    {I2C_Msg_Write, 1, &cmd[0]},
+    {I2C_Msg_Read,  2, &buffer[0]},
+    {I2C_Msg_Write, 1, &cmd[1]},
+    {I2C_Msg_Read,  2, &buffer[2]}
+  };
 
-  if(HAL_OK != HAL_I2C_Master_Transmit(&hi2c1, I2C_ADDR, &cmd, 1, 10000))
-    return -1;
+  lock_bus_Si7021(dev->bus);
 
-  if(HAL_OK != HAL_I2C_Master_Receive(&hi2c1, I2C_ADDR, buffer, 2, 10000))
-    return -1;
+  /* on error the last values are kept, only the status and time are updated */
+  latest_Si7021(dev, sample);
 
-  code = convert_to_uint16(buffer);
-  *temperature = process_temp_code(code);
+  /* the clock is stretched until the conversion is done */
+  start_us = bus_time_us(dev->bus);
+  sample->status = (bus_transfer(dev, msgs, 4) < 0) ? -1 : 0;
+  stamp_sample(dev, sample, start_us, bus_time_us(dev->bus));
 
-  return 0;
+  if(sample->status == 0)
+  {
+    sample->humi_code = convert_to_uint16(&buffer[0]);
+    sample->temp_code = convert_to_uint16(&buffer[2]);
+    note_conversion(dev, Humidity, sample->humi_code, sample->start_us, sample->end_us);
+    dev->pending_type = SI7021_NO_MEASUREMENT;
+  }
+
+  publish_sample(dev, sample);
+
+  unlock_bus_Si7021(dev->bus);
+
+  return sample->status;
 }
 
-int8_t r_firmware_rev_Si7021()
+int8_t latest_Si7021(Si7021_t* dev, Si7021_sample_t* sample)
 {
-  uint16_t cmd = (R_Firm_rev2<<8) | R_Firm_rev1;
-  uint8_t data;
+  uint32_t seq1, seq2;
 
-  if(HAL_OK != HAL_I2C_Master_Transmit(&hi2c1, I2C_ADDR, (uint8_t*)(&cmd), 2, 10000))
-    return -1;
+  do
+  {
+    seq1 = __atomic_load_n(&(dev->snapshot_seq), __ATOMIC_ACQUIRE);
 
-  if(HAL_OK != HAL_I2C_Master_Receive(&hi2c1, I2C_ADDR, &data, 1, 10000))
-    return -1;
+    *sample = dev->snapshot;
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    seq2 = __atomic_load_n(&(dev->snapshot_seq), __ATOMIC_RELAXED);
+  }
+  while((seq1 & 1) || seq1 != seq2);
 
-  switch(data)
+  if(seq1 == 0)
   {
-    case 0xFF: return 1;
-    case 0x20: return 2;
-    default: return -1;
+    /* nothing published yet */
+    sample->humi_code = 0;
+    sample->temp_code = 0;
+    sample->timestamp = 0;
+    sample->start_us = 0;
+    sample->end_us = 0;
+    sample->status = -1;
+    sample->resolution = dev->user_register_1 & USER_REG_1_RES;
+    sample->flags = 0;
   }
+
+  return sample->status;
 }
 
-int8_t set_resolution_Si7021(Si7021_resolution_t resolution)
+int8_t r_latest_Si7021(Si7021_t* dev, uint32_t max_age, Si7021_sample_t* sample)
 {
+  uint32_t seq = __atomic_load_n(&(dev->snapshot_seq), __ATOMIC_ACQUIRE);
   int8_t rv;
-  uint8_t temp = user_register_1;
 
-  switch(resolution)
+  /* without a clock the age is unknown, every sample is outdated */
+  if(latest_Si7021(dev, sample) == 0 && dev->bus->now_ms != NULL &&
+     bus_time(dev->bus) - sample->timestamp <= max_age)
+    return 0;
+
+  lock_bus_Si7021(dev->bus);
+
+  /* another task measured while this one was waiting for the bus */
+  if(latest_Si7021(dev, sample) == 0 &&
+     __atomic_load_n(&(dev->snapshot_seq), __ATOMIC_RELAXED) != seq)
+    rv = 0;
+  else
+    rv = r_sample_Si7021(dev, sample);
+
+  unlock_bus_Si7021(dev->bus);
+
+  return rv;
+}
+
+void conversion_times_Si7021(Si7021_t* dev, uint32_t* start_us, uint32_t* end_us)
+{
+  lock_bus_Si7021(dev->bus);
+
+  *start_us = dev->conv_start_us;
+  *end_us = dev->conv_end_us;
+
+  unlock_bus_Si7021(dev->bus);
+}
+
+int8_t r_firmware_rev_Si7021(Si7021_t* dev)
+{
+  const uint8_t cmd[2] = {R_Firm_rev1, R_Firm_rev2};
+  uint8_t data;
+  int8_t rv;
+
+  lock_bus_Si7021(dev->bus);
+
+  rv = transact(dev, cmd, 2, &data, 1);
+
+  if(rv == 0)
   {
-    case H12_T14:
-    {
-      user_register_1 &= (uint8_t)(~(1<<RES1) & ~(1<<RES0));
-      rv = w_reg(user_register_1, User_Register_1);
-      break;
-    }
-    case H8_T12:
+    switch(data)
     {
-      user_register_1 &= (uint8_t)(~(1<<RES1));
-      user_register_1 |= (1<<RES0);
-      rv = w_reg(user_register_1, User_Register_1);
-      break;
+      case 0xFF: rv = 1; break;
+      case 0x20: rv = 2; break;
+      default: rv = -1; break;
     }
-    case H10_T13:
-    {
-      user_register_1 &= ~(1<<RES0);
-      user_register_1 |= (1<<RES1);
-      rv = w_reg(user_register_1, User_Register_1);
-      break;
-    }
-    case H11_T11:
-    {
-      user_register_1 |= (1<<RES1) | (1<<RES0);
-      rv = w_reg(user_register_1, User_Register_1);
-      break;
-    }
-    default: return -1;
   }
 
-  /* in case of write error restore local copy of the register value */
-  if(rv < 0)
-    user_register_1 = temp;
+  if(rv > 0)
+    dev->firmware_rev = (uint8_t)rv;
 
-  return rv;
+  unlock_bus_Si7021(dev->bus);
+
+  return (rv < 0) ? -1 : rv;
 }
 
-Si7021_resolution_t r_resolution_Si7021()
+int8_t r_serial_Si7021(Si7021_t* dev, uint32_t* serial_a, uint32_t* serial_b)
 {
-  if(r_reg(User_Register_1) < 0)
+  const uint8_t cmd[4] = {R_ID_Byte11, R_ID_Byte12, R_ID_Byte21, R_ID_Byte22};
+  uint8_t buffer[14];
+
+  /* 1st access: SNA_3, CRC, SNA_2, CRC, SNA_1, CRC, SNA_0, CRC
+     2nd access: SNB_3, SNB_2, CRC, SNB_1, SNB_0, CRC */
+  Si7021_msg_t msgs[4] =
+  {
+    {I2C_Msg_Write, 2, (uint8_t*)&cmd[0]},
+    {I2C_Msg_Read,  8, &buffer[0]},
+    {I2C_Msg_Write, 2, (uint8_t*)&cmd[2]},
+    {I2C_Msg_Read,  6, &buffer[8]}
+  };
+
+  uint32_t a, b;
+  int8_t rv = -1;
+
+  lock_bus_Si7021(dev->bus);
+
+  if(bus_transfer(dev, msgs, 4) == 0 &&
+     check_id_bytes(&buffer[0], 8, 1, &a) == 0 && check_id_bytes(&buffer[8], 6, 2, &b) == 0)
+  {
+    dev->serial_a = a;
+    dev->serial_b = b;
+    rv = 0;
+  }
+
+  unlock_bus_Si7021(dev->bus);
+
+  if(rv < 0)
     return -1;
 
-  return (user_register_1 & ((1<<RES1) | (1<<RES0)));
+  if(serial_a != NULL)
+    *serial_a = a;
+
+  if(serial_b != NULL)
+    *serial_b = b;
+
+  return 0;
 }
 
-int8_t set_heater_current_Si7021(uint8_t current)
+int16_t enumerate_Si7021(Si7021_bus_t* const buses[], uint8_t bus_count,
+                         Si7021_t table[], uint8_t table_size)
 {
-  uint8_t reg_val = (current - HEATER_CURRENT_OFFSET)/HEATER_CURRENT_STEP;
+  uint8_t b, channel, channels;
+  uint8_t found = 0;
 
-  if(reg_val > 0x0F)
-    reg_val = 0x0F;
+  for(b = 0; b < bus_count; b++)
+  {
+    channels = (buses[b]->select != NULL) ? buses[b]->channels : 1;
 
-  if(w_reg(reg_val, Heater_Control_Register) < 0)
-    return -1;
+    for(channel = 0; channel < channels; channel++)
+    {
+      if(found >= table_size)
+        return found;
 
-  /* in case of write success update local copy of the register value */
-  heater_control_register = reg_val;
+      attach_Si7021(&table[found], buses[b], channel);
 
-  return 0;
+      /* a missing sensor does not acknowledge the first ID access, go on with the next one */
+      if(r_serial_Si7021(&table[found], NULL, NULL) < 0)
+        continue;
+
+      if(r_firmware_rev_Si7021(&table[found]) < 0)
+        continue;
+
+      found++;
+    }
+  }
+
+  return found;
 }
 
-int8_t r_heater_current_Si7021()
+int8_t set_resolution_Si7021(Si7021_t* dev, Si7021_resolution_t resolution)
 {
-  if(r_reg(Heater_Control_Register) < 0)
+  if(resolution & ~USER_REG_1_RES)
     return -1;
 
-  return ((heater_control_register & (0x0F)) * HEATER_CURRENT_STEP) + HEATER_CURRENT_OFFSET;
+  config_begin_Si7021(dev);
+  stage_resolution_Si7021(dev, resolution);
+
+  return config_commit_Si7021(dev);
 }
 
-int8_t VDD_warning_Si7021()
+Si7021_resolution_t r_resolution_Si7021(Si7021_t* dev)
 {
-  if(r_reg(User_Register_1) < 0)
+  uint8_t value;
+
+  if(r_reg_locked(dev, User_Register_1, &value) < 0)
     return -1;
 
-  if(user_register_1 & (1<<VDDS))
-    return 1;
-  else
-    return 0;
+  return (value & ((1<<RES1) | (1<<RES0)));
 }
 
-int8_t enable_heater_Si7021(uint8_t val)
+int8_t set_heater_current_Si7021(Si7021_t* dev, uint8_t current)
 {
-  int8_t rv;
-  uint8_t temp = user_register_1;
+  config_begin_Si7021(dev);
+  stage_heater_current_Si7021(dev, current);
 
-  if(val == 0)
-  {
-    user_register_1 &= ~(1<<HTRE);
-    rv = w_reg(user_register_1, User_Register_1);
-  }
-  else
-  {
-    user_register_1 |= (1<<HTRE);
-    rv = w_reg(user_register_1, User_Register_1);
-  }
+  return config_commit_Si7021(dev);
+}
 
-  /* in case of write error restore local copy of the register value */
-  if(rv < 0)
-    user_register_1 = temp;
+int8_t r_heater_current_Si7021(Si7021_t* dev)
+{
+  uint8_t value;
 
-  return rv;
+  if(r_reg_locked(dev, Heater_Control_Register, &value) < 0)
+    return -1;
+
+  return ((value & (0x0F)) * HEATER_CURRENT_STEP) + HEATER_CURRENT_OFFSET;
 }
 
-int8_t rst_Si7021()
+int8_t VDD_warning_Si7021(Si7021_t* dev)
 {
-  uint8_t cmd = Si7021_Reset;
+  uint8_t value;
 
-  if(HAL_OK != HAL_I2C_Master_Transmit(&hi2c1, I2C_ADDR, &cmd, 1, 10000))
+  if(r_reg_locked(dev, User_Register_1, &value) < 0)
     return -1;
+
+  if(value & (1<<VDDS))
+    return 1;
   else
     return 0;
 }
 
-int8_t get_register(Si7021_registers_t reg, uint8_t* rv)
+int8_t enable_heater_Si7021(Si7021_t* dev, uint8_t val)
 {
-  if(r_reg(reg) < 0)
-    return -1;
+  config_begin_Si7021(dev);
+  stage_heater_Si7021(dev, val);
 
-  if(reg == User_Register_1)
-    *rv = user_register_1;
-  else
-    *rv = heater_control_register;
+  return config_commit_Si7021(dev);
+}
 
-  return 0;
+int8_t rst_Si7021(Si7021_t* dev)
+{
+  uint8_t cmd = Si7021_Reset;
+  int8_t rv;
+
+  lock_bus_Si7021(dev->bus);
+
+  rv = transact(dev, &cmd, 1, NULL, 0);
+
+  if(rv == 0)
+  {
+    /* the reset also ends a started conversion */
+    dev->rh_valid = 0;
+    dev->pending_type = SI7021_NO_MEASUREMENT;
+    dev->user_register_1 = SI7021_USER_REG_1_DEFAULT;
+    dev->heater_control_register = SI7021_HEATER_REG_DEFAULT;
+  }
+
+  unlock_bus_Si7021(dev->bus);
+
+  return rv;
+}
+
+int8_t get_register(Si7021_t* dev, Si7021_registers_t reg, uint8_t* rv)
+{
+  return r_reg_locked(dev, reg, rv);
 }
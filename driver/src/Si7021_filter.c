@@ -0,0 +1,146 @@
+#include <Si7021_filter.h>
+#include <string.h>
+
+static uint8_t lower_bound(const uint16_t* sorted, uint8_t count, uint16_t value);
+static uint16_t median_update(Si7021_filter_t* filter, uint16_t value);
+
+/* index of the first element not less than 'value' */
+static uint8_t lower_bound(const uint16_t* sorted, uint8_t count, uint16_t value)
+{
+  uint8_t low = 0;
+  uint8_t high = count;
+  uint8_t mid;
+
+  while(low < high)
+  {
+    mid = low + (high - low) / 2;
+
+    if(sorted[mid] < value)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+/*
+*  The oldest value is replaced by the new one in the sorted copy, only the
+*  elements between their positions are moved.
+*/
+static uint16_t median_update(Si7021_filter_t* filter, uint16_t value)
+{
+  uint16_t* sorted = filter->sorted;
+  uint8_t old, pos;
+
+  if(filter->count < filter->window)
+  {
+    pos = lower_bound(sorted, filter->count, value);
+    memmove(&sorted[pos + 1], &sorted[pos], (filter->count - pos) * sizeof(uint16_t));
+    sorted[pos] = value;
+    filter->history[(filter->head + filter->count) % filter->window] = value;
+    filter->count++;
+  }
+  else
+  {
+    old = lower_bound(sorted, filter->count, filter->history[filter->head]);
+    pos = lower_bound(sorted, filter->count, value);
+
+    if(pos > old)
+    {
+      pos--;
+      memmove(&sorted[old], &sorted[old + 1], (pos - old) * sizeof(uint16_t));
+    }
+    else
+      memmove(&sorted[pos + 1], &sorted[pos], (old - pos) * sizeof(uint16_t));
+
+    sorted[pos] = value;
+    filter->history[filter->head] = value;
+    filter->head = (filter->head + 1) % filter->window;
+  }
+
+  return sorted[(filter->count - 1) / 2];
+}
+
+int8_t filter_init_Si7021(Si7021_filter_t* filter, Si7021_filter_type_t type, uint8_t window,
+                          uint16_t* storage)
+{
+  if(type == Filter_Mean || type == Filter_Median)
+  {
+    if(window == 0 || storage == NULL)
+      return -1;
+  }
+  else if(type == Filter_EMA)
+  {
+    if(window > SI7021_FILTER_MAX_SHIFT)
+      return -1;
+  }
+  else
+    return -1;
+
+  filter->type = type;
+  filter->window = window;
+  filter->history = storage;
+  filter->sorted = (type == Filter_Median) ? &storage[window] : NULL;
+  filter_reset_Si7021(filter);
+
+  return 0;
+}
+
+void filter_reset_Si7021(Si7021_filter_t* filter)
+{
+  filter->count = 0;
+  filter->head = 0;
+  filter->acc = 0;
+}
+
+uint16_t filter_update_Si7021(Si7021_filter_t* filter, uint16_t value)
+{
+  switch(filter->type)
+  {
+    case Filter_Mean:
+      if(filter->count < filter->window)
+      {
+        filter->history[(filter->head + filter->count) % filter->window] = value;
+        filter->count++;
+      }
+      else
+      {
+        filter->acc -= filter->history[filter->head];
+        filter->history[filter->head] = value;
+        filter->head = (filter->head + 1) % filter->window;
+      }
+      filter->acc += value;
+      return (uint16_t)((filter->acc + filter->count / 2) / filter->count);
+
+    case Filter_Median:
+      return median_update(filter, value);
+
+    case Filter_EMA:
+      if(filter->count == 0)
+      {
+        filter->acc = (uint32_t)value << filter->window;
+        filter->count = 1;
+      }
+      else
+        filter->acc = filter->acc - (filter->acc >> filter->window) + value;
+      return (uint16_t)(filter->acc >> filter->window);
+
+    default:
+      return value;
+  }
+}
+
+int8_t filter_sample_Si7021(Si7021_filter_t* humi, Si7021_filter_t* temp, Si7021_sample_t* sample)
+{
+  if(sample->status < 0)
+    return -1;
+
+  if(humi != NULL)
+    sample->humi_code = filter_update_Si7021(humi, sample->humi_code);
+
+  if(temp != NULL)
+    sample->temp_code = filter_update_Si7021(temp, sample->temp_code);
+
+  return 0;
+}
@@ -0,0 +1,159 @@
+#include <Si7021_heater.h>
+
+enum heater_state
+{
+  Heater_Idle,
+  Heater_Start,
+  Heater_On,
+  Heater_Cooling
+};
+
+static int8_t switch_heater(Si7021_heater_t* heater, uint8_t on);
+static void set_cooling(Si7021_t* dev, uint8_t cooling);
+
+/* the current is written first, so the heater never runs at the current of the last pulse */
+static int8_t switch_heater(Si7021_heater_t* heater, uint8_t on)
+{
+  int8_t rv = 0;
+
+  if(on)
+  {
+    config_begin_Si7021(heater->dev);
+    stage_heater_current_Si7021(heater->dev, heater->profile[heater->index].current);
+    rv = config_commit_Si7021(heater->dev);
+  }
+
+  if(rv == 0)
+  {
+    config_begin_Si7021(heater->dev);
+    stage_heater_Si7021(heater->dev, on);
+    rv = config_commit_Si7021(heater->dev);
+  }
+
+  if(rv < 0)
+    heater->failed++;
+
+  return rv;
+}
+
+static void set_cooling(Si7021_t* dev, uint8_t cooling)
+{
+  lock_bus_Si7021(dev->bus);
+
+  if(cooling)
+    dev->sample_flags |= SI7021_SAMPLE_COOLING;
+  else
+    dev->sample_flags &= (uint8_t)~SI7021_SAMPLE_COOLING;
+
+  unlock_bus_Si7021(dev->bus);
+}
+
+void heater_init_Si7021(Si7021_heater_t* heater, Si7021_t* dev)
+{
+  heater->dev = dev;
+  heater->profile = NULL;
+  heater->length = 0;
+  heater->index = 0;
+  heater->state = Heater_Idle;
+  heater->next = 0;
+  heater->pulses = 0;
+  heater->failed = 0;
+}
+
+int8_t heater_start_Si7021(Si7021_heater_t* heater, const Si7021_heater_pulse_t* profile,
+                           uint8_t length, uint32_t now)
+{
+  if(heater->state != Heater_Idle || profile == NULL || length == 0)
+    return -1;
+
+  heater->profile = profile;
+  heater->length = length;
+  heater->index = 0;
+  heater->state = Heater_Start;
+  heater->next = now;
+
+  return 0;
+}
+
+int8_t heater_stop_Si7021(Si7021_heater_t* heater)
+{
+  if(heater->state == Heater_Idle)
+    return 0;
+
+  if(switch_heater(heater, 0) < 0)
+    return -1;
+
+  set_cooling(heater->dev, 0);
+  heater->state = Heater_Idle;
+
+  return 0;
+}
+
+int8_t heater_poll_Si7021(Si7021_heater_t* heater, uint32_t now, uint32_t* wake)
+{
+  while(heater->state != Heater_Idle && (int32_t)(now - heater->next) >= 0)
+  {
+    if(heater->state == Heater_Start)
+    {
+      /* the flags of a sample change once: from cooling to heated */
+      lock_bus_Si7021(heater->dev->bus);
+
+      if(switch_heater(heater, 1) < 0)
+      {
+        unlock_bus_Si7021(heater->dev->bus);
+        break;
+      }
+
+      set_cooling(heater->dev, 0);
+      unlock_bus_Si7021(heater->dev->bus);
+      heater->state = Heater_On;
+      heater->next += heater->profile[heater->index].on_time;
+    }
+    else if(heater->state == Heater_On)
+    {
+      /* flagged before the heater goes off, no sample of the cool-down is left untagged */
+      lock_bus_Si7021(heater->dev->bus);
+      set_cooling(heater->dev, 1);
+
+      if(switch_heater(heater, 0) < 0)
+      {
+        set_cooling(heater->dev, 0);
+        unlock_bus_Si7021(heater->dev->bus);
+        break;
+      }
+
+      unlock_bus_Si7021(heater->dev->bus);
+      heater->state = Heater_Cooling;
+      heater->next += heater->profile[heater->index].cool_time;
+    }
+    else
+    {
+      heater->pulses++;
+      heater->index++;
+
+      if(heater->index < heater->length)
+        heater->state = Heater_Start;
+      else
+      {
+        set_cooling(heater->dev, 0);
+        heater->state = Heater_Idle;
+      }
+    }
+  }
+
+  if(heater->state == Heater_Idle)
+    return 0;
+
+  /* the step is retried, the later steps keep their times */
+  if((int32_t)(now - heater->next) >= 0)
+  {
+    if(wake != NULL)
+      *wake = now + 1;
+    return -1;
+  }
+
+  if(wake != NULL)
+    *wake = heater->next;
+
+  return 1;
+}
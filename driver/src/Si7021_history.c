@@ -0,0 +1,261 @@
+#include <Si7021_history.h>
+
+#define NIBBLE_DATA_BITS   3           // the fourth bit of a nibble marks a continuation
+#define VARINT_NIBBLES     11          // nibbles of a 32 bit value
+#define MAX_SHIFT          4
+
+static uint32_t zigzag(int32_t value);
+static int32_t unzigzag(uint32_t value);
+static uint8_t put_varint(uint8_t* nibbles, uint8_t len, uint32_t value);
+static uint32_t get_varint(const Si7021_history_block_t* block, uint8_t* pos);
+static uint8_t zero_bits(uint16_t code);
+static void new_block(Si7021_history_t* history, const Si7021_sample_t* sample);
+
+/* maps small magnitudes of either sign to small unsigned values: 0, -1, 1, -2 .. */
+static uint32_t zigzag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/* appends the nibbles of a value to 'nibbles', returns the new length */
+static uint8_t put_varint(uint8_t* nibbles, uint8_t len, uint32_t value)
+{
+  while(value >= (1 << NIBBLE_DATA_BITS))
+  {
+    nibbles[len++] = (value & 0x07) | 0x08;
+    value >>= NIBBLE_DATA_BITS;
+  }
+
+  nibbles[len++] = value;
+
+  return len;
+}
+
+static uint32_t get_varint(const Si7021_history_block_t* block, uint8_t* pos)
+{
+  uint32_t value = 0;
+  uint8_t shift = 0;
+  uint8_t nibble;
+
+  do
+  {
+    nibble = block->data[*pos >> 1];
+    nibble = (*pos & 1) ? (nibble >> 4) : (nibble & 0x0F);
+    (*pos)++;
+
+    value |= (uint32_t)(nibble & 0x07) << shift;
+    shift += NIBBLE_DATA_BITS;
+  }
+  while(nibble & 0x08);
+
+  return value;
+}
+
+/* number of zero low bits of a code, e.g. of a reduced resolution measurement */
+static uint8_t zero_bits(uint16_t code)
+{
+  return __builtin_ctz(code | (1 << MAX_SHIFT));
+}
+
+static void new_block(Si7021_history_t* history, const Si7021_sample_t* sample)
+{
+  Si7021_history_block_t* block;
+
+  /* overwrite the oldest block */
+  if(history->used == history->size)
+  {
+    history->first_seq += history->blocks[history->first].count;
+    history->first = (history->first + 1) % history->size;
+    history->used--;
+  }
+
+  block = &(history->blocks[(history->first + history->used) % history->size]);
+  history->used++;
+
+  block->timestamp = sample->timestamp;
+  block->code[0] = sample->humi_code;
+  block->code[1] = sample->temp_code;
+  block->count = 1;
+  block->shift = (zero_bits(sample->humi_code) << 4) | zero_bits(sample->temp_code);
+  block->nibbles = 0;
+  block->resolution = sample->resolution;
+}
+
+int8_t history_init_Si7021(Si7021_history_t* history, Si7021_history_block_t* blocks, uint16_t size)
+{
+  if(blocks == NULL || size == 0)
+    return -1;
+
+  history->blocks = blocks;
+  history->size = size;
+  history->first = 0;
+  history->used = 0;
+  history->first_seq = 0;
+  history->next_seq = 0;
+
+  return 0;
+}
+
+int8_t history_append_Si7021(Si7021_history_t* history, const Si7021_sample_t* sample)
+{
+  Si7021_history_block_t* block = NULL;
+  uint8_t nibbles[3 * VARINT_NIBBLES];
+  uint8_t len = 0;
+  uint8_t shift_h, shift_t, i;
+  uint32_t interval = sample->timestamp - history->last_time;
+
+  if(sample->status < 0)
+    return -1;
+
+  if(history->used > 0)
+  {
+    block = &(history->blocks[(history->first + history->used - 1) % history->size]);
+
+    /* no deltas stored yet, the zero bits may still be reduced */
+    if(block->count == 1)
+    {
+      shift_h = zero_bits(sample->humi_code);
+      shift_t = zero_bits(sample->temp_code);
+
+      if(shift_h > (block->shift >> 4))
+        shift_h = block->shift >> 4;
+      if(shift_t > (block->shift & 0x0F))
+        shift_t = block->shift & 0x0F;
+
+      block->shift = (shift_h << 4) | shift_t;
+    }
+
+    shift_h = block->shift >> 4;
+    shift_t = block->shift & 0x0F;
+
+    if(sample->resolution == block->resolution &&
+       zero_bits(sample->humi_code) >= shift_h && zero_bits(sample->temp_code) >= shift_t)
+    {
+      len = put_varint(nibbles, len, zigzag((int32_t)(interval - history->last_interval)));
+      len = put_varint(nibbles, len, zigzag(((int32_t)sample->humi_code -
+                                             history->last_code[0]) >> shift_h));
+      len = put_varint(nibbles, len, zigzag(((int32_t)sample->temp_code -
+                                             history->last_code[1]) >> shift_t));
+    }
+    else
+      block = NULL;
+
+    if(block != NULL && (block->nibbles + len > 2 * SI7021_HISTORY_BLOCK_DATA ||
+                         block->count == UINT16_MAX))
+      block = NULL;
+  }
+
+  if(block != NULL)
+  {
+    for(i = 0; i < len; i++, block->nibbles++)
+    {
+      if(block->nibbles & 1)
+        block->data[block->nibbles >> 1] |= nibbles[i] << 4;
+      else
+        block->data[block->nibbles >> 1] = nibbles[i];
+    }
+
+    block->count++;
+    history->last_interval = interval;
+  }
+  else
+  {
+    new_block(history, sample);
+    history->last_interval = 0;
+  }
+
+  history->last_time = sample->timestamp;
+  history->last_code[0] = sample->humi_code;
+  history->last_code[1] = sample->temp_code;
+  history->next_seq++;
+
+  return 0;
+}
+
+int8_t history_seek_Si7021(const Si7021_history_t* history, Si7021_history_cursor_t* cursor,
+                           uint32_t seq)
+{
+  Si7021_sample_t sample;
+  uint32_t start = history->first_seq;
+  uint16_t i, block = history->first;
+
+  if(seq < history->first_seq)
+    seq = history->first_seq;
+
+  if(seq >= history->next_seq)
+    return -1;
+
+  for(i = 0; i < history->used; i++)
+  {
+    block = (history->first + i) % history->size;
+
+    if(seq - start < history->blocks[block].count)
+      break;
+
+    start += history->blocks[block].count;
+  }
+
+  cursor->seq = start;
+  cursor->block = block;
+  cursor->index = 0;
+  cursor->nibble = 0;
+
+  /* deltas are decoded from the first sample of the block */
+  while(cursor->seq < seq)
+    history_next_Si7021(history, cursor, &sample);
+
+  return 0;
+}
+
+int8_t history_next_Si7021(const Si7021_history_t* history, Si7021_history_cursor_t* cursor,
+                           Si7021_sample_t* sample)
+{
+  const Si7021_history_block_t* block;
+
+  if(cursor->seq < history->first_seq || cursor->seq >= history->next_seq)
+    return -1;
+
+  block = &(history->blocks[cursor->block]);
+
+  if(cursor->index >= block->count)
+  {
+    cursor->block = (cursor->block + 1) % history->size;
+    cursor->index = 0;
+    cursor->nibble = 0;
+    block = &(history->blocks[cursor->block]);
+  }
+
+  if(cursor->index == 0)
+  {
+    cursor->time = block->timestamp;
+    cursor->interval = 0;
+    cursor->code[0] = block->code[0];
+    cursor->code[1] = block->code[1];
+  }
+  else
+  {
+    cursor->interval += unzigzag(get_varint(block, &(cursor->nibble)));
+    cursor->time += cursor->interval;
+    cursor->code[0] += unzigzag(get_varint(block, &(cursor->nibble))) * (1 << (block->shift >> 4));
+    cursor->code[1] += unzigzag(get_varint(block, &(cursor->nibble))) * (1 << (block->shift & 0x0F));
+  }
+
+  cursor->index++;
+  cursor->seq++;
+
+  sample->humi_code = cursor->code[0];
+  sample->temp_code = cursor->code[1];
+  sample->timestamp = cursor->time;
+  sample->start_us = 0;
+  sample->end_us = 0;
+  sample->status = 0;
+  sample->resolution = block->resolution;
+  sample->flags = 0;
+
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include <Si7021_jitter.h>
+
+#define HALF_BINS   (SI7021_JITTER_BINS / 2)
+
+static uint8_t bin_of(const Si7021_jitter_t* jit, int32_t dev);
+
+/* histogram bin of a deviation, the outermost bins are open-ended */
+static uint8_t bin_of(const Si7021_jitter_t* jit, int32_t dev)
+{
+  int32_t bin;
+
+  if(dev >= 0)
+    bin = HALF_BINS + (int32_t)((uint32_t)dev / jit->bin_width);
+  else
+    bin = HALF_BINS - 1 - (int32_t)((uint32_t)(-(dev + 1)) / jit->bin_width);
+
+  if(bin < 0)
+    return 0;
+
+  if(bin >= SI7021_JITTER_BINS)
+    return SI7021_JITTER_BINS - 1;
+
+  return (uint8_t)bin;
+}
+
+void jitter_init_Si7021(Si7021_jitter_t* jit, uint32_t period, uint32_t bin_width)
+{
+  uint8_t i;
+
+  jit->period = period;
+  jit->bin_width = (bin_width == 0) ? 1 : bin_width;
+
+  for(i = 0; i < SI7021_JITTER_BINS; i++)
+    jit->bins[i] = 0;
+
+  jit->count = 0;
+  jit->min_dev = 0;
+  jit->max_dev = 0;
+  jit->sum_dev = 0;
+  jit->max_conversion = 0;
+  jit->last_start = 0;
+  jit->started = 0;
+}
+
+void jitter_add_Si7021(Si7021_jitter_t* jit, const Si7021_sample_t* sample)
+{
+  int64_t diff;
+  int32_t dev;
+
+  if(sample->status < 0)
+  {
+    jit->started = 0;
+    return;
+  }
+
+  if(sample->end_us - sample->start_us > jit->max_conversion)
+    jit->max_conversion = sample->end_us - sample->start_us;
+
+  if(jit->started)
+  {
+    diff = (int64_t)(uint32_t)(sample->start_us - jit->last_start) - jit->period;
+
+    if(diff > INT32_MAX)
+      dev = INT32_MAX;
+    else if(diff < INT32_MIN)
+      dev = INT32_MIN;
+    else
+      dev = (int32_t)diff;
+
+    if(jit->count == 0 || dev < jit->min_dev)
+      jit->min_dev = dev;
+
+    if(jit->count == 0 || dev > jit->max_dev)
+      jit->max_dev = dev;
+
+    jit->bins[bin_of(jit, dev)]++;
+    jit->sum_dev += dev;
+    jit->count++;
+  }
+
+  jit->last_start = sample->start_us;
+  jit->started = 1;
+}
+
+uint32_t jitter_max_Si7021(const Si7021_jitter_t* jit)
+{
+  uint32_t low, high;
+
+  if(jit->count == 0)
+    return 0;
+
+  low = (jit->min_dev < 0) ? (uint32_t)(-(int64_t)jit->min_dev) : 0;
+  high = (jit->max_dev > 0) ? (uint32_t)jit->max_dev : 0;
+
+  return (low > high) ? low : high;
+}
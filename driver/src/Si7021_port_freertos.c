@@ -0,0 +1,30 @@
+#include <Si7021_port_freertos.h>
+
+int8_t Si7021_freertos_lock_init(Si7021_bus_t* bus)
+{
+  SemaphoreHandle_t mutex = xSemaphoreCreateRecursiveMutex();
+
+  if(mutex == NULL)
+    return -1;
+
+  bus->mutex = (void*)mutex;
+  bus->lock = Si7021_freertos_lock;
+  bus->unlock = Si7021_freertos_unlock;
+
+  return 0;
+}
+
+void Si7021_freertos_lock(void* mutex)
+{
+  xSemaphoreTakeRecursive((SemaphoreHandle_t)mutex, portMAX_DELAY);
+}
+
+void Si7021_freertos_unlock(void* mutex)
+{
+  xSemaphoreGiveRecursive((SemaphoreHandle_t)mutex);
+}
+
+void Si7021_freertos_sleep(void* ctx, uint32_t ms)
+{
+  vTaskDelay((ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
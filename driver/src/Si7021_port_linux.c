@@ -0,0 +1,108 @@
+/* clock_gettime, nanosleep and O_CLOEXEC also in strict ISO C builds */
+#define _POSIX_C_SOURCE 200809L
+
+#include <Si7021_port_linux.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#define MAX_MSGS   I2C_RDWR_IOCTL_MAX_MSGS
+
+int8_t Si7021_linux_open(Si7021_linux_i2c_t* i2c, const char* device)
+{
+  unsigned long funcs = 0;
+
+  i2c->ioctls = 0;
+  i2c->errors = 0;
+  i2c->fd = open(device, O_RDWR | O_CLOEXEC);
+
+  if(i2c->fd < 0)
+    return -1;
+
+  /* the transfers are combined messages with repeated starts */
+  if(ioctl(i2c->fd, I2C_FUNCS, &funcs) < 0 || !(funcs & I2C_FUNC_I2C))
+  {
+    close(i2c->fd);
+    i2c->fd = -1;
+    return -1;
+  }
+
+  return 0;
+}
+
+void Si7021_linux_close(Si7021_linux_i2c_t* i2c)
+{
+  if(i2c->fd >= 0)
+    close(i2c->fd);
+
+  i2c->fd = -1;
+}
+
+int8_t Si7021_linux_transfer(void* ctx, uint16_t addr, Si7021_msg_t* msgs, uint8_t count)
+{
+  Si7021_linux_i2c_t* i2c = (Si7021_linux_i2c_t*)ctx;
+  struct i2c_msg kmsgs[MAX_MSGS];
+  struct i2c_rdwr_ioctl_data data = {kmsgs, count};
+  uint8_t i;
+  int rv;
+
+  if(count == 0 || count > MAX_MSGS)
+    return -1;
+
+  for(i = 0; i < count; i++)
+  {
+    kmsgs[i].addr = addr;
+    kmsgs[i].flags = (msgs[i].dir == I2C_Msg_Read) ? I2C_M_RD : 0;
+    kmsgs[i].len = msgs[i].len;
+    kmsgs[i].buf = msgs[i].buf;
+  }
+
+  do
+  {
+    rv = ioctl(i2c->fd, I2C_RDWR, &data);
+    i2c->ioctls++;
+  }
+  while(rv < 0 && errno == EINTR);
+
+  if(rv >= 0)
+    return 0;
+
+  i2c->errors++;
+
+  /* the adapter drivers report a not acknowledged address either way */
+  if(errno == ENXIO || errno == EREMOTEIO)
+    return SI7021_NACK;
+
+  return -1;
+}
+
+void Si7021_linux_delay_ms(uint32_t ms)
+{
+  struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+
+  while(nanosleep(&ts, &ts) < 0 && errno == EINTR)
+    ;
+}
+
+uint32_t Si7021_linux_now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  /* unsigned, so the time wraps instead of overflowing with a 32-bit time_t */
+  return (uint32_t)ts.tv_sec * 1000u + (uint32_t)(ts.tv_nsec / 1000000);
+}
+
+uint32_t Si7021_linux_now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint32_t)ts.tv_sec * 1000000u + (uint32_t)(ts.tv_nsec / 1000);
+}
@@ -0,0 +1,35 @@
+#include <Si7021_port_pthread.h>
+
+int8_t Si7021_pthread_lock_init(Si7021_bus_t* bus, pthread_mutex_t* mutex)
+{
+  pthread_mutexattr_t attr;
+  int8_t rv = 0;
+
+  if(pthread_mutexattr_init(&attr) != 0)
+    return -1;
+
+  if(pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0 ||
+     pthread_mutex_init(mutex, &attr) != 0)
+    rv = -1;
+
+  pthread_mutexattr_destroy(&attr);
+
+  if(rv == 0)
+  {
+    bus->mutex = (void*)mutex;
+    bus->lock = Si7021_pthread_lock;
+    bus->unlock = Si7021_pthread_unlock;
+  }
+
+  return rv;
+}
+
+void Si7021_pthread_lock(void* mutex)
+{
+  pthread_mutex_lock((pthread_mutex_t*)mutex);
+}
+
+void Si7021_pthread_unlock(void* mutex)
+{
+  pthread_mutex_unlock((pthread_mutex_t*)mutex);
+}
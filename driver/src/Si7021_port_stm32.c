@@ -0,0 +1,81 @@
+#include <Si7021_port_stm32.h>
+
+static const uint32_t I2C_TIMEOUT = 10000;            // HAL timeout of a single transaction in ms
+
+int8_t Si7021_stm32_transfer(void* ctx, uint16_t addr, Si7021_msg_t* msgs, uint8_t count)
+{
+  I2C_HandleTypeDef* hi2c = (I2C_HandleTypeDef*)ctx;
+  HAL_StatusTypeDef status;
+  uint8_t i = 0;
+
+  addr <<= 1;
+
+  while(i < count)
+  {
+    if(msgs[i].dir == I2C_Msg_Write && i + 1 < count && msgs[i + 1].dir == I2C_Msg_Read &&
+       (msgs[i].len == 1 || msgs[i].len == 2))
+    {
+      /* command and read in one combined transaction */
+      uint16_t mem_addr = (msgs[i].len == 1) ? msgs[i].buf[0] :
+                          (uint16_t)((msgs[i].buf[0]<<8) | msgs[i].buf[1]);
+      uint16_t mem_size = (msgs[i].len == 1) ? I2C_MEMADD_SIZE_8BIT : I2C_MEMADD_SIZE_16BIT;
+
+      status = HAL_I2C_Mem_Read(hi2c, addr, mem_addr, mem_size,
+                                msgs[i + 1].buf, msgs[i + 1].len, I2C_TIMEOUT);
+      i += 2;
+    }
+    else if(msgs[i].dir == I2C_Msg_Write)
+    {
+      status = HAL_I2C_Master_Transmit(hi2c, addr, msgs[i].buf, msgs[i].len, I2C_TIMEOUT);
+      i++;
+    }
+    else
+    {
+      status = HAL_I2C_Master_Receive(hi2c, addr, msgs[i].buf, msgs[i].len, I2C_TIMEOUT);
+      i++;
+    }
+
+    if(HAL_OK != status)
+    {
+      if(HAL_I2C_GetError(hi2c) & HAL_I2C_ERROR_AF)
+        return SI7021_NACK;
+      else
+        return -1;
+    }
+  }
+
+  return 0;
+}
+
+void Si7021_stm32_sleep(void* ctx, uint32_t ms)
+{
+  uint32_t start = HAL_GetTick();
+
+  (void)ctx;
+
+  while(HAL_GetTick() - start < ms)
+    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+}
+
+uint32_t Si7021_stm32_now_us(void)
+{
+  uint32_t load = SysTick->LOAD;
+  uint32_t ms, val, pending;
+
+  /* a tick between the reads is seen by the second HAL_GetTick */
+  do
+  {
+    ms = HAL_GetTick();
+    val = SysTick->VAL;
+    pending = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+  }
+  while(ms != HAL_GetTick());
+
+  /* the tick interrupt is held off (masked or a higher priority context) and the counter
+     wrapped before it was read */
+  if(pending && val > load / 2)
+    ms += HAL_GetTickFreq();
+
+  /* the counter counts down from LOAD in a tick */
+  return ms * 1000 + (uint32_t)((uint64_t)(load - val) * HAL_GetTickFreq() * 1000 / (load + 1));
+}
@@ -0,0 +1,111 @@
+#include <Si7021_power.h>
+
+#define MAX_POLLS        5             // fetch retries after the conversion time
+#define SAMPLE_BUS_BITS  93            // 10 bytes with acknowledge bits, start and stop conditions
+#define WAKE_TIME        50            // MCU run time of a wake-up in us
+#define HEATER_OFFSET    3             // heater current in mA at register value 0
+#define HEATER_STEP      6             // heater current mA/LSB
+
+static void sleep_ms(Si7021_lowpower_t* lp, uint32_t ms);
+static uint32_t to_nc(uint64_t pc);
+
+static void sleep_ms(Si7021_lowpower_t* lp, uint32_t ms)
+{
+  lp->slept += ms;
+
+  if(lp->sleep != NULL)
+    lp->sleep(lp->ctx, ms);
+  else if(lp->dev->bus->delay_ms != NULL)
+    lp->dev->bus->delay_ms(ms);
+}
+
+/* pC to nC, saturated e.g. for the heater over a long period */
+static uint32_t to_nc(uint64_t pc)
+{
+  pc /= 1000;
+
+  return (pc > UINT32_MAX) ? UINT32_MAX : (uint32_t)pc;
+}
+
+void lowpower_init_Si7021(Si7021_lowpower_t* lp, Si7021_t* dev, Si7021_sleep_t sleep, void* ctx)
+{
+  lp->dev = dev;
+  lp->sleep = sleep;
+  lp->ctx = ctx;
+  lp->samples = 0;
+  lp->polls = 0;
+  lp->slept = 0;
+}
+
+int8_t lowpower_sample_Si7021(Si7021_lowpower_t* lp, Si7021_sample_t* sample)
+{
+  uint8_t polls = 0;
+  int8_t rv;
+
+  if(start_measurement_Si7021(lp->dev, Humidity) < 0)
+    return -1;
+
+  sleep_ms(lp, (conversion_time_Si7021(lp->dev, Humidity) + 999) / 1000);
+
+  while((rv = fetch_sample_Si7021(lp->dev, sample)) == 1 && polls < MAX_POLLS)
+  {
+    polls++;
+    sleep_ms(lp, 1);
+  }
+
+  lp->polls += polls;
+
+  if(rv != 0)
+    return -1;
+
+  lp->samples++;
+
+  return 0;
+}
+
+/* charges are summed in pC: uA * us */
+void energy_estimate_Si7021(const Si7021_energy_model_t* model, Si7021_t* dev,
+                            Si7021_acquisition_t mode, uint32_t period, Si7021_energy_t* energy)
+{
+  uint32_t conversion = conversion_time_Si7021(dev, Humidity);
+  uint32_t temp_time = conversion_time_Si7021(dev, Temperature);
+  uint32_t bus_time = (SAMPLE_BUS_BITS * 1000UL + model->bus_clock - 1) / model->bus_clock;
+  uint32_t wait, active, heater = 0;
+  uint64_t sensor, bus, mcu, idle;
+
+  if(mode == Acquire_Sleep)
+  {
+    /* the sleep is rounded up to ms, the MCU wakes up once */
+    wait = (conversion + 999) / 1000 * 1000;
+    mcu = (uint64_t)model->run_current * (bus_time + WAKE_TIME) +
+          (uint64_t)model->sleep_current * wait;
+    /* on average one bus line is low while transferring */
+    bus = (uint64_t)model->pullup_current * bus_time;
+  }
+  else
+  {
+    /* the sensor holds SCL low and the MCU polls the bus until the conversion is done */
+    wait = conversion;
+    mcu = (uint64_t)model->run_current * (bus_time + wait);
+    bus = (uint64_t)model->pullup_current * (bus_time + wait);
+  }
+
+  active = bus_time + wait;
+  idle = ((uint64_t)period * 1000 > active) ? (uint64_t)period * 1000 - active : 0;
+
+  sensor = (uint64_t)model->rh_current * (conversion - temp_time) +
+           (uint64_t)model->temp_current * temp_time +
+           model->standby_current * (active - conversion + idle) / 1000;
+
+  if(dev->user_register_1 & (1 << HTRE))
+    heater = ((dev->heater_control_register & 0x0F) * HEATER_STEP + HEATER_OFFSET) * 1000UL;
+
+  sensor += heater * (active + idle);
+  mcu += (uint64_t)model->sleep_current * idle;
+
+  energy->sensor = to_nc(sensor);
+  energy->bus = to_nc(bus);
+  energy->mcu = to_nc(mcu);
+  energy->total = to_nc(sensor + bus + mcu);
+  energy->active = active;
+}
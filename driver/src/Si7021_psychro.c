@@ -0,0 +1,299 @@
+#include <Si7021_psychro.h>
+#include <math.h>
+
+#define MAGNUS_B          17.62f
+#define MAGNUS_C          243.12f
+#define MAGNUS_ES0        6.112f         // saturation vapour pressure at 0 C in hPa
+#define WATER_VAPOUR_K    216.7f         // g*K/(m3*hPa), 100 / specific gas constant of water
+#define KELVIN            273.15f
+#define LN2               0.69314718f
+#define LOG2E             1.44269504f
+#define SQRT2             1.41421356f
+
+#define MAGNUS_B_Q16      1154744        // 17.62 * 2^16
+#define MAGNUS_C_CENTI    24312
+#define KELVIN_CENTI      27315
+#define LOG2E_Q16         94548
+#define LN2_Q16           45426
+#define LOG2_RH100_Q16    1483988        // log2(100 % in 2^-16 %) * 2^16
+#define RH_MIN_Q16        6554           // 0.1 % in 2^-16 %
+#define AH_FIXED_K        1324470        // 216.7 * 6.112 * 1000, see absolute_humidity_fixed_Si7021
+
+#define TABLE_BITS        5              // 32 segments of linear interpolation
+
+/* log2(1 + i / 32) * 2^16 */
+static const uint32_t LOG2_TABLE[] =
+{
+      0,  2909,  5732,  8473, 11136, 13727, 16248, 18704, 21098, 23433, 25711,
+  27936, 30109, 32234, 34312, 36346, 38336, 40286, 42196, 44068, 45904, 47705,
+  49472, 51207, 52911, 54584, 56229, 57845, 59434, 60997, 62534, 64047, 65536
+};
+
+/* 2^(i / 32) * 2^24 */
+static const uint32_t EXP2_TABLE[] =
+{
+  16777216, 17144589, 17520007, 17903645, 18295684, 18696307, 19105703, 19524063,
+  19951585, 20388467, 20834917, 21291142, 21757357, 22233781, 22720638, 23218155,
+  23726566, 24246111, 24777031, 25319578, 25874004, 26440571, 27019544, 27611195,
+  28215802, 28833647, 29465022, 30110222, 30769550, 31443315, 32131834, 32835430,
+  33554432
+};
+
+static float fast_ln(float x);
+static float fast_exp(float x);
+static float limit(float value, float min, float max);
+static float magnus_exponent(float temperature);
+static float heat_index_f(float rh, float t);
+
+static int32_t temp_centi(uint16_t code);
+static int32_t humi_centi(uint16_t code);
+static int32_t humi_q16(uint16_t code);
+static int32_t log2_q16(uint32_t x);
+static uint32_t exp2_q24(int32_t x, int8_t* exponent);
+static int32_t magnus_exponent_q16(int32_t temperature);
+static uint32_t isqrt(uint32_t x);
+
+/* ln(m * 2^e) = e * ln2 + 2 * atanh((m - 1) / (m + 1)), m in [sqrt(0.5), sqrt(2)) */
+static float fast_ln(float x)
+{
+  union { float f; uint32_t u; } v = {x};
+  int32_t e = (int32_t)((v.u >> 23) & 0xFF) - 127;
+  float t, t2;
+
+  v.u = (v.u & 0x007FFFFF) | 0x3F800000;
+
+  if(v.f > SQRT2)
+  {
+    v.f *= 0.5f;
+    e++;
+  }
+
+  t = (v.f - 1.0f) / (v.f + 1.0f);
+  t2 = t * t;
+
+  return e * LN2 + 2.0f * t * (1.0f + t2 * (1.0f / 3 + t2 * (1.0f / 5 + t2 * (1.0f / 7))));
+}
+
+/* exp(x) = 2^k * exp(r), |r| <= ln2 / 2, exp(r) by its Taylor series */
+static float fast_exp(float x)
+{
+  union { float f; uint32_t u; } v;
+  int32_t k = (int32_t)(x * LOG2E + ((x < 0) ? -0.5f : 0.5f));
+  float r = x - k * LN2;
+
+  v.u = (uint32_t)(k + 127) << 23;
+
+  return v.f * (1.0f + r * (1.0f + r * (1.0f / 2 + r * (1.0f / 6 + r * (1.0f / 24 +
+                r * (1.0f / 120 + r * (1.0f / 720)))))));
+}
+
+static float limit(float value, float min, float max)
+{
+  if(value < min)
+    return min;
+  if(value > max)
+    return max;
+  return value;
+}
+
+static float magnus_exponent(float temperature)
+{
+  return MAGNUS_B * temperature / (MAGNUS_C + temperature);
+}
+
+/* NWS heat index, rh in %, t in F */
+static float heat_index_f(float rh, float t)
+{
+  float hi = 0.5f * (t + 61.0f + (t - 68.0f) * 1.2f + rh * 0.094f);
+
+  if((hi + t) / 2 < 80.0f)
+    return hi;
+
+  hi = -42.379f + 2.04901523f * t + 10.14333127f * rh - 0.22475541f * t * rh
+       - 6.83783e-3f * t * t - 5.481717e-2f * rh * rh + 1.22874e-3f * t * t * rh
+       + 8.5282e-4f * t * rh * rh - 1.99e-6f * t * t * rh * rh;
+
+  if(rh < 13.0f && t >= 80.0f && t <= 112.0f)
+    hi -= (13.0f - rh) / 4 * sqrtf((17.0f - fabsf(t - 95.0f)) / 17);
+  else if(rh > 85.0f && t >= 80.0f && t <= 87.0f)
+    hi += (rh - 85.0f) / 10 * (87.0f - t) / 5;
+
+  return hi;
+}
+
+float dew_point_Si7021(float humidity, float temperature)
+{
+  float gamma = fast_ln(limit(humidity, 0.1f, 100.0f) / 100) + magnus_exponent(temperature);
+
+  return MAGNUS_C * gamma / (MAGNUS_B - gamma);
+}
+
+float absolute_humidity_Si7021(float humidity, float temperature)
+{
+  float es = MAGNUS_ES0 * fast_exp(magnus_exponent(temperature));
+
+  return WATER_VAPOUR_K * limit(humidity, 0.0f, 100.0f) / 100 * es / (KELVIN + temperature);
+}
+
+float heat_index_Si7021(float humidity, float temperature)
+{
+  float hi = heat_index_f(limit(humidity, 0.0f, 100.0f), temperature * 9 / 5 + 32);
+
+  return (hi - 32) * 5 / 9;
+}
+
+/* temperature in 0.01 C, see process_temp_code */
+static int32_t temp_centi(uint16_t code)
+{
+  return (int32_t)(((uint32_t)17572 * code + 32768) >> 16) - 4685;
+}
+
+/* humidity in 0.01 %, see process_humi_code */
+static int32_t humi_centi(uint16_t code)
+{
+  int32_t rh = (int32_t)(((uint32_t)12500 * code + 32768) >> 16) - 600;
+
+  if(rh < 0)
+    return 0;
+  if(rh > 10000)
+    return 10000;
+  return rh;
+}
+
+/* humidity in 2^-16 %, see process_humi_code */
+static int32_t humi_q16(uint16_t code)
+{
+  int32_t rh = (int32_t)(125UL * code) - 6 * 65536L;
+
+  if(rh < 0)
+    return 0;
+  if(rh > 100 * 65536L)
+    return 100 * 65536L;
+  return rh;
+}
+
+/* log2(x) * 2^16, x > 0 */
+static int32_t log2_q16(uint32_t x)
+{
+  int32_t e = 31 - __builtin_clz(x);
+  uint32_t m = x << (31 - e);
+  uint32_t i = (m >> (31 - TABLE_BITS)) & ((1 << TABLE_BITS) - 1);
+  uint32_t r = (m >> (15 - TABLE_BITS)) & 0xFFFF;
+
+  return (e << 16) + LOG2_TABLE[i] + (int32_t)(((LOG2_TABLE[i + 1] - LOG2_TABLE[i]) * r) >> 16);
+}
+
+/* 2^(x / 2^16) = (returned value / 2^24) * 2^exponent */
+static uint32_t exp2_q24(int32_t x, int8_t* exponent)
+{
+  uint32_t f = (uint32_t)x & 0xFFFF;
+  uint32_t i = f >> (16 - TABLE_BITS);
+  uint32_t r = f & ((1 << (16 - TABLE_BITS)) - 1);
+
+  /* arithmetic shift, rounds towards minus infinity */
+  *exponent = (int8_t)(x >> 16);
+
+  return EXP2_TABLE[i] + (((EXP2_TABLE[i + 1] - EXP2_TABLE[i]) * r) >> (16 - TABLE_BITS));
+}
+
+/* 17.62 * T / (243.12 + T) * 2^16, temperature in 0.01 C */
+static int32_t magnus_exponent_q16(int32_t temperature)
+{
+  return (int32_t)((int64_t)MAGNUS_B_Q16 * temperature / (MAGNUS_C_CENTI + temperature));
+}
+
+static uint32_t isqrt(uint32_t x)
+{
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+
+  while(bit > x)
+    bit >>= 2;
+
+  while(bit != 0)
+  {
+    if(x >= root + bit)
+    {
+      x -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+      root >>= 1;
+
+    bit >>= 2;
+  }
+
+  return root;
+}
+
+int16_t dew_point_fixed_Si7021(uint16_t humi_code, uint16_t temp_code)
+{
+  int32_t rh = humi_q16(humi_code);
+  int64_t gamma;
+
+  if(rh < RH_MIN_Q16)
+    rh = RH_MIN_Q16;
+
+  gamma = ((int64_t)(log2_q16((uint32_t)rh) - LOG2_RH100_Q16) * LN2_Q16) >> 16;
+  gamma += magnus_exponent_q16(temp_centi(temp_code));
+
+  return (int16_t)(MAGNUS_C_CENTI * gamma / (MAGNUS_B_Q16 - gamma));
+}
+
+/*
+*  AH[mg/m3] = 216.7 * RH[%] / 100 * 6.112 * exp(m) / T[K] * 1000
+*            = 1324470 * RH[2^-16 %] * exp(m) / T[0.01 K] / 2^16
+*  exp(m) = 2^k * f, f in 2^-16 (2^-24 from the table)
+*/
+uint32_t absolute_humidity_fixed_Si7021(uint16_t humi_code, uint16_t temp_code)
+{
+  int32_t t = temp_centi(temp_code);
+  int32_t m = (int32_t)(((int64_t)magnus_exponent_q16(t) * LOG2E_Q16) >> 16);
+  int8_t k;
+  uint64_t ah = (uint64_t)AH_FIXED_K * (uint32_t)humi_q16(humi_code) * (exp2_q24(m, &k) >> 8);
+
+  ah /= (uint32_t)(KELVIN_CENTI + t);
+
+  if(k >= 0)
+    ah <<= k;
+  else
+    ah >>= -k;
+
+  return (uint32_t)((ah + (1ULL << 31)) >> 32);
+}
+
+/*
+*  NWS heat index in F with coefficients scaled by 10^8, temperature and
+*  humidity in 0.01 F and 0.01 %.
+*/
+int32_t heat_index_fixed_Si7021(uint16_t humi_code, uint16_t temp_code)
+{
+  int64_t rh = humi_centi(humi_code);
+  int64_t t = temp_centi(temp_code) * 9 / 5 + 3200;
+  int64_t hi, inner;
+  int64_t d;
+
+  /* Steadman, 0.01 F */
+  hi = (t + 6100 + (t - 6800) * 12 / 10 + rh * 94 / 1000) / 2;
+
+  if(hi + t < 16000)
+    return (int32_t)((hi - 3200) * 5 / 9);
+
+  inner = -22475541 + 122874 * t / 100 + 85282 * rh / 100 - 199 * t * rh / 10000;
+  hi = -4237900000LL + 204901523 * t / 100 + 1014333127 * rh / 100
+       - 683783 * t * t / 10000 - 5481717 * rh * rh / 10000 + inner * t * rh / 10000;
+
+  /* 0.01 F */
+  hi /= 1000000;
+
+  if(rh < 1300 && t >= 8000 && t <= 11200)
+  {
+    d = (t > 9500) ? t - 9500 : 9500 - t;
+    /* (13 - RH) / 4 * sqrt((17 - |T - 95|) / 17), sqrt in 2^-12 */
+    hi -= (1300 - rh) * isqrt((uint32_t)(((1700 - d) << 24) / 1700)) / 4 / 4096;
+  }
+  else if(rh > 8500 && t >= 8000 && t <= 8700)
+    hi += (rh - 8500) * (8700 - t) / 5000;
+
+  return (int32_t)((hi - 3200) * 5 / 9);
+}
@@ -0,0 +1,153 @@
+#include <Si7021_report.h>
+
+static uint16_t code_distance(uint16_t a, uint16_t b);
+static void schedule(Si7021_reporter_t* rep, uint32_t now, uint32_t period);
+
+static uint16_t code_distance(uint16_t a, uint16_t b)
+{
+  return (a > b) ? (a - b) : (b - a);
+}
+
+/* one period after the scheduled measurement, so a late poll does not shift the next ones */
+static void schedule(Si7021_reporter_t* rep, uint32_t now, uint32_t period)
+{
+  rep->next += period;
+
+  /* polled a whole period late: the missed measurements are skipped */
+  if((int32_t)(now - rep->next) >= 0)
+    rep->next = now + period;
+}
+
+void report_init_Si7021(Si7021_reporter_t* rep, Si7021_t* dev, uint32_t period,
+                        Si7021_report_t report, void* ctx)
+{
+  rep->dev = dev;
+  rep->report = report;
+  rep->ctx = ctx;
+  rep->humi_delta = 0;
+  rep->temp_delta = 0;
+  rep->heartbeat = 0;
+  rep->base_period = period;
+  rep->max_period = period;
+  rep->period = period;
+  rep->has_last = 0;
+  rep->started = 0;
+  rep->measured = 0;
+  rep->reported = 0;
+  rep->suppressed = 0;
+  rep->failed = 0;
+}
+
+/* deadbands in codes, see process_humi_code and process_temp_code */
+void report_set_deadband_Si7021(Si7021_reporter_t* rep, uint16_t humidity, uint16_t temperature,
+                                uint32_t heartbeat)
+{
+  uint32_t humi = ((uint32_t)humidity << 16) / 12500;
+  uint32_t temp = ((uint32_t)temperature << 16) / 17572;
+
+  lock_bus_Si7021(rep->dev->bus);
+
+  rep->humi_delta = (humi > UINT16_MAX) ? UINT16_MAX : humi;
+  rep->temp_delta = (temp > UINT16_MAX) ? UINT16_MAX : temp;
+  rep->heartbeat = heartbeat;
+
+  unlock_bus_Si7021(rep->dev->bus);
+}
+
+void report_set_backoff_Si7021(Si7021_reporter_t* rep, uint32_t max_period)
+{
+  lock_bus_Si7021(rep->dev->bus);
+
+  rep->max_period = (max_period < rep->base_period) ? rep->base_period : max_period;
+
+  if(rep->period > rep->max_period)
+    rep->period = rep->max_period;
+
+  unlock_bus_Si7021(rep->dev->bus);
+}
+
+int8_t report_poll_Si7021(Si7021_reporter_t* rep, uint32_t now, uint32_t* wake)
+{
+  Si7021_sample_t sample;
+  uint8_t changed, due;
+  int8_t rv = 0;
+
+  if(rep->started && (int32_t)(now - rep->next) < 0)
+  {
+    if(wake != NULL)
+      *wake = rep->next;
+    return 0;
+  }
+
+  /* other tasks, e.g. the CLI, read the state under the bus lock */
+  lock_bus_Si7021(rep->dev->bus);
+
+  if(!rep->started)
+  {
+    rep->started = 1;
+    rep->next = now;
+  }
+
+  r_sample_Si7021(rep->dev, &sample);
+
+  if(sample.status < 0)
+  {
+    rep->failed++;
+    schedule(rep, now, rep->base_period);
+    rv = -1;
+  }
+  else if(sample.flags & SI7021_SAMPLE_HEATER)
+  {
+    /* readings of the heated sensor are not the ambient values */
+    rep->measured++;
+    rep->suppressed++;
+    schedule(rep, now, rep->period);
+  }
+  else
+  {
+    rep->measured++;
+
+    changed = !rep->has_last ||
+              code_distance(sample.humi_code, rep->last.humi_code) > rep->humi_delta ||
+              code_distance(sample.temp_code, rep->last.temp_code) > rep->temp_delta;
+    due = rep->heartbeat != 0 && rep->has_last && now - rep->last_time >= rep->heartbeat;
+
+    if(changed)
+      rep->period = rep->base_period;
+    else if(rep->period < rep->max_period)
+    {
+      rep->period *= 2;
+
+      if(rep->period > rep->max_period)
+        rep->period = rep->max_period;
+    }
+
+    if(!changed && !due)
+      rep->suppressed++;
+    else
+    {
+      rep->last = sample;
+      rep->last_time = now;
+      rep->has_last = 1;
+      rep->reported++;
+      rv = 1;
+    }
+
+    schedule(rep, now, rep->period);
+
+    /* a backed off period does not delay the heartbeat */
+    if(rep->heartbeat != 0 && (int32_t)(rep->next - (rep->last_time + rep->heartbeat)) > 0)
+      rep->next = rep->last_time + rep->heartbeat;
+  }
+
+  if(wake != NULL)
+    *wake = rep->next;
+
+  unlock_bus_Si7021(rep->dev->bus);
+
+  /* without the lock, the receiver may take its time */
+  if(rv == 1 && rep->report != NULL)
+    rep->report(rep->ctx, &sample);
+
+  return rv;
+}
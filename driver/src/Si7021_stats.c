@@ -0,0 +1,229 @@
+#include <Si7021_stats.h>
+
+#define DQ_MIN(channel)   (channel)
+#define DQ_MAX(channel)   (SI7021_STATS_CHANNELS + (channel))
+
+static uint16_t dq_slot(const Si7021_stats_window_t* win, uint8_t dq, uint16_t i);
+static uint16_t dq_front(const Si7021_stats_window_t* win, uint8_t dq, uint16_t expired);
+static void dq_push(Si7021_stats_window_t* win, uint8_t dq, uint16_t slot);
+static void drop_oldest(Si7021_stats_window_t* win);
+static void expire(Si7021_stats_window_t* win, uint32_t now);
+static void window_add(Si7021_stats_window_t* win, const Si7021_sample_t* sample);
+
+/* slot index stored at position i of a deque */
+static uint16_t dq_slot(const Si7021_stats_window_t* win, uint8_t dq, uint16_t i)
+{
+  return win->slots[(win->dq_head[dq] + i) % win->capacity].deque[dq];
+}
+
+/*
+*  First slot of a deque which is not among the 'expired' oldest samples. The
+*  deque is in order of arrival, so it is the min (max) of the other samples.
+*/
+static uint16_t dq_front(const Si7021_stats_window_t* win, uint8_t dq, uint16_t expired)
+{
+  uint16_t i = 0;
+  uint16_t slot = dq_slot(win, dq, 0);
+
+  while((slot + win->capacity - win->head) % win->capacity < expired)
+    slot = dq_slot(win, dq, ++i);
+
+  return slot;
+}
+
+/*
+*  Pushes a slot to the back of a deque after removing the values it makes
+*  irrelevant: larger ones for a min deque, smaller ones for a max deque.
+*  The front of the deque is the min (max) of the window.
+*/
+static void dq_push(Si7021_stats_window_t* win, uint8_t dq, uint16_t slot)
+{
+  uint8_t channel = dq % SI7021_STATS_CHANNELS;
+  uint16_t value = win->slots[slot].code[channel];
+  uint16_t back;
+
+  while(win->dq_count[dq] > 0)
+  {
+    back = win->slots[dq_slot(win, dq, win->dq_count[dq] - 1)].code[channel];
+
+    if((dq < SI7021_STATS_CHANNELS) ? (back <= value) : (back >= value))
+      break;
+
+    win->dq_count[dq]--;
+  }
+
+  win->slots[(win->dq_head[dq] + win->dq_count[dq]) % win->capacity].deque[dq] = slot;
+  win->dq_count[dq]++;
+}
+
+static void drop_oldest(Si7021_stats_window_t* win)
+{
+  Si7021_stats_slot_t* slot = &(win->slots[win->head]);
+  uint8_t i;
+
+  for(i = 0; i < 2 * SI7021_STATS_CHANNELS; i++)
+  {
+    if(win->dq_count[i] > 0 && dq_slot(win, i, 0) == win->head)
+    {
+      win->dq_head[i] = (win->dq_head[i] + 1) % win->capacity;
+      win->dq_count[i]--;
+    }
+  }
+
+  for(i = 0; i < SI7021_STATS_CHANNELS; i++)
+  {
+    win->sum[i] -= slot->code[i];
+    win->sum_sq[i] -= (uint32_t)slot->code[i] * slot->code[i];
+  }
+
+  win->head = (win->head + 1) % win->capacity;
+  win->count--;
+}
+
+static void expire(Si7021_stats_window_t* win, uint32_t now)
+{
+  while(win->count > 0 && now - win->slots[win->head].timestamp >= win->length)
+    drop_oldest(win);
+}
+
+static void window_add(Si7021_stats_window_t* win, const Si7021_sample_t* sample)
+{
+  uint16_t index;
+  uint8_t i;
+
+  expire(win, sample->timestamp);
+
+  if(win->count == win->capacity)
+  {
+    drop_oldest(win);
+    win->overflows++;
+  }
+
+  index = (win->head + win->count) % win->capacity;
+  win->slots[index].timestamp = sample->timestamp;
+  win->slots[index].code[0] = sample->humi_code;
+  win->slots[index].code[1] = sample->temp_code;
+  win->count++;
+
+  for(i = 0; i < SI7021_STATS_CHANNELS; i++)
+  {
+    win->sum[i] += win->slots[index].code[i];
+    win->sum_sq[i] += (uint32_t)win->slots[index].code[i] * win->slots[index].code[i];
+    dq_push(win, DQ_MIN(i), index);
+    dq_push(win, DQ_MAX(i), index);
+  }
+}
+
+void stats_init_Si7021(Si7021_stats_t* stats)
+{
+  stats->windows = NULL;
+}
+
+int8_t stats_add_window_Si7021(Si7021_stats_t* stats, Si7021_stats_window_t* win, uint32_t length,
+                               Si7021_stats_slot_t* slots, uint16_t capacity)
+{
+  Si7021_stats_window_t** link;
+  uint8_t i;
+
+  if(slots == NULL || capacity == 0)
+    return -1;
+
+  win->length = length;
+  win->slots = slots;
+  win->capacity = capacity;
+  win->head = 0;
+  win->count = 0;
+  win->overflows = 0;
+
+  for(i = 0; i < 2 * SI7021_STATS_CHANNELS; i++)
+  {
+    win->dq_head[i] = 0;
+    win->dq_count[i] = 0;
+  }
+
+  for(i = 0; i < SI7021_STATS_CHANNELS; i++)
+  {
+    win->sum[i] = 0;
+    win->sum_sq[i] = 0;
+  }
+
+  /* appended, so the windows are listed in the order they were added */
+  link = &(stats->windows);
+
+  while(*link != NULL)
+    link = &((*link)->next);
+
+  win->next = NULL;
+  *link = win;
+
+  return 0;
+}
+
+void stats_add_Si7021(Si7021_stats_t* stats, const Si7021_sample_t* sample)
+{
+  Si7021_stats_window_t* win;
+
+  if(sample->status < 0)
+    return;
+
+  for(win = stats->windows; win != NULL; win = win->next)
+    window_add(win, sample);
+}
+
+void stats_query_Si7021(const Si7021_stats_window_t* win, uint32_t now,
+                        Si7021_stats_result_t* result)
+{
+  const Si7021_stats_slot_t* slot;
+  uint32_t sum[SI7021_STATS_CHANNELS];
+  uint64_t sum_sq[SI7021_STATS_CHANNELS];
+  uint16_t expired = 0;
+  uint8_t i;
+
+  for(i = 0; i < SI7021_STATS_CHANNELS; i++)
+  {
+    sum[i] = win->sum[i];
+    sum_sq[i] = win->sum_sq[i];
+  }
+
+  /* the samples older than the window are left to the next stats_add_Si7021 */
+  while(expired < win->count)
+  {
+    slot = &(win->slots[(win->head + expired) % win->capacity]);
+
+    if(now - slot->timestamp < win->length)
+      break;
+
+    for(i = 0; i < SI7021_STATS_CHANNELS; i++)
+    {
+      sum[i] -= slot->code[i];
+      sum_sq[i] -= (uint32_t)slot->code[i] * slot->code[i];
+    }
+
+    expired++;
+  }
+
+  result->count = win->count - expired;
+
+  if(result->count == 0)
+    return;
+
+  for(i = 0; i < SI7021_STATS_CHANNELS; i++)
+  {
+    result->min[i] = win->slots[dq_front(win, DQ_MIN(i), expired)].code[i];
+    result->max[i] = win->slots[dq_front(win, DQ_MAX(i), expired)].code[i];
+    result->mean[i] = (uint16_t)((sum[i] + result->count / 2) / result->count);
+    result->variance[i] = (uint32_t)((sum_sq[i] -
+                          (uint64_t)sum[i] * sum[i] / result->count) / result->count);
+  }
+}
+
+uint32_t stats_memory_Si7021(const Si7021_stats_t* stats)
+{
+  const Si7021_stats_window_t* win;
+  uint32_t size = sizeof(Si7021_stats_t);
+
+  for(win = stats->windows; win != NULL; win = win->next)
+    size += sizeof(Si7021_stats_window_t) + win->capacity * sizeof(Si7021_stats_slot_t);
+
+  return size;
+}
@@ -0,0 +1,147 @@
+#include <Si7021_task.h>
+
+#define MAX_POLLS        10            // retries of a busy sensor, 1 ms apart
+
+static int8_t sample_task_step(Si7021_job_t* job, uint32_t now);
+static int8_t update_task_step(Si7021_job_t* job, uint32_t now);
+static int8_t resolution_task_step(Si7021_job_t* job, uint32_t now);
+static int8_t update_register(Si7021_update_task_t* task);
+static void job_init(Si7021_job_t* job, Si7021_step_t step, uint8_t priority,
+                     Si7021_job_done_t done);
+
+static void job_init(Si7021_job_t* job, Si7021_step_t step, uint8_t priority,
+                     Si7021_job_done_t done)
+{
+  job->step = step;
+  job->done = done;
+  job->ctx = NULL;
+  job->priority = priority;
+  job->started = 0;
+  job->wake = 0;
+  job->next = NULL;
+}
+
+static int8_t sample_task_step(Si7021_job_t* job, uint32_t now)
+{
+  Si7021_sample_task_t* task = (Si7021_sample_task_t*)job;
+  int8_t rv;
+
+  SI7021_TASK_BEGIN(task->line);
+
+  if(start_measurement_Si7021(task->dev, Humidity) < 0)
+    SI7021_TASK_FAIL(task->line);
+
+  task->polls = 0;
+
+  /* the bus is free for the other tasks during the conversion */
+  SI7021_TASK_WAIT_UNTIL(task->line, job,
+                         now + (conversion_time_Si7021(task->dev, Humidity) + 999) / 1000);
+
+  while((rv = fetch_sample_Si7021(task->dev, &(task->sample))) == 1)
+  {
+    if(++task->polls > MAX_POLLS)
+      SI7021_TASK_FAIL(task->line);
+
+    SI7021_TASK_WAIT_UNTIL(task->line, job, now + 1);
+  }
+
+  if(rv < 0)
+    SI7021_TASK_FAIL(task->line);
+
+  SI7021_TASK_END(task->line);
+}
+
+/* read-modify-write without a wait in between, so the local copies stay valid */
+static int8_t update_register(Si7021_update_task_t* task)
+{
+  Si7021_t* dev = task->dev;
+  uint8_t value;
+  int8_t rv;
+
+  lock_bus_Si7021(dev->bus);
+
+  rv = get_register(dev, task->reg, &value);
+
+  if(rv == 0)
+  {
+    config_begin_Si7021(dev);
+
+    value = (value & ~task->mask) | (task->value & task->mask);
+
+    if(task->reg == User_Register_1)
+      dev->staged_user_register_1 = value;
+    else
+      dev->staged_heater_control_register = value;
+
+    rv = config_commit_Si7021(dev);
+  }
+
+  unlock_bus_Si7021(dev->bus);
+
+  return rv;
+}
+
+static int8_t update_task_step(Si7021_job_t* job, uint32_t now)
+{
+  Si7021_update_task_t* task = (Si7021_update_task_t*)job;
+
+  SI7021_TASK_BEGIN(task->line);
+
+  task->polls = 0;
+
+  /* the sensor does not respond while converting */
+  while(update_register(task) < 0)
+  {
+    if(++task->polls > MAX_POLLS)
+      SI7021_TASK_FAIL(task->line);
+
+    SI7021_TASK_WAIT_UNTIL(task->line, job, now + 1);
+  }
+
+  SI7021_TASK_END(task->line);
+}
+
+static int8_t resolution_task_step(Si7021_job_t* job, uint32_t now)
+{
+  Si7021_resolution_task_t* task = (Si7021_resolution_task_t*)job;
+
+  SI7021_TASK_BEGIN(task->line);
+
+  SI7021_TASK_AWAIT(task->line, job, &(task->update.job), now);
+  SI7021_TASK_AWAIT(task->line, job, &(task->sample.job), now);
+
+  SI7021_TASK_END(task->line);
+}
+
+void sample_task_init_Si7021(Si7021_sample_task_t* task, Si7021_t* dev, uint8_t priority,
+                             Si7021_job_done_t done)
+{
+  job_init(&(task->job), sample_task_step, priority, done);
+  task->dev = dev;
+  task->line = 0;
+  task->polls = 0;
+}
+
+void update_task_init_Si7021(Si7021_update_task_t* task, Si7021_t* dev, Si7021_registers_t reg,
+                             uint8_t mask, uint8_t value, uint8_t priority,
+                             Si7021_job_done_t done)
+{
+  job_init(&(task->job), update_task_step, priority, done);
+  task->dev = dev;
+  task->line = 0;
+  task->polls = 0;
+  task->reg = reg;
+  task->mask = mask;
+  task->value = value;
+}
+
+void resolution_task_init_Si7021(Si7021_resolution_task_t* task, Si7021_t* dev,
+                                 Si7021_resolution_t resolution, uint8_t priority,
+                                 Si7021_job_done_t done)
+{
+  job_init(&(task->job), resolution_task_step, priority, done);
+  task->line = 0;
+  update_task_init_Si7021(&(task->update), dev, User_Register_1, (1<<RES1) | (1<<RES0),
+                          resolution, priority, NULL);
+  sample_task_init_Si7021(&(task->sample), dev, priority, NULL);
+}
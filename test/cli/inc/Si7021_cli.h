@@ -2,6 +2,11 @@
 #define SI7021_CLI_H_
 
 #include "stm32f4xx_hal.h"
+#include "Si7021_driver.h"
+#include "Si7021_stats.h"
+#include "Si7021_history.h"
+#include "Si7021_report.h"
+#include "Si7021_jitter.h"
 
 /************************************************************************************************
 * NAME :            uint8_t (*print_t)(uint8_t* buf, uint16_t len)
@@ -29,6 +34,89 @@
 */
 typedef uint8_t (*print_t)(uint8_t* buf, uint16_t len);
 
+typedef struct Si7021_cli_iovec
+{
+  const uint8_t* buf;          // start of the buffer
+  uint16_t       len;          // number of bytes in the buffer
+}Si7021_cli_iovec_t;
+
+/************************************************************************************************
+* NAME :            uint8_t (*printv_t)(const Si7021_cli_iovec_t* iov, uint8_t count)
+*
+* DESCRIPTION :     Gather (vectored) transmit function type definition. The buffers of the
+*                   array shall be transmitted in order, as one submission to the transport.
+*
+* INPUTS :
+*       PARAMETERS:
+*            const Si7021_cli_iovec_t*  iov    array of buffer/length pairs
+*            uint8_t                    count  number of elements in the array
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   uint8_t                 Error code:
+*            Values:
+*
+* NOTES :    Return value is currently not in use.
+*            The buffers are only valid during the call, a transport which sends asynchronously
+*            (e.g. UART DMA) has to copy them or chain them into its descriptors before returning.
+*/
+typedef uint8_t (*printv_t)(const Si7021_cli_iovec_t* iov, uint8_t count);
+
+#define SI7021_CLI_MAX_ARGS      3    // maximum number of arguments of a single command
+#define SI7021_CLI_MAX_COMMANDS  32   // maximum number of registered commands
+#define SI7021_CLI_LINE_LENGTH   128  // maximum length of an input line
+#define SI7021_CLI_SEPARATOR     ';'  // separates the commands of a batch within one line
+#define SI7021_CLI_MAX_SEGMENTS  16   // maximum number of buffers in one response
+
+typedef enum Si7021_cli_arg_type
+{
+  CLI_Arg_U8,                  // 0 ... 255
+  CLI_Arg_U16,                 // 0 ... 65535
+  CLI_Arg_I32                  // full signed 32 bit range
+}Si7021_cli_arg_type_t;
+
+/************************************************************************************************
+* NAME :            int8_t (*Si7021_cli_handler_t)(const int32_t* args, uint8_t argc)
+*
+* DESCRIPTION :     Command handler function type definition.
+*
+* INPUTS :
+*       PARAMETERS:
+*            const int32_t*        args     parsed and range checked arguments of the command,
+*                                           arguments not given on the command line are 0
+*            uint8_t               argc     number of arguments given on the command line
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values: >= 0                   OK
+*                    <  0                   operation failed
+*
+* NOTES :    Handlers shall produce their output by Si7021_cli_respond() so it becomes part of
+*            the combined response of the line.
+*/
+typedef int8_t (*Si7021_cli_handler_t)(const int32_t* args, uint8_t argc);
+
+typedef struct Si7021_cli_command
+{
+  uint8_t               code;                           // command character
+  uint8_t               min_args;                       // number of mandatory arguments
+  uint8_t               max_args;                       // number of accepted arguments
+  Si7021_cli_arg_type_t arg_types[SI7021_CLI_MAX_ARGS]; // type of each argument
+  Si7021_cli_handler_t  handler;                        // function executing the command
+  const char*           help;                           // usage line(s) shown by the help
+}Si7021_cli_command_t;
+
 /************************************************************************************************
 * NAME :            void Si7021_cli_init(print_t func)
 *
@@ -55,12 +143,246 @@ typedef uint8_t (*print_t)(uint8_t* buf, uint16_t len);
 */
 void Si7021_cli_init(print_t func);
 
+/************************************************************************************************
+* NAME :            void Si7021_cli_init_v(printv_t func)
+*
+* DESCRIPTION :     Same as Si7021_cli_init() but sets a gather transmit function. The response
+*                   of a line is passed to it as an array of buffers in one call, so constant
+*                   texts (e.g. register table frames) are not copied into the message buffer.
+*
+* INPUTS :
+*       PARAMETERS:
+*            printv_t             func    function pointer to the gather transmit function
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :   Only one of Si7021_cli_init() and Si7021_cli_init_v() shall be called. When the CLI
+*           is initialised by Si7021_cli_init() the whole response is copied into the message
+*           buffer and sent by a single print call.
+*/
+void Si7021_cli_init_v(printv_t func);
+
+/************************************************************************************************
+* NAME :            void Si7021_cli_set_sensors(Si7021_t* table, uint8_t count)
+*
+* DESCRIPTION :     Sets the sensors the CLI works with, e.g. the table filled by
+*                   enumerate_Si7021(). The commands act on the selected sensor which is the
+*                   first one after this call and can be changed by the 'x' command.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_t*            table   array of sensor handles
+*            uint8_t              count   number of sensors in the array
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :   Sensor commands fail until at least one sensor is set.
+*/
+void Si7021_cli_set_sensors(Si7021_t* table, uint8_t count);
+
+/************************************************************************************************
+* NAME :            void Si7021_cli_set_stats(Si7021_stats_t* table)
+*
+* DESCRIPTION :     Sets the windowed statistics shown by the 's' command. The statistics are
+*                   fed by the application, e.g. by stats_add_Si7021 after each r_sample_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_stats_t*      table   statistics of each sensor, in the order of the table
+*                                         set by Si7021_cli_set_sensors()
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :   The 's' command fails until the statistics are set. It reads them under the bus
+*           lock of the sensor, so a task feeding them in another context shall call
+*           stats_add_Si7021 under lock_bus_Si7021 of the sensor as well.
+*/
+void Si7021_cli_set_stats(Si7021_stats_t* table);
+
+/************************************************************************************************
+* NAME :            void Si7021_cli_set_history(Si7021_history_t* table)
+*
+* DESCRIPTION :     Sets the sample histories read by the 'y' command. The histories are
+*                   fed by the application, e.g. by history_append_Si7021 after each
+*                   r_sample_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_history_t*    table   history of each sensor, in the order of the table
+*                                         set by Si7021_cli_set_sensors()
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :   The 'y' command fails until the histories are set. A range read is sent in chunks
+*           of the message buffer, so it is not limited by the buffer size. The histories are
+*           read under the bus lock of the sensor, so a task appending in another context shall
+*           call history_append_Si7021 under lock_bus_Si7021 of the sensor as well.
+*/
+void Si7021_cli_set_history(Si7021_history_t* table);
+
+/************************************************************************************************
+* NAME :            void Si7021_cli_set_reporters(Si7021_reporter_t* table)
+*
+* DESCRIPTION :     Sets the change detection reporters shown by the 'w' command.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_reporter_t*   table   reporter of each sensor, in the order of the table
+*                                         set by Si7021_cli_set_sensors()
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :   The 'w' command fails until the reporters are set.
+*/
+void Si7021_cli_set_reporters(Si7021_reporter_t* table);
+
+/************************************************************************************************
+* NAME :            void Si7021_cli_set_jitter(Si7021_jitter_t* table)
+*
+* DESCRIPTION :     Sets the jitter measurements shown by the 'j' command. They are fed by the
+*                   application, e.g. by jitter_add_Si7021 after each r_sample_Si7021.
+*
+* INPUTS :
+*       PARAMETERS:
+*            Si7021_jitter_t*     table   jitter measurement of each sensor, in the order of
+*                                         the table set by Si7021_cli_set_sensors()
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :   The 'j' command fails until the jitter measurements are set.
+*/
+void Si7021_cli_set_jitter(Si7021_jitter_t* table);
+
+/************************************************************************************************
+* NAME :            void Si7021_cli_report(void* ctx, const Si7021_sample_t* sample)
+*
+* DESCRIPTION :     Report callback (Si7021_report_t) that sends the reported samples as lines
+*                   to the CLI output.
+*
+* INPUTS :
+*       PARAMETERS:
+*            void*                ctx     index of the sensor, cast to a pointer
+*            Si7021_sample_t*     sample  reported sample
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :   Pass it to report_init_Si7021 to stream the changes of a sensor. It does not use
+*           the response buffer of the CLI, so report_poll_Si7021 may be called from another
+*           task than Si7021_cli_engine. The transmit function set by Si7021_cli_init() or
+*           Si7021_cli_init_v() is then called from both tasks and shall be thread-safe.
+*/
+void Si7021_cli_report(void* ctx, const Si7021_sample_t* sample);
+
+/************************************************************************************************
+* NAME :            int8_t Si7021_cli_register(const Si7021_cli_command_t* cmd)
+*
+* DESCRIPTION :     Adds a command to the command table of the CLI. The built-in commands are
+*                   registered by Si7021_cli_init(), this function allows the application to
+*                   extend the CLI with its own commands.
+*
+* INPUTS :
+*       PARAMETERS:
+*            const Si7021_cli_command_t*  cmd    descriptor of the command, it must remain
+*                                                valid while the CLI is in use
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            Type:   int8_t                 Error code:
+*            Values:  0                     OK
+*                    -1                     invalid descriptor, command code already in use
+*                                           or the command table is full
+*
+* NOTES :   Command codes are printable ASCII characters except the separator and space.
+*           Dispatch is done through a lookup table indexed by the command code.
+*/
+int8_t Si7021_cli_register(const Si7021_cli_command_t* cmd);
+
+/************************************************************************************************
+* NAME :            void Si7021_cli_respond(const char* format, ...)
+*
+* DESCRIPTION :     Appends formatted text to the response of the line currently being executed.
+*                   The response of all the commands of a line is sent by a single transport
+*                   call when the whole line has been executed.
+*
+* INPUTS :
+*       PARAMETERS:
+*            const char*           format   printf style format string
+*            ...                            arguments of the format string
+*       GLOBALS :
+*            None
+* OUTPUTS :
+*       PARAMETERS:
+*            None
+*       GLOBALS :
+*            None
+*       RETURN :
+*            None
+*
+* NOTES :   Text not fitting into the response buffer is truncated.
+*/
+void Si7021_cli_respond(const char* format, ...);
+
 /************************************************************************************************
 * NAME :            void Si7021_cli_engine(uint8_t* char_in)
 *
 * DESCRIPTION :     This functions takes a SINGLE byte input by reference and builds up a command until
 *                   '\r' is received then it parses the command and passes it the the command handler.
-*                   
+*                   A line may hold several commands separated by ';' (e.g. "n 21; l 1; b"), they are
+*                   executed back-to-back and their outputs are sent as one combined response.
 *
 * INPUTS :
 *       PARAMETERS:
@@ -78,6 +400,9 @@ void Si7021_cli_init(print_t func);
 *
 * NOTES :   The input is not a string but a single character which is passed by reference so
 *           the CLI can change its value and set it to 0.
+*           The bus of the selected sensor is locked while the commands of a line are executed,
+*           so other tasks using the driver can not interleave with a batch. The input and
+*           message buffers belong to the CLI, the function shall be called from one task only.
 *                   
 */
 void Si7021_cli_engine(uint8_t* char_in);
@@ -1,463 +1,1185 @@
 #include "Si7021_cli.h"
 #include "Si7021_driver.h"
+#include "Si7021_psychro.h"
+#include "Si7021_stats.h"
+#include "Si7021_history.h"
+#include "Si7021_report.h"
+#include "Si7021_power.h"
+#include "Si7021_jitter.h"
 #include "stdio.h"
+#include "stdlib.h"
 #include "string.h"
+#include "stdarg.h"
+#include "errno.h"
+#include "math.h"
+
+#define CLI_CODE_FIRST  '!'   // first printable command code
+#define CLI_CODE_LAST   '~'   // last printable command code
 
 static print_t print = NULL;
-static uint8_t message[500];
+static printv_t printv = NULL;
+static uint8_t message[1024];
+static uint16_t message_len = 0;
+
+static Si7021_t* sensors = NULL;
+static uint8_t sensor_count = 0;
+static uint8_t selected = 0;
+static Si7021_stats_t* sensor_stats = NULL;
+static Si7021_history_t* sensor_history = NULL;
+static Si7021_reporter_t* sensor_reporters = NULL;
+static Si7021_jitter_t* sensor_jitter = NULL;
+
+/* bus held locked while the commands of a line are executed */
+static Si7021_bus_t* locked_bus = NULL;
+
+/* response of the current line, formatted text points into 'message' */
+static Si7021_cli_iovec_t segments[SI7021_CLI_MAX_SEGMENTS];
+static uint8_t segment_count = 0;
+
+static const char REG_TABLE_FRAME[] =
+    "------------------------------------------------\r\n";
+static const char REG_TABLE_FOOTER[] =
+    "\r\n------------------------------------------------\r\n";
+
+static const Si7021_cli_command_t* commands[SI7021_CLI_MAX_COMMANDS];
+static uint8_t command_count = 0;
+
+/* index + 1 of the command in 'commands' by command code, 0 means not registered */
+static uint8_t command_lookup[CLI_CODE_LAST - CLI_CODE_FIRST + 1];
+
+static const int32_t arg_min[] = {0,   0,      INT32_MIN};
+static const int32_t arg_max[] = {255, 65535,  INT32_MAX};
 
 static void printf_binary(uint8_t value);
+static Si7021_t* selected_sensor(void);
+static uint32_t sensor_time(Si7021_t* dev);
+static void respond_const(const char* text);
+static void respond_reset(void);
+static void respond_flush(void);
+static uint8_t print_adapter(const Si7021_cli_iovec_t* iov, uint8_t count);
+static void register_builtin_commands(void);
+
+static Si7021_t* selected_sensor(void)
+{
+  if(selected >= sensor_count)
+    return NULL;
+
+  return &sensors[selected];
+}
+
+static uint32_t sensor_time(Si7021_t* dev)
+{
+  if(dev->bus->now_ms == NULL)
+    return 0;
+
+  return dev->bus->now_ms();
+}
+
+static int8_t show_humidity(const int32_t* args, uint8_t argc);
+static int8_t show_temperature(const int32_t* args, uint8_t argc);
+static int8_t show_humidity_n_temperature(const int32_t* args, uint8_t argc);
+static int8_t show_psychrometrics(const int32_t* args, uint8_t argc);
+
+static int8_t show_statistics(const int32_t* args, uint8_t argc);
+
+static int8_t show_history(const int32_t* args, uint8_t argc);
+
+static int8_t show_reporting(const int32_t* args, uint8_t argc);
+
+static int8_t show_energy(const int32_t* args, uint8_t argc);
 
-static int8_t show_humidity(void);
-static int8_t show_temperature(void);
-static int8_t show_humidity_n_temperature(void);
+static int8_t show_jitter(const int32_t* args, uint8_t argc);
 
-static int8_t show_user_reg1(void);
-static int8_t show_heater_control_reg(void);
+static int8_t show_user_reg1(const int32_t* args, uint8_t argc);
+static int8_t show_heater_control_reg(const int32_t* args, uint8_t argc);
 
-static int8_t show_firmware_rev(void);
-static int8_t query_vdd_warning(void);
+static int8_t show_firmware_rev(const int32_t* args, uint8_t argc);
+static int8_t query_vdd_warning(const int32_t* args, uint8_t argc);
 
-static int8_t reset(void);
+static int8_t reset(const int32_t* args, uint8_t argc);
 
-static int8_t show_heater_current(void);
-static int8_t set_heater_current(uint8_t param);
-static int8_t enable_heater(uint8_t param);
+static int8_t show_heater_current(const int32_t* args, uint8_t argc);
+static int8_t set_heater_current(const int32_t* args, uint8_t argc);
+static int8_t enable_heater(const int32_t* args, uint8_t argc);
 
-static int8_t show_measurement_resolutions(void);
-static int8_t set_measurement_resolutions(uint8_t param);
+static int8_t show_measurement_resolutions(const int32_t* args, uint8_t argc);
+static int8_t set_measurement_resolutions(const int32_t* args, uint8_t argc);
 
-static int8_t show_cli_usage_help(void);
+static int8_t show_sensor_table(const int32_t* args, uint8_t argc);
+static int8_t select_sensor(const int32_t* args, uint8_t argc);
 
-static void cli_command_handler(uint8_t command_code, uint8_t param);
+static int8_t show_cli_usage_help(const int32_t* args, uint8_t argc);
+
+static const Si7021_cli_command_t* find_command(uint8_t code);
+static int8_t cli_parse_command(char* text, const Si7021_cli_command_t** cmd,
+                                int32_t* args, uint8_t* argc);
+static void cli_command_handler(char* text);
+static void cli_line_handler(char* line);
+
+static const Si7021_cli_command_t builtin_commands[] =
+{
+  {'h', 0, 0, {0},          show_humidity,                "h: get humidity"},
+  {'t', 0, 0, {0},          show_temperature,             "t: get temperature"},
+  {'b', 0, 0, {0},          show_humidity_n_temperature,  "b: get humidity and temperature"},
+  {'d', 0, 0, {0},          show_psychrometrics,          "d: get dew point, absolute humidity and heat index"},
+  {'s', 0, 0, {0},          show_statistics,              "s: show windowed statistics"},
+  {'y', 0, 2, {CLI_Arg_I32, CLI_Arg_U16}, show_history,
+      "y [<from> <count>]: show the stored history, or stream 'count' samples from sample\r\n"
+      "            number 'from'"},
+  {'w', 0, 0, {0},          show_reporting,               "w: show change reporting counters"},
+  {'p', 0, 1, {CLI_Arg_I32}, show_energy,
+      "p [<period>]: estimate the charge per sample at a sampling period in ms"},
+  {'j', 0, 0, {0},          show_jitter,                  "j: show the sampling period histogram and jitter"},
+  {'u', 0, 0, {0},          show_user_reg1,               "u: read User Register 1"},
+  {'e', 0, 0, {0},          show_heater_control_reg,      "e: read Heater Control Register"},
+  {'f', 0, 0, {0},          show_firmware_rev,            "f: read firmware revision"},
+  {'v', 0, 0, {0},          query_vdd_warning,            "v: get VDD warning status"},
+  {'c', 0, 0, {0},          show_heater_current,          "c: read heater current"},
+  {'m', 0, 0, {0},          show_measurement_resolutions, "m: read measurement resolution"},
+  {'n', 1, 1, {CLI_Arg_U16}, set_heater_current,
+      "n <current>: set heater current in mA"},
+  {'a', 1, 1, {CLI_Arg_U8}, set_measurement_resolutions,
+      "a <option>: set measurement resolution\r\n"
+      "            0: RH 12 bit, Temp 14 bit\r\n"
+      "            1: RH 11 bit, Temp 11 bit\r\n"
+      "            2: RH 10 bit, Temp 13 bit\r\n"
+      "            3: RH  8 bit, Temp 12 bit"},
+  {'l', 1, 1, {CLI_Arg_U8}, enable_heater,
+      "l <enable>: enable or disable on-chip heater\r\n"
+      "            0: disable\r\n"
+      "            1: enable"},
+  {'r', 0, 0, {0},          reset,                        "r: reset Si7021"},
+  {'i', 0, 0, {0},          show_sensor_table,            "i: list sensors"},
+  {'x', 1, 1, {CLI_Arg_U8}, select_sensor,
+      "x <index>: select the sensor used by the commands"},
+  {'?', 0, 0, {0},          show_cli_usage_help,          "?: show this help"}
+};
 
 static void printf_binary(uint8_t value)
 {
   uint8_t i = 0;
-  uint8_t chunk[10];
 
   for(i = 0; i < 8; i++)
   {
-    HAL_Delay(2);
-
-    sprintf((char*)chunk, " %3d |", (value)&(1<<(7 - i))? 1 : 0);
-    print(chunk, strlen((char*)chunk));
+    Si7021_cli_respond(" %3d |", (value)&(1<<(7 - i))? 1 : 0);
   }
-  HAL_Delay(2);
 }
 
-static int8_t show_humidity()
+static int8_t show_humidity(const int32_t* args, uint8_t argc)
 {
+  Si7021_t* dev = selected_sensor();
   float humidity = 0;
   int8_t rv;
 
-  rv = r_single_Si7021(&humidity, Humidity);
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = r_single_Si7021(dev, &humidity, Humidity);
 
   if(rv >= 0)
   {
-    sprintf((char*)message, "Humidity:%0.f%%\r\n", humidity);
-    print(message, strlen((char*)message));
+    Si7021_cli_respond("Humidity:%0.f%%\r\n", humidity);
   }
 
   return rv;
 }
 
-static int8_t show_temperature()
+static int8_t show_temperature(const int32_t* args, uint8_t argc)
 {
+  Si7021_t* dev = selected_sensor();
   float temperature = 0;
   int8_t rv;
 
-  rv = r_single_Si7021(&temperature, Temperature);
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = r_single_Si7021(dev, &temperature, Temperature);
 
   if(rv >= 0)
   {
-    sprintf((char*)message, "Temperature: %.1f C\r\n", temperature);
-    print(message, strlen((char*)message));
+    Si7021_cli_respond("Temperature: %.1f C\r\n", temperature);
   }
 
   return rv;
 }
 
-static int8_t show_humidity_n_temperature()
+static int8_t show_humidity_n_temperature(const int32_t* args, uint8_t argc)
 {
+  Si7021_t* dev = selected_sensor();
   float humidity = 0, temperature = 0;
   int8_t rv;
 
-  rv = r_both_Si7021(&humidity, &temperature);
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = r_both_Si7021(dev, &humidity, &temperature);
 
   if(rv >= 0)
   {
-    sprintf((char*)message,
-        "Humidity: %0.f%% Temperature: %.1f C\r\n", humidity, temperature);
-    print(message, strlen((char*)message));
+    Si7021_cli_respond("Humidity: %0.f%% Temperature: %.1f C\r\n", humidity, temperature);
   }
 
   return rv;
 }
 
-static int8_t show_user_reg1()
+static int8_t show_psychrometrics(const int32_t* args, uint8_t argc)
 {
-  uint8_t reg, rv;
-  rv = get_register(User_Register_1, &reg);
+  Si7021_t* dev = selected_sensor();
+  float humidity = 0, temperature = 0;
+  int8_t rv;
+
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = r_both_Si7021(dev, &humidity, &temperature);
 
   if(rv >= 0)
   {
-    sprintf((char*)message,
-        "\r\nUser Register 1: 0x%02x\r\n"
-        "------------------------------------------------\r\n"
-        " RES1| VDDS| RSVD| RSVD| RSVD| HTRE| RSVD| RES0|\r\n"
-        "------------------------------------------------\r\n", reg);
-    print(message, strlen((char*)message));
+    Si7021_cli_respond("Dew point: %.1f C Absolute humidity: %.2f g/m3 Heat index: %.1f C\r\n",
+                       dew_point_Si7021(humidity, temperature),
+                       absolute_humidity_Si7021(humidity, temperature),
+                       heat_index_Si7021(humidity, temperature));
+  }
+
+  return rv;
+}
+
+static int8_t show_statistics(const int32_t* args, uint8_t argc)
+{
+  Si7021_t* dev = selected_sensor();
+  Si7021_stats_t* stats;
+  Si7021_stats_window_t* win;
+  Si7021_stats_result_t result;
+  uint32_t now;
+
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL || sensor_stats == NULL)
+    return -1;
+
+  stats = &sensor_stats[selected];
+  now = sensor_time(dev);
+
+  /* the acquisition task feeds the statistics under the bus lock of the sensor */
+  lock_bus_Si7021(dev->bus);
+
+  for(win = stats->windows; win != NULL; win = win->next)
+  {
+    stats_query_Si7021(win, now, &result);
+    Si7021_cli_respond("Last %lu ms: %u samples, %lu dropped early\r\n",
+                       (unsigned long)win->length, result.count, (unsigned long)win->overflows);
+
+    if(result.count == 0)
+      continue;
+
+    Si7021_cli_respond("  Humidity min %.1f%% max %.1f%% mean %.1f%% std %.2f%%\r\n",
+                       code_to_humidity_Si7021(result.min[0]),
+                       code_to_humidity_Si7021(result.max[0]),
+                       code_to_humidity_Si7021(result.mean[0]),
+                       sqrtf((float)result.variance[0]) * 125 / 65536);
+    Si7021_cli_respond("  Temperature min %.2f C max %.2f C mean %.2f C std %.3f C\r\n",
+                       code_to_temperature_Si7021(result.min[1]),
+                       code_to_temperature_Si7021(result.max[1]),
+                       code_to_temperature_Si7021(result.mean[1]),
+                       sqrtf((float)result.variance[1]) * 175.72f / 65536);
+  }
+
+  unlock_bus_Si7021(dev->bus);
+
+  Si7021_cli_respond("Memory: %lu bytes\r\n", (unsigned long)stats_memory_Si7021(stats));
+
+  return 0;
+}
+
+static int8_t show_history(const int32_t* args, uint8_t argc)
+{
+  Si7021_t* dev = selected_sensor();
+  Si7021_history_t* history;
+  Si7021_history_cursor_t cursor;
+  Si7021_sample_t sample;
+  uint32_t first, next, bytes, per_sample;
+  uint16_t count;
+  int8_t rv;
+
+  if(dev == NULL || sensor_history == NULL)
+    return -1;
+
+  history = &sensor_history[selected];
+
+  /* the acquisition task appends to the history under the bus lock of the sensor */
+  lock_bus_Si7021(dev->bus);
+  first = history->first_seq;
+  next = history->next_seq;
+  bytes = history->used * sizeof(Si7021_history_block_t);
+  unlock_bus_Si7021(dev->bus);
+
+  if(argc == 0)
+  {
+    per_sample = (next != first) ? bytes * 100 / (next - first) : 0;
+    Si7021_cli_respond("Samples %lu - %lu in %lu bytes, %lu.%02lu bytes per sample\r\n",
+                       (unsigned long)first, (unsigned long)next - 1,
+                       (unsigned long)bytes, (unsigned long)per_sample / 100,
+                       (unsigned long)per_sample % 100);
+    return 0;
+  }
+
+  if(argc < 2 || args[0] < 0)
+    return -1;
+
+  lock_bus_Si7021(dev->bus);
+  rv = history_seek_Si7021(history, &cursor, (uint32_t)args[0]);
+  unlock_bus_Si7021(dev->bus);
+
+  if(rv < 0)
+    return -1;
+
+  for(count = 0; count < args[1]; count++)
+  {
+    /* stops at the end, or if the writer overwrote the next sample */
+    lock_bus_Si7021(dev->bus);
+    rv = history_next_Si7021(history, &cursor, &sample);
+    unlock_bus_Si7021(dev->bus);
+
+    if(rv < 0)
+      break;
+
+    Si7021_cli_respond("%lu %lu %.2f %.2f\r\n", (unsigned long)cursor.seq - 1,
+                       (unsigned long)sample.timestamp, code_to_humidity_Si7021(sample.humi_code),
+                       code_to_temperature_Si7021(sample.temp_code));
+
+    /* stream the samples in chunks of the message buffer */
+    if(message_len > sizeof(message) - 64)
+      respond_flush();
+  }
+
+  return 0;
+}
+
+static int8_t show_reporting(const int32_t* args, uint8_t argc)
+{
+  Si7021_reporter_t* rep;
+
+  (void)args;
+  (void)argc;
+
+  if(selected_sensor() == NULL || sensor_reporters == NULL)
+    return -1;
+
+  rep = &sensor_reporters[selected];
+
+  /* the reporter task updates the counters under the bus lock of the sensor */
+  lock_bus_Si7021(rep->dev->bus);
+
+  Si7021_cli_respond("Measured %lu reported %lu suppressed %lu failed %lu\r\n",
+                     (unsigned long)rep->measured, (unsigned long)rep->reported,
+                     (unsigned long)rep->suppressed, (unsigned long)rep->failed);
+  Si7021_cli_respond("Deadband RH %.2f%% T %.2f C, heartbeat %lu ms, period %lu ms (%lu - %lu)\r\n",
+                     rep->humi_delta * 125.0f / 65536, rep->temp_delta * 175.72f / 65536,
+                     (unsigned long)rep->heartbeat, (unsigned long)rep->period,
+                     (unsigned long)rep->base_period, (unsigned long)rep->max_period);
+
+  unlock_bus_Si7021(rep->dev->bus);
+
+  return 0;
+}
+
+static int8_t show_energy(const int32_t* args, uint8_t argc)
+{
+  static const Si7021_energy_model_t model = SI7021_ENERGY_MODEL_DEFAULT;
+  static const char* const mode_names[] = {"Hold Master", "Sleep"};
+  Si7021_t* dev = selected_sensor();
+  Si7021_energy_t energy;
+  uint32_t period = (argc > 0) ? (uint32_t)args[0] : 1000;
+  uint8_t mode;
+
+  if(dev == NULL || (argc > 0 && args[0] < 0))
+    return -1;
+
+  Si7021_cli_respond("Charge per sample at %lu ms period:\r\n", (unsigned long)period);
+
+  for(mode = Acquire_Hold_Master; mode <= Acquire_Sleep; mode++)
+  {
+    energy_estimate_Si7021(&model, dev, (Si7021_acquisition_t)mode, period, &energy);
+    Si7021_cli_respond("  %-11s %lu nC (sensor %lu bus %lu MCU %lu), active %lu us\r\n",
+                       mode_names[mode], (unsigned long)energy.total,
+                       (unsigned long)energy.sensor, (unsigned long)energy.bus,
+                       (unsigned long)energy.mcu, (unsigned long)energy.active);
+  }
+
+  return 0;
+}
+
+static int8_t show_jitter(const int32_t* args, uint8_t argc)
+{
+  Si7021_jitter_t* jit;
+  long low;
+  uint8_t i;
+
+  (void)args;
+  (void)argc;
+
+  if(selected_sensor() == NULL || sensor_jitter == NULL)
+    return -1;
+
+  jit = &sensor_jitter[selected];
+
+  Si7021_cli_respond("Periods %lu, nominal %lu us, jitter %lu us, conversion up to %lu us\r\n",
+                     (unsigned long)jit->count, (unsigned long)jit->period,
+                     (unsigned long)jitter_max_Si7021(jit), (unsigned long)jit->max_conversion);
+
+  if(jit->count == 0)
+    return 0;
+
+  Si7021_cli_respond("Deviation min %+ld max %+ld mean %+ld us\r\n", (long)jit->min_dev,
+                     (long)jit->max_dev, (long)(jit->sum_dev / jit->count));
+
+  for(i = 0; i < SI7021_JITTER_BINS; i++)
+  {
+    low = ((long)i - SI7021_JITTER_BINS / 2) * (long)jit->bin_width;
+
+    if(i == 0)
+      Si7021_cli_respond("  %9s < %+7ld us: %lu\r\n", "", low + (long)jit->bin_width,
+                         (unsigned long)jit->bins[i]);
+    else if(i == SI7021_JITTER_BINS - 1)
+      Si7021_cli_respond("  %8s >= %+7ld us: %lu\r\n", "", low, (unsigned long)jit->bins[i]);
+    else
+      Si7021_cli_respond("  %+7ld ... %+7ld us: %lu\r\n", low, low + (long)jit->bin_width - 1,
+                         (unsigned long)jit->bins[i]);
+  }
+
+  return 0;
+}
+
+static int8_t show_user_reg1(const int32_t* args, uint8_t argc)
+{
+  Si7021_t* dev = selected_sensor();
+  uint8_t reg;
+  int8_t rv;
+
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = get_register(dev, User_Register_1, &reg);
+
+  if(rv >= 0)
+  {
+    Si7021_cli_respond("\r\nUser Register 1: 0x%02x\r\n", reg);
+    respond_const(REG_TABLE_FRAME);
+    respond_const(" RES1| VDDS| RSVD| RSVD| RSVD| HTRE| RSVD| RES0|\r\n");
+    respond_const(REG_TABLE_FRAME);
 
     printf_binary(reg);
 
-    sprintf((char*)message,
-        "\r\n------------------------------------------------\r\n");
-    print(message, strlen((char*)message));
+    respond_const(REG_TABLE_FOOTER);
   }
 
   return rv;
 }
 
-static int8_t show_heater_control_reg()
+static int8_t show_heater_control_reg(const int32_t* args, uint8_t argc)
 {
-  uint8_t reg, rv;
-  rv = get_register(Heater_Control_Register, &reg);
+  Si7021_t* dev = selected_sensor();
+  uint8_t reg;
+  int8_t rv;
+
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = get_register(dev, Heater_Control_Register, &reg);
 
   if(rv >= 0)
   {
-    sprintf((char*)message,
-        "\r\nHeater Control Register: 0x%02x\r\n"
-        "------------------------------------------------\r\n"
-        " RSVD| RSVD| RSVD| RSVD| HTR3| HTR2| HTR1| HTR0|\r\n"
-        "------------------------------------------------\r\n", reg);
-    print(message, strlen((char*)message));
+    Si7021_cli_respond("\r\nHeater Control Register: 0x%02x\r\n", reg);
+    respond_const(REG_TABLE_FRAME);
+    respond_const(" RSVD| RSVD| RSVD| RSVD| HTR3| HTR2| HTR1| HTR0|\r\n");
+    respond_const(REG_TABLE_FRAME);
 
     printf_binary(reg);
 
-    sprintf((char*)message,
-        "\r\n------------------------------------------------\r\n");
-    print(message, strlen((char*)message));
+    respond_const(REG_TABLE_FOOTER);
   }
 
   return rv;
 }
 
-static int8_t show_firmware_rev()
+static int8_t show_firmware_rev(const int32_t* args, uint8_t argc)
 {
-  int8_t rv = r_firmware_rev_Si7021();
+  Si7021_t* dev = selected_sensor();
+  int8_t rv;
+
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = r_firmware_rev_Si7021(dev);
 
   if(rv >= 0)
   {
-    sprintf((char*)message, "Si7021 firmware rev: %d\r\n", rv);
-    print(message, strlen((char*)message));
+    Si7021_cli_respond("Si7021 firmware rev: %d\r\n", rv);
   }
 
   return rv;
 }
 
-static int8_t query_vdd_warning()
+static int8_t query_vdd_warning(const int32_t* args, uint8_t argc)
 {
-  int8_t rv = VDD_warning_Si7021();
+  Si7021_t* dev = selected_sensor();
+  int8_t rv;
+
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = VDD_warning_Si7021(dev);
 
   if(rv >= 0)
   {
-    sprintf((char*)message, "VDD warning: %d\r\n", rv);
-    print(message, strlen((char*)message));
+    Si7021_cli_respond("VDD warning: %d\r\n", rv);
   }
 
   return rv;
 }
 
-static int8_t reset()
+static int8_t reset(const int32_t* args, uint8_t argc)
 {
-  int8_t rv = rst_Si7021();
+  Si7021_t* dev = selected_sensor();
+  int8_t rv;
+
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = rst_Si7021(dev);
 
   if(rv >= 0)
   {
-    sprintf((char*)message, "Si7021 reset successful!\r\n");
-    print(message, strlen((char*)message));
+    /* the next command of a batch, e.g. "r;h", must not reach the sensor during the reset */
+    if(dev->bus->delay_ms != NULL)
+      dev->bus->delay_ms(SI7021_RESET_TIME_MS);
+    else
+      HAL_Delay(SI7021_RESET_TIME_MS);
+
+    Si7021_cli_respond("Si7021 reset successful!\r\n");
   }
 
   return rv;
 }
 
-static int8_t show_heater_current()
+static int8_t show_heater_current(const int32_t* args, uint8_t argc)
 {
-  int8_t rv = r_heater_current_Si7021();
+  Si7021_t* dev = selected_sensor();
+  int8_t rv;
+
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = r_heater_current_Si7021(dev);
 
   if(rv >= 0)
   {
-    sprintf((char*)message, "Heater current: %d mA (assuming VDD is 3.3 V )\r\n", rv);
-    print(message, strlen((char*)message));
+    Si7021_cli_respond("Heater current: %d mA (assuming VDD is 3.3 V )\r\n", rv);
   }
 
   return rv;
 }
 
-static int8_t set_heater_current(uint8_t param)
+static int8_t set_heater_current(const int32_t* args, uint8_t argc)
 {
-  int8_t rv = set_heater_current_Si7021(param);
+  (void)argc;
+
+  Si7021_t* dev = selected_sensor();
+  /* the driver saturates at the maximum current, so do the same for wider arguments */
+  uint8_t current = (args[0] > 0xFF) ? 0xFF : (uint8_t)args[0];
+  int8_t rv;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = set_heater_current_Si7021(dev, current);
 
   if(rv >= 0)
   {
-    sprintf((char*)message,
-        "Heater current changed successfully to the closest value to %d mA\r\n", param);
-    print(message, strlen((char*)message));
+    Si7021_cli_respond(
+        "Heater current changed successfully to the closest value to %d mA\r\n", (int)args[0]);
   }
 
   return rv;
 }
 
-static int8_t enable_heater(uint8_t param)
+static int8_t enable_heater(const int32_t* args, uint8_t argc)
 {
-  int8_t rv = enable_heater_Si7021(param);
+  Si7021_t* dev = selected_sensor();
+  int8_t rv;
+
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = enable_heater_Si7021(dev, (uint8_t)args[0]);
 
   if(rv >= 0)
   {
-    if(param)
-      sprintf((char*)message, "On-chip heater enabled successfully!\r\n");
+    if(args[0])
+      Si7021_cli_respond("On-chip heater enabled successfully!\r\n");
     else
-      sprintf((char*)message, "On-chip heater disabled successfully!\r\n");
-
-    print(message, strlen((char*)message));
+      Si7021_cli_respond("On-chip heater disabled successfully!\r\n");
   }
 
   return rv;
 }
 
-static int8_t show_measurement_resolutions()
+static int8_t show_measurement_resolutions(const int32_t* args, uint8_t argc)
 {
-  int8_t rv = r_resolution_Si7021();
+  Si7021_t* dev = selected_sensor();
+  int8_t rv;
+
+  (void)args;
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  rv = r_resolution_Si7021(dev);
 
   if(rv == -1)
     return rv;
 
-  sprintf((char*)message, "Measurement resolutions:\r\n");
-  print(message, strlen((char*)message));
-
-  HAL_Delay(2);
+  Si7021_cli_respond("Measurement resolutions:\r\n");
 
   switch((Si7021_resolution_t)rv)
   {
   case H12_T14:
-    sprintf((char*)message, "RH: 12 bit Temp: 14 bit\r\n");
+    Si7021_cli_respond("RH: 12 bit Temp: 14 bit\r\n");
     break;
   case H11_T11:
-    sprintf((char*)message, "RH: 11 bit Temp: 11 bit\r\n");
+    Si7021_cli_respond("RH: 11 bit Temp: 11 bit\r\n");
     break;
   case H10_T13:
-    sprintf((char*)message, "RH: 10 bit Temp: 13 bit\r\n");
+    Si7021_cli_respond("RH: 10 bit Temp: 13 bit\r\n");
     break;
   case H8_T12:
-    sprintf((char*)message, "RH:  8 bit Temp: 12 bit\r\n");
+    Si7021_cli_respond("RH:  8 bit Temp: 12 bit\r\n");
     break;
   default:
     return rv;
   }
 
-  print(message, strlen((char*)message));
-
   return rv;
 }
 
-static int8_t set_measurement_resolutions(uint8_t param)
+static int8_t set_measurement_resolutions(const int32_t* args, uint8_t argc)
 {
+  Si7021_t* dev = selected_sensor();
   Si7021_resolution_t type = H12_T14;
   int8_t rv;
 
-  switch(param)
+  (void)argc;
+
+  if(dev == NULL)
+    return -1;
+
+  switch(args[0])
   {
   case 0:
-    sprintf((char*)message, "Setting measurement resolutions to RH: 12 bit Temp: 14 bit\r\n");
+    Si7021_cli_respond("Setting measurement resolutions to RH: 12 bit Temp: 14 bit\r\n");
     type = H12_T14;
     break;
   case 1:
-    sprintf((char*)message, "Setting measurement resolutions to RH: 11 bit Temp: 11 bit\r\n");
+    Si7021_cli_respond("Setting measurement resolutions to RH: 11 bit Temp: 11 bit\r\n");
     type = H11_T11;
     break;
   case 2:
-    sprintf((char*)message, "Setting measurement resolutions to RH: 10 bit Temp: 13 bit\r\n");
+    Si7021_cli_respond("Setting measurement resolutions to RH: 10 bit Temp: 13 bit\r\n");
     type = H10_T13;
     break;
   case 3:
-    sprintf((char*)message, "Setting measurement resolutions to RH:  8 bit Temp: 12 bit\r\n");
+    Si7021_cli_respond("Setting measurement resolutions to RH:  8 bit Temp: 12 bit\r\n");
     type = H8_T12;
     break;
   default:
-    sprintf((char*)message, "Invalid option!\r\n");
-    break;
+    Si7021_cli_respond("Invalid option!\r\n");
+    return -1;
   }
 
-  print(message, strlen((char*)message));
-
-  rv = set_resolution_Si7021(type);
+  rv = set_resolution_Si7021(dev, type);
 
   if(rv >= 0)
   {
-    sprintf((char*)message, "Measurement resolutions successfully changed!\r\n");
-    print(message, strlen((char*)message));
+    Si7021_cli_respond("Measurement resolutions successfully changed!\r\n");
   }
 
   return rv;
 }
 
-static int8_t show_cli_usage_help()
+static int8_t show_sensor_table(const int32_t* args, uint8_t argc)
 {
-  sprintf((char*)message,
-      "Available commands:\n\r"
-      "h: get humidity\n\r"
-      "t: get temperature\n\r"
-      "b: get humidity and temperature\n\r"
-      "u: read User Register 1\n\r"
-      "e: read Heater Control Register\n\r"
-      "f: read firmware revision\n\r"
-      "v: get VDD warning status\n\r"
-      "c: read heater current\n\r"
-      "m: read measurement resolution\n\r"
-  );
-  print(message, strlen((char*)message));
+  uint8_t i;
 
-  HAL_Delay(2);
+  (void)args;
+  (void)argc;
 
-  sprintf((char*)message,
-      "n <current>: set heater current in mA\n\r"
-      "a <option>: set measurement resolution\n\r"
-      "            0: RH 12 bit, Temp 14 bit\r\n"
-      "            1: RH 11 bit, Temp 11 bit\r\n"
-      "            2: RH 10 bit, Temp 13 bit\r\n"
-      "            3: RH  8 bit, Temp 12 bit\r\n"
-      "l <enable>: enable or disable on-chip heater\r\n"
-      "            0: disable\r\n"
-      "            1: enable\r\n"
-      "r: reset Si7021\n\r"
-      );
-  print(message, strlen((char*)message));
+  Si7021_cli_respond("Sensors:\r\n");
+
+  for(i = 0; i < sensor_count; i++)
+  {
+    Si7021_cli_respond("%c%2d: channel %3d serial %08lx%08lx firmware rev %d\r\n",
+        (i == selected) ? '*' : ' ', i, sensors[i].channel,
+        (unsigned long)sensors[i].serial_a, (unsigned long)sensors[i].serial_b,
+        sensors[i].firmware_rev);
+  }
 
   return 0;
 }
 
-static void cli_command_handler(uint8_t command_code, uint8_t param)
+static int8_t select_sensor(const int32_t* args, uint8_t argc)
 {
-  int8_t rv = 0;
+  (void)argc;
 
-  if(command_code == 'h')
-  {
-    rv = show_humidity();
-  }
-  else if(command_code == 't')
+  if(args[0] >= sensor_count)
+    return -1;
+
+  selected = (uint8_t)args[0];
+
+  /* the rest of the batch uses the bus of the new sensor */
+  if(locked_bus != NULL && locked_bus != sensors[selected].bus)
   {
-    rv = show_temperature();
+    unlock_bus_Si7021(locked_bus);
+    locked_bus = sensors[selected].bus;
+    lock_bus_Si7021(locked_bus);
   }
-  else if(command_code == 'b')
+
+  Si7021_cli_respond("Sensor %d selected\r\n", selected);
+
+  return 0;
+}
+
+static int8_t show_cli_usage_help(const int32_t* args, uint8_t argc)
+{
+  uint8_t i;
+
+  (void)args;
+  (void)argc;
+
+  Si7021_cli_respond("Available commands:\r\n");
+
+  for(i = 0; i < command_count; i++)
   {
-    rv = show_humidity_n_temperature();
+    /* the help of all commands does not fit in one response */
+    if(message_len > sizeof(message) - 256)
+      respond_flush();
+
+    respond_const(commands[i]->help);
+    respond_const("\r\n");
   }
-  else if(command_code == 'u')
+
+  Si7021_cli_respond("Separate commands by '%c' to execute them in one batch.\r\n",
+      SI7021_CLI_SEPARATOR);
+
+  return 0;
+}
+
+static const Si7021_cli_command_t* find_command(uint8_t code)
+{
+  if(code < CLI_CODE_FIRST || code > CLI_CODE_LAST)
+    return NULL;
+
+  if(command_lookup[code - CLI_CODE_FIRST] == 0)
+    return NULL;
+
+  return commands[command_lookup[code - CLI_CODE_FIRST] - 1];
+}
+
+/*
+*  Parses a single command of the form "<code> [arg1] [arg2] ...".
+*  Returns 1 if a command was found, 0 for an empty command and -1 on syntax error.
+*/
+static int8_t cli_parse_command(char* text, const Si7021_cli_command_t** cmd,
+                                int32_t* args, uint8_t* argc)
+{
+  char* end;
+  long value;
+  uint8_t type;
+
+  while(*text == ' ')
+    text++;
+
+  if(*text == 0)
+    return 0;
+
+  *cmd = find_command((uint8_t)*text);
+  *argc = 0;
+  memset(args, 0, SI7021_CLI_MAX_ARGS * sizeof(int32_t));
+  text++;
+
+  if(*cmd == NULL || (*text != ' ' && *text != 0))
   {
-    rv = show_user_reg1();
+    *cmd = NULL;
+    return -1;
   }
-  else if(command_code == 'e')
+
+  while(1)
   {
-    rv = show_heater_control_reg();
+    while(*text == ' ')
+      text++;
+
+    if(*text == 0)
+      break;
+
+    if(*argc >= (*cmd)->max_args)
+      return -1;
+
+    errno = 0;
+    value = strtol(text, &end, 0);
+    type = (*cmd)->arg_types[*argc];
+
+    /* out of the range of long is an error also where long is 32 bits */
+    if(end == text || (*end != ' ' && *end != 0) || errno == ERANGE ||
+       value < arg_min[type] || value > arg_max[type])
+      return -1;
+
+    args[(*argc)++] = (int32_t)value;
+    text = end;
   }
-  else if(command_code == 'f')
+
+  if(*argc < (*cmd)->min_args)
+    return -1;
+
+  return 1;
+}
+
+static void cli_command_handler(char* text)
+{
+  const Si7021_cli_command_t* cmd = NULL;
+  int32_t args[SI7021_CLI_MAX_ARGS];
+  uint8_t argc = 0;
+  int8_t rv;
+
+  rv = cli_parse_command(text, &cmd, args, &argc);
+
+  if(rv == 0)
+    return;
+
+  if(rv < 0)
   {
-    rv = show_firmware_rev();
+    if(cmd != NULL)
+      Si7021_cli_respond("Usage: %s\r\n", cmd->help);
+    else
+      show_cli_usage_help(args, 0);
+
+    return;
   }
-  else if(command_code == 'v')
+
+  if(cmd->handler(args, argc) < 0)
   {
-    rv = query_vdd_warning();
+    Si7021_cli_respond("Operation failed!\r\n");
   }
-  else if(command_code == 'r')
+}
+
+/*
+*  Executes every command of the line back-to-back under one acquisition
+*  of the bus lock, then sends their collected output as one response.
+*/
+static void cli_line_handler(char* line)
+{
+  char* next;
+  Si7021_t* dev = selected_sensor();
+
+  respond_reset();
+
+  if(dev != NULL)
   {
-    rv = reset();
+    locked_bus = dev->bus;
+    lock_bus_Si7021(locked_bus);
   }
-  else if(command_code == 'c')
+
+  while(line != NULL)
   {
-    rv = show_heater_current();
+    next = strchr(line, SI7021_CLI_SEPARATOR);
+
+    if(next != NULL)
+      *next++ = 0;
+
+    cli_command_handler(line);
+    line = next;
   }
-  else if(command_code == 'n')
+
+  if(locked_bus != NULL)
   {
-    rv = set_heater_current(param);
+    unlock_bus_Si7021(locked_bus);
+    locked_bus = NULL;
   }
-  else if(command_code == 'l')
+
+  respond_flush();
+}
+
+/*
+*  Adds a constant text to the response. With a gather transport the text is
+*  referenced in place, otherwise it is copied to keep the response contiguous.
+*  The last segment is always kept free for the copied text of the message buffer.
+*/
+static void respond_const(const char* text)
+{
+  if(printv == NULL || segment_count >= SI7021_CLI_MAX_SEGMENTS - 1)
   {
-    rv = enable_heater(param);
+    Si7021_cli_respond("%s", text);
+    return;
   }
-  else if(command_code == 'm')
+
+  segments[segment_count].buf = (const uint8_t*)text;
+  segments[segment_count].len = strlen(text);
+  segment_count++;
+}
+
+static void respond_reset(void)
+{
+  message_len = 0;
+  segment_count = 0;
+}
+
+static void respond_flush(void)
+{
+  if(segment_count == 0)
+    return;
+
+  if(printv != NULL)
+    printv(segments, segment_count);
+  else if(print != NULL)
+    print_adapter(segments, segment_count);
+
+  respond_reset();
+}
+
+/*
+*  Fallback for the single buffer print_t interface. As constant texts are copied
+*  when no gather transport is set, this normally results in one print call.
+*/
+static uint8_t print_adapter(const Si7021_cli_iovec_t* iov, uint8_t count)
+{
+  uint8_t i, rv = 0;
+
+  for(i = 0; i < count; i++)
   {
-    rv = show_measurement_resolutions();
+    rv = print((uint8_t*)iov[i].buf, iov[i].len);
   }
-  else if(command_code == 'a')
+
+  return rv;
+}
+
+void Si7021_cli_respond(const char* format, ...)
+{
+  va_list args;
+  int len;
+  uint16_t start = message_len;
+  Si7021_cli_iovec_t* last = &segments[0];
+
+  if(message_len >= sizeof(message) - 1)
+    return;
+
+  va_start(args, format);
+  len = vsnprintf((char*)&message[message_len], sizeof(message) - message_len, format, args);
+  va_end(args);
+
+  if(len <= 0)
+    return;
+
+  if((uint32_t)message_len + (uint32_t)len >= sizeof(message))
+    message_len = sizeof(message) - 1;
+  else
+    message_len += len;
+
+  if(segment_count > 0)
+    last = &segments[segment_count - 1];
+
+  /* extend the last segment if the new text directly follows it in the message buffer */
+  if(segment_count > 0 && last->buf + last->len == &message[start])
   {
-    rv = set_measurement_resolutions(param);
+    last->len += message_len - start;
   }
-  else if(command_code == 0)
+  else if(segment_count < SI7021_CLI_MAX_SEGMENTS)
   {
-
+    segments[segment_count].buf = &message[start];
+    segments[segment_count].len = message_len - start;
+    segment_count++;
   }
   else
   {
-    rv = show_cli_usage_help();
+    /* no free segment left, drop the text */
+    message_len = start;
   }
+}
 
-  if(rv < 0)
+int8_t Si7021_cli_register(const Si7021_cli_command_t* cmd)
+{
+  if(cmd == NULL || cmd->handler == NULL || cmd->max_args > SI7021_CLI_MAX_ARGS ||
+     cmd->min_args > cmd->max_args)
+    return -1;
+
+  if(cmd->code < CLI_CODE_FIRST || cmd->code > CLI_CODE_LAST || cmd->code == SI7021_CLI_SEPARATOR)
+    return -1;
+
+  if(find_command(cmd->code) != NULL || command_count >= SI7021_CLI_MAX_COMMANDS)
+    return -1;
+
+  commands[command_count++] = cmd;
+  command_lookup[cmd->code - CLI_CODE_FIRST] = command_count;
+
+  return 0;
+}
+
+static void register_builtin_commands(void)
+{
+  uint8_t i;
+
+  for(i = 0; i < sizeof(builtin_commands)/sizeof(builtin_commands[0]); i++)
   {
-    sprintf((char*)message, "Operation failed!\r\n");
-    print(message, strlen((char*)message));
+    Si7021_cli_register(&builtin_commands[i]);
   }
-
 }
 
 void Si7021_cli_init(print_t func)
 {
-  if(print == NULL)
+  if(print == NULL && printv == NULL)
   {
     print = func;
+    register_builtin_commands();
+  }
+}
+
+void Si7021_cli_init_v(printv_t func)
+{
+  if(print == NULL && printv == NULL)
+  {
+    printv = func;
+    register_builtin_commands();
   }
 }
 
+void Si7021_cli_set_sensors(Si7021_t* table, uint8_t count)
+{
+  sensors = table;
+  sensor_count = count;
+  selected = 0;
+}
+
+void Si7021_cli_set_stats(Si7021_stats_t* table)
+{
+  sensor_stats = table;
+}
+
+void Si7021_cli_set_history(Si7021_history_t* table)
+{
+  sensor_history = table;
+}
+
+void Si7021_cli_set_reporters(Si7021_reporter_t* table)
+{
+  sensor_reporters = table;
+}
+
+void Si7021_cli_set_jitter(Si7021_jitter_t* table)
+{
+  sensor_jitter = table;
+}
+
+/*
+*  Called from the reporter task, so the line is formatted into a local buffer instead of
+*  the message buffer of the CLI task, and sent by the transport directly.
+*/
+void Si7021_cli_report(void* ctx, const Si7021_sample_t* sample)
+{
+  char line[96];
+  Si7021_cli_iovec_t segment;
+  int len;
+
+  len = snprintf(line, sizeof(line),
+                 "Sensor %u: %lu ms Humidity: %.2f%% Temperature: %.2f C\r\n",
+                 (unsigned)(uintptr_t)ctx, (unsigned long)sample->timestamp,
+                 code_to_humidity_Si7021(sample->humi_code),
+                 code_to_temperature_Si7021(sample->temp_code));
+
+  if(len <= 0)
+    return;
+
+  segment.buf = (const uint8_t*)line;
+  segment.len = ((uint32_t)len >= sizeof(line)) ? sizeof(line) - 1 : (uint16_t)len;
+
+  if(printv != NULL)
+    printv(&segment, 1);
+  else if(print != NULL)
+    print((uint8_t*)line, segment.len);
+}
+
 /*
-*  Note that the input is a single byte passed by reference 
+*  Note that the input is a single byte passed by reference
 *  to be able to clear it.
 */
 void Si7021_cli_engine(uint8_t* char_in)
 {
-  static uint8_t input_buffer[20];
+  static char input_buffer[SI7021_CLI_LINE_LENGTH];
   static uint8_t input_index = 0;
-
-  uint8_t command_code = 0, param = 0, ready = 0;
+  static uint8_t overflow = 0;
 
   if(*char_in != 0)
   {
-    if(*char_in != '\r')
+    if(*char_in == '\n')
     {
-      input_buffer[input_index++] = *char_in;
+      /* ignored, lines are terminated by '\r' */
+    }
+    else if(*char_in != '\r')
+    {
+      if(input_index < sizeof(input_buffer) - 1)
+        input_buffer[input_index++] = (char)*char_in;
+      else
+        overflow = 1;
     }
     else
     {
-      uint8_t rv = 0;
       input_buffer[input_index] = 0;
       input_index = 0;
 
-      rv = sscanf(input_buffer, "%c %d", &command_code, &param);
-
-      if(rv == 2)
-        ready = 1;
-      else if(rv == 1)
+      if(overflow)
+      {
+        overflow = 0;
+        respond_reset();
+        Si7021_cli_respond("Line too long!\r\n");
+        respond_flush();
+      }
+      else
       {
-        ready = 1;
-        param = 0;
+        cli_line_handler(input_buffer);
       }
     }
-    
+
     /* clear input */
     *char_in = 0;
-
-    if(ready)
-    {
-      cli_command_handler(command_code, param);
-    }
   }
 }
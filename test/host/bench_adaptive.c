@@ -0,0 +1,248 @@
+/*
+*  Simulation of the adaptive resolution (Si7021_adaptive.c): a simulated sensor converts
+*  an environment of given dynamics with the quantisation and conversion time of its
+*  current resolution. The sensor is sampled back to back for 60 virtual seconds at a fixed
+*  precise resolution, a fixed fast one and adaptively between them. Prints the samples per
+*  second and the RMS and maximum error of the latest reading against the environment, on a
+*  1 ms grid. Fails if the adaptive control switches without a transient, does not speed up
+*  during one, or counts a resolution switch within one coarse LSB as a change.
+*/
+#include "fake_Si7021.h"
+#include "Si7021_adaptive.h"
+#include <math.h>
+#include <stdio.h>
+
+static uint32_t errors = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if(!(cond))                                                         \
+    {                                                                   \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      errors++;                                                         \
+    }                                                                   \
+  } while(0)
+
+#define DURATION_MS      60000
+#define PI               3.14159265
+
+typedef struct climate
+{
+  double humidity;                     // %
+  double temperature;                  // C
+}climate_t;
+
+typedef climate_t (*environment_t)(double t);
+
+typedef struct run
+{
+  uint32_t samples;
+  uint32_t switches;
+  double   humi_sq, temp_sq;           // squared errors, summed over the grid
+  double   humi_max, temp_max;
+}run_t;
+
+static fake_bus_t fake;
+static Si7021_bus_t bus;
+static Si7021_t dev;
+static environment_t environment;
+static uint32_t seed = 1;
+
+static climate_t steady(double t)
+{
+  (void)t;
+
+  return (climate_t){45.0, 22.0};
+}
+
+/* the sensor is carried into a warm, dry room at 10 s, with its time constants */
+static climate_t step(double t)
+{
+  double k;
+
+  if(t < 10.0)
+    return steady(t);
+
+  k = t - 10.0;
+
+  return (climate_t){25.0 + 20.0 * exp(-k / 3.0), 30.0 - 8.0 * exp(-k / 5.0)};
+}
+
+/* air of a fan heater passing by the sensor */
+static climate_t oscillation(double t)
+{
+  return (climate_t){50.0 + 10.0 * sin(2 * PI * t / 3.0), 25.0 + 3.0 * sin(2 * PI * t / 4.0)};
+}
+
+/* sensor noise, -0.5 .. 0.5 */
+static double noise(void)
+{
+  seed = seed * 1103515245u + 12345u;
+
+  return ((seed >> 16) & 0xFFFF) / 65536.0 - 0.5;
+}
+
+/* codes of the environment at the resolution of the sensor, and its conversion time */
+static void convert(fake_Si7021_t* sensor)
+{
+  static const uint32_t conversion_us[4] = {22800, 6900, 10700, 9200};
+  static const uint8_t humi_bits[4] = {12, 8, 10, 11};
+  static const uint8_t temp_bits[4] = {14, 12, 13, 11};
+  uint8_t res = sensor->user_register_1 & H11_T11;        // the resolution bits
+  uint8_t i = (uint8_t)(((res >> 6) & 2) | (res & 1));
+  climate_t c = environment(fake_time_us * 1e-6);
+  double rh = (c.humidity + 0.02 * noise() + 6.0) * 65536 / 125;
+  double t = (c.temperature + 0.01 * noise() + 46.85) * 65536 / 175.72;
+
+  sensor->conversion_us = conversion_us[i];
+  sensor->rh_code = (uint16_t)((uint16_t)rh >> (16 - humi_bits[i]) << (16 - humi_bits[i]));
+  sensor->temp_code = (uint16_t)((uint16_t)t >> (16 - temp_bits[i]) << (16 - temp_bits[i]));
+}
+
+/* converts the environment when a measurement is started */
+static int8_t sim_transfer(void* ctx, uint16_t addr, Si7021_msg_t* msgs, uint8_t count)
+{
+  if(environment != NULL && msgs[0].dir == I2C_Msg_Write && msgs[0].buf[0] == Humi_HM)
+    convert(&fake.sensors[0]);
+
+  return fake_transfer(ctx, addr, msgs, count);
+}
+
+static void setup(void)
+{
+  fake_time_us = 0;
+  seed = 1;
+  fake_bus_init(&fake, 1);
+  fake.transfer_us = 0;
+  bus = (Si7021_bus_t){.transfer = sim_transfer, .select = fake_select, .ctx = &fake,
+                       .now_ms = fake_now_ms, .now_us = fake_now_us,
+                       .channels = FAKE_CHANNELS, .active_channel = SI7021_NO_CHANNEL};
+  attach_Si7021(&dev, &bus, 0);
+}
+
+/* the latest reading against the environment on the grid from 'from' to now */
+static void track(run_t* r, uint32_t from, const Si7021_sample_t* latest)
+{
+  double humi = code_to_humidity_Si7021(latest->humi_code);
+  double temp = code_to_temperature_Si7021(latest->temp_code);
+  uint32_t ms;
+  climate_t c;
+
+  for(ms = from; ms < fake_now_ms() && ms < DURATION_MS; ms++)
+  {
+    c = environment(ms * 1e-3);
+
+    r->humi_sq += (humi - c.humidity) * (humi - c.humidity);
+    r->temp_sq += (temp - c.temperature) * (temp - c.temperature);
+
+    if(fabs(humi - c.humidity) > r->humi_max)
+      r->humi_max = fabs(humi - c.humidity);
+    if(fabs(temp - c.temperature) > r->temp_max)
+      r->temp_max = fabs(temp - c.temperature);
+  }
+}
+
+/* samples back to back at a fixed resolution, or adaptively if 'adaptive' is set */
+static run_t simulate(environment_t env, Si7021_resolution_t resolution, uint8_t adaptive)
+{
+  Si7021_adaptive_t ctl;
+  Si7021_sample_t sample, latest;
+  run_t r = {0};
+  uint32_t from = 0;
+
+  setup();
+  environment = env;
+
+  if(adaptive)
+    adaptive_init_Si7021(&ctl, &dev, H12_T14, H8_T12, 100, 50);
+  else
+    set_resolution_Si7021(&dev, resolution);
+
+  fake_time_us = 0;
+
+  while(fake_now_ms() < DURATION_MS)
+  {
+    if((adaptive ? adaptive_sample_Si7021(&ctl, &sample) : r_sample_Si7021(&dev, &sample)) < 0)
+    {
+      errors++;
+      break;
+    }
+
+    /* nothing to compare before the first reading */
+    if(r.samples++ > 0)
+      track(&r, from, &latest);
+
+    latest = sample;
+    from = fake_now_ms();
+  }
+
+  r.switches = adaptive ? ctl.switches : 0;
+
+  return r;
+}
+
+static void print(const char* name, const run_t* r)
+{
+  double points = DURATION_MS;
+
+  printf("  %-10s %8.1f %8lu %9.3f %9.3f %9.3f %9.3f\n", name, r->samples * 1000.0 / DURATION_MS,
+         (unsigned long)r->switches, sqrt(r->humi_sq / points), r->humi_max,
+         sqrt(r->temp_sq / points), r->temp_max);
+}
+
+static void compare(const char* name, environment_t env, run_t* adaptive)
+{
+  run_t precise = simulate(env, H12_T14, 0);
+  run_t fast = simulate(env, H8_T12, 0);
+
+  *adaptive = simulate(env, H12_T14, 1);
+
+  printf("%s\n", name);
+  print("H12_T14", &precise);
+  print("H8_T12", &fast);
+  print("adaptive", adaptive);
+}
+
+/* a temperature step of less than the coarser LSB after a switch is no transient */
+static void test_lsb(void)
+{
+  Si7021_adaptive_t ctl;
+  Si7021_sample_t sample;
+
+  setup();
+  environment = NULL;
+  adaptive_init_Si7021(&ctl, &dev, H11_T11, H8_T12, 100, 1);
+  set_resolution_Si7021(&dev, H11_T11);
+  fake.sensors[0].temp_code = 0x6000;
+  CHECK(adaptive_sample_Si7021(&ctl, &sample) == 0);
+
+  /* the next one at H8_T12, 24 codes: less than the LSB of H11_T11 (32), above H8_T12 (16) */
+  set_resolution_Si7021(&dev, H8_T12);
+  fake_time_us += 200000;
+  fake.sensors[0].temp_code = 0x6000 + 24;
+  CHECK(adaptive_sample_Si7021(&ctl, &sample) == 0);
+  CHECK(ctl.activity == 0);
+}
+
+int main(void)
+{
+  run_t adaptive;
+
+  printf("back to back for %u s     samples/s switches   RH RMS %%   RH max %%    T RMS C"
+         "    T max C\n", DURATION_MS / 1000);
+
+  compare("steady", steady, &adaptive);
+  CHECK(adaptive.switches == 0);
+
+  compare("step at 10 s", step, &adaptive);
+  CHECK(adaptive.switches >= 2);
+
+  compare("oscillation", oscillation, &adaptive);
+  CHECK(adaptive.samples * 1000 / DURATION_MS > 1000000 / 22800);
+
+  test_lsb();
+
+  printf("bench_adaptive: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+/*
+*  Benchmark of the filters (Si7021_filter.c): a noisy code sequence is filtered by the
+*  mean and the median at several window lengths and by the EMA at several shifts. Prints
+*  the time stamp counter cycles (x86) and the nanoseconds per sample. Fails if a mean or
+*  median differs from a brute-force reference computed from the whole window (rounded
+*  mean, lower middle value).
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "Si7021_filter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES()         __rdtsc()
+#else
+#define CYCLES()         0
+#endif
+
+#define SAMPLES          200000
+#define CHECKED          20000         // samples compared with the reference
+
+static uint16_t input[SAMPLES];
+static uint16_t output[SAMPLES];
+static uint16_t storage[SI7021_FILTER_STORAGE(Filter_Median, SI7021_FILTER_MAX_WINDOW)];
+
+static double seconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* a slow ramp with noise and spikes, as humidity codes */
+static void make_input(void)
+{
+  uint32_t seed = 1;
+  uint32_t i;
+
+  for(i = 0; i < SAMPLES; i++)
+  {
+    seed = seed * 1103515245u + 12345u;
+    input[i] = (uint16_t)(0x6000 + (i / 64) % 0x1000 + ((seed >> 16) & 0xFF));
+
+    if((seed >> 8) % 97 == 0)
+      input[i] ^= 0x0800;
+  }
+}
+
+static int compare(const void* a, const void* b)
+{
+  return (int)*(const uint16_t*)a - (int)*(const uint16_t*)b;
+}
+
+/* number of the first CHECKED outputs that differ from the filter of the whole window */
+static uint32_t check(Si7021_filter_type_t type, uint8_t window)
+{
+  uint16_t values[SI7021_FILTER_MAX_WINDOW];
+  uint32_t errors = 0;
+  uint32_t sum, i, j, count;
+
+  for(i = 0; i < CHECKED; i++)
+  {
+    count = (i + 1 < window) ? i + 1 : window;
+    memcpy(values, &input[i + 1 - count], count * sizeof(uint16_t));
+
+    if(type == Filter_Mean)
+    {
+      for(sum = 0, j = 0; j < count; j++)
+        sum += values[j];
+
+      if(output[i] != (sum + count / 2) / count)
+        errors++;
+    }
+    else
+    {
+      qsort(values, count, sizeof(uint16_t), compare);
+
+      if(output[i] != values[(count - 1) / 2])
+        errors++;
+    }
+  }
+
+  return errors;
+}
+
+/* returns the number of errors */
+static uint32_t bench(Si7021_filter_type_t type, uint8_t window)
+{
+  static const char* names[] = {"mean", "median", "EMA"};
+  Si7021_filter_t filter;
+  uint64_t cycles;
+  uint32_t i;
+  double start;
+
+  if(filter_init_Si7021(&filter, type, window, storage) < 0)
+  {
+    printf("%s %u: init failed\n", names[type], window);
+    return 1;
+  }
+
+  start = seconds();
+  cycles = CYCLES();
+
+  for(i = 0; i < SAMPLES; i++)
+    output[i] = filter_update_Si7021(&filter, input[i]);
+
+  cycles = CYCLES() - cycles;
+  start = seconds() - start;
+
+  printf("%-8s %6u %14.1f %10.1f\n", names[type], window, (double)cycles / SAMPLES,
+         start * 1e9 / SAMPLES);
+
+  return (type == Filter_EMA) ? 0 : check(type, window);
+}
+
+int main(void)
+{
+  static const uint8_t windows[] = {4, 8, 16, 32, 64, 128, 255};
+  static const uint8_t shifts[] = {1, 2, 4, 8};
+  uint32_t errors = 0;
+  uint8_t i;
+
+  make_input();
+
+  printf("filter   window cycles/sample  ns/sample\n");
+
+  for(i = 0; i < sizeof(windows); i++)
+    errors += bench(Filter_Mean, windows[i]);
+
+  for(i = 0; i < sizeof(windows); i++)
+    errors += bench(Filter_Median, windows[i]);
+
+  for(i = 0; i < sizeof(shifts); i++)
+    errors += bench(Filter_EMA, shifts[i]);
+
+  printf("bench_filter: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
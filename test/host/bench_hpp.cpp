@@ -0,0 +1,259 @@
+/*
+*  Test and benchmark of the C++17 front-end (Si7021.hpp) against a simulated sensor: the
+*  resolution, Hold Master and No Hold Master samples with and without checksum, single
+*  measurements, the heater and the conversions must match the fake sensor and the C driver.
+*  Prints the time stamp counter cycles (x86) per operation of the C API and of the
+*  template over a bus that returns at once, so the cycles are those of the drivers. The
+*  code size of a minimal application of each is printed by 'make size'.
+*/
+#include "Si7021.hpp"
+
+extern "C"
+{
+#include "fake_Si7021.h"
+}
+
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES()         __rdtsc()
+#else
+#define CYCLES()         0
+#endif
+
+#define CALLS            1000000
+
+static uint32_t errors = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if(!(cond))                                                         \
+    {                                                                   \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      errors++;                                                         \
+    }                                                                   \
+  } while(0)
+
+static fake_bus_t fake;
+
+/* bus policy straight on the fake bus */
+struct FakeBus
+{
+  int8_t transfer(uint16_t addr, Si7021_msg_t* msgs, uint8_t count)
+  {
+    return fake_transfer(&fake, addr, msgs, count);
+  }
+
+  uint32_t now_ms()
+  {
+    return fake_now_ms();
+  }
+
+  uint32_t now_us()
+  {
+    return fake_now_us();
+  }
+};
+
+/* a sensor that answers at once, the codes are the length of the read */
+static int8_t null_transfer(void* ctx, uint16_t addr, Si7021_msg_t* msgs, uint8_t count)
+{
+  (void)ctx;
+  (void)addr;
+
+  for(uint8_t i = 0; i < count; i++)
+  {
+    if(msgs[i].dir == I2C_Msg_Read)
+      msgs[i].buf[0] = (uint8_t)msgs[i].len;
+  }
+
+  return 0;
+}
+
+static uint32_t null_now_ms()
+{
+  return 0;
+}
+
+/* a code followed by its checksum */
+static constexpr uint8_t CHECKED_CODE[3] = {0x68, 0x3A, 0x7C};
+
+static_assert(si7021::Sensor<FakeBus>::crc8(CHECKED_CODE, 3) == 0, "checksum");
+static_assert(si7021::Sensor<FakeBus, si7021::Resolution::H8_T12>::humidity_time == 6900,
+              "conversion time of H8_T12");
+
+template <si7021::Resolution Res>
+static void test_resolution(Si7021_resolution_t res)
+{
+  Si7021_bus_t bus = {};
+  Si7021_t dev;
+
+  attach_Si7021(&dev, &bus, 0);
+  dev.user_register_1 = (uint8_t)res;
+
+  CHECK((si7021::Sensor<FakeBus, Res>::humidity_time == conversion_time_Si7021(&dev, Humidity)));
+  CHECK((si7021::Sensor<FakeBus, Res>::temperature_time ==
+         conversion_time_Si7021(&dev, Temperature)));
+}
+
+static void test_sensor()
+{
+  si7021::Sensor<FakeBus, si7021::Resolution::H11_T11, si7021::Checksum::Verify> sensor{{}};
+  fake_Si7021_t* fs = &fake.sensors[0];
+  Si7021_sample_t sample = {};
+  uint16_t code;
+  uint8_t reg;
+
+  fake_time_us = 0;
+  fake_bus_init(&fake, 1);
+  fs->user_register_1 |= 0x38;         // reserved bits
+
+  CHECK(sensor.init() == 0);
+  CHECK((fs->user_register_1 & 0x81) == H11_T11 && (fs->user_register_1 & 0x38) == 0x38);
+  CHECK(sensor.read_register<si7021::Register::User_Register_1>(reg) == 0 &&
+        reg == fs->user_register_1);
+
+  /* Hold Master, the codes come with their checksum */
+  CHECK(sensor.read(sample) == 0);
+  CHECK(sample.humi_code == fs->rh_code && sample.temp_code == fs->temp_code);
+  CHECK(sample.resolution == H11_T11 && sample.flags == 0);
+  CHECK(sample.end_us - sample.start_us >= fs->conversion_us);
+
+  CHECK(sensor.read_code<Temperature>(code) == 0 && code == fs->temp_code);
+  CHECK(sensor.read_code<Humidity>(code) == 0 && code == fs->rh_code);
+
+  /* No Hold Master: not acknowledged until the conversion is done */
+  CHECK(sensor.start() == 0);
+  CHECK(sensor.fetch(sample) == 1);
+  fake_time_us += fs->conversion_us;
+  CHECK(sensor.fetch(sample) == 0);
+  CHECK(sample.humi_code == fs->rh_code && sample.temp_code == fs->temp_code);
+
+  /* heater: register value and the flag of the samples */
+  CHECK(sensor.set_heater_current<27>() == 0 && fs->heater_control_register == 4);
+  CHECK(sensor.enable_heater(true) == 0 && (fs->user_register_1 & (1 << HTRE)));
+  CHECK(sensor.read(sample) == 0 && sample.flags == SI7021_SAMPLE_HEATED);
+  CHECK(sensor.enable_heater(false) == 0 && !(fs->user_register_1 & (1 << HTRE)));
+
+  /* a missing sensor */
+  fs->present = 0;
+  CHECK(sensor.read(sample) == -1 && sample.status == -1);
+  CHECK(sensor.init() == -1);
+}
+
+/* the C bus adapter, the lock of the bus is taken for each transfer */
+static uint32_t locks = 0;
+
+static void count_lock(void* mutex)
+{
+  (void)mutex;
+
+  locks++;
+}
+
+static void test_cbus()
+{
+  Si7021_bus_t bus = {};
+  Si7021_sample_t sample = {};
+
+  fake_time_us = 0;
+  fake_bus_init(&fake, 1);
+  bus.transfer = fake_transfer;
+  bus.ctx = &fake;
+  bus.now_ms = fake_now_ms;
+  bus.lock = count_lock;
+  bus.unlock = count_lock;
+
+  si7021::Sensor<si7021::CBus> sensor{{&bus}};
+
+  CHECK(sensor.read(sample) == 0 && sample.humi_code == fake.sensors[0].rh_code);
+  CHECK(locks == 2);
+
+  /* without now_us the microseconds come from now_ms */
+  CHECK(sample.start_us == 0 && sample.end_us == fake_now_ms() * 1000);
+}
+
+/* the template computes in float, the C driver in double: rounding of float only */
+static void test_conversions()
+{
+  using S = si7021::Sensor<FakeBus>;
+  uint32_t code;
+  float humi, temp;
+
+  for(code = 0; code <= 0xFFFF; code++)
+  {
+    humi = S::humidity((uint16_t)code) - code_to_humidity_Si7021((uint16_t)code);
+    temp = S::temperature((uint16_t)code) - code_to_temperature_Si7021((uint16_t)code);
+
+    if(humi > 1e-4f || humi < -1e-4f || temp > 1e-4f || temp < -1e-4f)
+    {
+      printf("conversion of %lu differs\n", (unsigned long)code);
+      errors++;
+      break;
+    }
+
+    /* 0.01 units, rounded down */
+    humi = S::humidity_centi((uint16_t)code) - S::humidity((uint16_t)code) * 100;
+    temp = S::temperature_centi((uint16_t)code) - S::temperature((uint16_t)code) * 100;
+
+    if(humi > 0.01f || humi < -1.01f || temp > 0.01f || temp < -1.01f)
+    {
+      printf("integer conversion of %lu differs\n", (unsigned long)code);
+      errors++;
+      break;
+    }
+  }
+}
+
+static volatile float sink;
+
+#define TIME(name, expr)                                                \
+  do {                                                                  \
+    uint64_t start = CYCLES();                                          \
+    for(uint32_t i = 0; i < CALLS; i++)                                 \
+      expr;                                                             \
+    printf("  %-40s %8.1f\n", name, (double)(CYCLES() - start) / CALLS); \
+  } while(0)
+
+static void bench()
+{
+  Si7021_bus_t bus = {};
+  Si7021_t dev;
+  Si7021_sample_t sample;
+  float value;
+
+  bus.transfer = null_transfer;
+  bus.now_ms = null_now_ms;
+  bus.active_channel = SI7021_NO_CHANNEL;
+  attach_Si7021(&dev, &bus, 0);
+
+  si7021::Sensor<si7021::CBus> sensor{{&bus}};
+  si7021::Sensor<si7021::CBus, si7021::Resolution::H12_T14, si7021::Checksum::Verify>
+    checked{{&bus}};
+
+  printf("cycles per call, bus returning at once\n");
+  TIME("r_sample_Si7021", r_sample_Si7021(&dev, &sample));
+  TIME("Sensor::read", sensor.read(sample));
+  TIME("Sensor::read, checksum", checked.read(sample));
+  TIME("r_single_Si7021", r_single_Si7021(&dev, &value, Temperature));
+  TIME("Sensor::read_code", sensor.read_code<Temperature>(sample.temp_code));
+  TIME("code_to_humidity_Si7021", sink = code_to_humidity_Si7021((uint16_t)i));
+  TIME("Sensor::humidity", sink = sensor.humidity((uint16_t)i));
+}
+
+int main()
+{
+  test_resolution<si7021::Resolution::H12_T14>(H12_T14);
+  test_resolution<si7021::Resolution::H8_T12>(H8_T12);
+  test_resolution<si7021::Resolution::H10_T13>(H10_T13);
+  test_resolution<si7021::Resolution::H11_T11>(H11_T11);
+  test_sensor();
+  test_cbus();
+  test_conversions();
+  bench();
+
+  printf("bench_hpp: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,303 @@
+/*
+*  Benchmark of the Linux i2c-dev port (Si7021_port_linux.c) without an adapter: open,
+*  close, ioctl, read and write are wrapped by the linker (see the Makefile) and pass the
+*  messages of /dev/i2c-fake to a simulated sensor (fake_Si7021.c). Each wrapped call also
+*  does one real system call, so the times include the kernel entry of the calls. Compares
+*  the batched I2C_RDWR transfer of the port with the usual I2C_SLAVE and read/write
+*  sequence by system calls and time per reading, and checks the NACK and error paths.
+*/
+#define _GNU_SOURCE
+
+#include "fake_Si7021.h"
+#include "Si7021_port_linux.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#define FAKE_DEVICE     "/dev/i2c-fake"
+#define FAKE_FD         100
+#define READINGS        200000
+
+int __real_open(const char* path, int flags, ...);
+int __real_close(int fd);
+int __real_ioctl(int fd, unsigned long request, ...);
+ssize_t __real_read(int fd, void* buf, size_t len);
+ssize_t __real_write(int fd, const void* buf, size_t len);
+
+static fake_bus_t fake;
+static uint16_t slave = 0;
+static uint32_t syscalls = 0;
+
+/* one fake adapter transfer of i2c-dev messages */
+static int fake_adapter(struct i2c_msg* msgs, uint32_t count)
+{
+  Si7021_msg_t converted[I2C_RDWR_IOCTL_MAX_MSGS];
+  uint32_t i;
+  int8_t rv;
+
+  syscalls++;
+  syscall(SYS_getppid);
+
+  if(count == 0 || count > I2C_RDWR_IOCTL_MAX_MSGS)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  for(i = 0; i < count; i++)
+  {
+    converted[i].dir = (msgs[i].flags & I2C_M_RD) ? I2C_Msg_Read : I2C_Msg_Write;
+    converted[i].len = (uint8_t)msgs[i].len;
+    converted[i].buf = msgs[i].buf;
+  }
+
+  rv = fake_transfer(&fake, msgs[0].addr, converted, (uint8_t)count);
+
+  if(rv < 0)
+  {
+    errno = (rv == SI7021_NACK) ? ENXIO : EIO;
+    return -1;
+  }
+
+  return (int)count;
+}
+
+int __wrap_open(const char* path, int flags, ...)
+{
+  va_list args;
+  int mode = 0;
+
+  if(strcmp(path, FAKE_DEVICE) == 0)
+  {
+    syscalls++;
+    return FAKE_FD;
+  }
+
+  if(flags & O_CREAT)
+  {
+    va_start(args, flags);
+    mode = va_arg(args, int);
+    va_end(args);
+  }
+
+  return __real_open(path, flags, mode);
+}
+
+int __wrap_close(int fd)
+{
+  if(fd != FAKE_FD)
+    return __real_close(fd);
+
+  syscalls++;
+
+  return 0;
+}
+
+int __wrap_ioctl(int fd, unsigned long request, ...)
+{
+  struct i2c_rdwr_ioctl_data* data;
+  va_list args;
+  void* arg;
+
+  va_start(args, request);
+  arg = va_arg(args, void*);
+  va_end(args);
+
+  if(fd != FAKE_FD)
+    return __real_ioctl(fd, request, arg);
+
+  switch(request)
+  {
+    case I2C_FUNCS:
+      syscalls++;
+      *(unsigned long*)arg = I2C_FUNC_I2C;
+      return 0;
+
+    case I2C_SLAVE:
+      syscalls++;
+      slave = (uint16_t)(uintptr_t)arg;
+      return 0;
+
+    case I2C_RDWR:
+      data = (struct i2c_rdwr_ioctl_data*)arg;
+      return fake_adapter(data->msgs, data->nmsgs);
+
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+}
+
+ssize_t __wrap_read(int fd, void* buf, size_t len)
+{
+  struct i2c_msg msg = {slave, I2C_M_RD, (uint16_t)len, (uint8_t*)buf};
+
+  if(fd != FAKE_FD)
+    return __real_read(fd, buf, len);
+
+  return (fake_adapter(&msg, 1) < 0) ? -1 : (ssize_t)len;
+}
+
+ssize_t __wrap_write(int fd, const void* buf, size_t len)
+{
+  struct i2c_msg msg = {slave, 0, (uint16_t)len, (uint8_t*)buf};
+
+  if(fd != FAKE_FD)
+    return __real_write(fd, buf, len);
+
+  return (fake_adapter(&msg, 1) < 0) ? -1 : (ssize_t)len;
+}
+
+/* the usual transfer without I2C_RDWR: I2C_SLAVE on address change, a system call per message */
+static int8_t slave_transfer(void* ctx, uint16_t addr, Si7021_msg_t* msgs, uint8_t count)
+{
+  Si7021_linux_i2c_t* i2c = (Si7021_linux_i2c_t*)ctx;
+  static int32_t selected = -1;
+  ssize_t rv;
+  uint8_t i;
+
+  if(selected != addr)
+  {
+    if(ioctl(i2c->fd, I2C_SLAVE, addr) < 0)
+      return -1;
+
+    selected = addr;
+  }
+
+  for(i = 0; i < count; i++)
+  {
+    if(msgs[i].dir == I2C_Msg_Read)
+      rv = read(i2c->fd, msgs[i].buf, msgs[i].len);
+    else
+      rv = write(i2c->fd, msgs[i].buf, msgs[i].len);
+
+    if(rv != msgs[i].len)
+      return (errno == ENXIO) ? SI7021_NACK : -1;
+  }
+
+  return 0;
+}
+
+static double seconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* returns the number of errors */
+static uint32_t bench(const char* name, Si7021_transfer_t transfer, Si7021_linux_i2c_t* i2c,
+                      uint8_t no_hold)
+{
+  Si7021_bus_t bus = SI7021_LINUX_BUS(i2c);
+  Si7021_sample_t sample;
+  Si7021_t dev;
+  uint32_t errors = 0;
+  uint32_t calls = syscalls;
+  uint32_t i;
+  double start;
+
+  bus.transfer = transfer;
+  attach_Si7021(&dev, &bus, 0);
+
+  start = seconds();
+
+  for(i = 0; i < READINGS; i++)
+  {
+    if(no_hold)
+    {
+      if(start_measurement_Si7021(&dev, Humidity) < 0 || fetch_sample_Si7021(&dev, &sample) != 0)
+        errors++;
+    }
+    else if(r_sample_Si7021(&dev, &sample) < 0)
+      errors++;
+  }
+
+  start = seconds() - start;
+
+  if(sample.humi_code != fake.sensors[0].rh_code || sample.temp_code != fake.sensors[0].temp_code)
+    errors++;
+
+  printf("%-24s %-4s %16.2f %12.0f\n", name, no_hold ? "NHM" : "HM",
+         (double)(syscalls - calls) / READINGS, start * 1e9 / READINGS);
+
+  return errors;
+}
+
+/* NACK of a conversion in progress and of an absent sensor, failed open */
+static uint32_t check_errors(Si7021_linux_i2c_t* i2c)
+{
+  Si7021_bus_t bus = SI7021_LINUX_BUS(i2c);
+  Si7021_sample_t sample;
+  Si7021_t dev;
+  Si7021_linux_i2c_t missing;
+  uint32_t errors = 0;
+  uint32_t failed = i2c->errors;
+
+  attach_Si7021(&dev, &bus, 0);
+
+  fake.sensors[0].conversion_us = 10000;
+
+  if(start_measurement_Si7021(&dev, Humidity) < 0 || fetch_sample_Si7021(&dev, &sample) != 1)
+    errors++;
+
+  fake_time_us += 10000;
+
+  if(fetch_sample_Si7021(&dev, &sample) != 0)
+    errors++;
+
+  fake.sensors[0].present = 0;
+
+  if(r_sample_Si7021(&dev, &sample) != -1 || i2c->errors == failed)
+    errors++;
+
+  fake.sensors[0].present = 1;
+
+  if(Si7021_linux_open(&missing, "/dev/i2c-missing") != -1)
+    errors++;
+
+  if(errors)
+    printf("error paths: FAILED\n");
+
+  return errors;
+}
+
+int main(void)
+{
+  Si7021_linux_i2c_t i2c;
+  uint32_t errors = 0;
+
+  fake_bus_init(&fake, 1);
+  fake.transfer_us = 0;
+  fake.sensors[0].conversion_us = 0;
+
+  if(Si7021_linux_open(&i2c, FAKE_DEVICE) < 0)
+  {
+    printf("bench_linux: open failed\n");
+    return 1;
+  }
+
+  printf("transfer                 mode syscalls/reading  ns/reading\n");
+
+  errors += bench("I2C_RDWR (port)", Si7021_linux_transfer, &i2c, 0);
+  errors += bench("I2C_SLAVE + read/write", slave_transfer, &i2c, 0);
+  errors += bench("I2C_RDWR (port)", Si7021_linux_transfer, &i2c, 1);
+  errors += bench("I2C_SLAVE + read/write", slave_transfer, &i2c, 1);
+  errors += check_errors(&i2c);
+
+  Si7021_linux_close(&i2c);
+
+  printf("bench_linux: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
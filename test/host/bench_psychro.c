@@ -0,0 +1,258 @@
+/*
+*  Accuracy and speed of the psychrometric functions (Si7021_psychro.c): sweeps the codes
+*  of a sample over -40 .. 125 C and 0.1 .. 100 %RH and compares the float and the integer
+*  functions with the formulas evaluated in double by log and exp (Magnus) and with the NWS
+*  heat index algorithm. Prints the maximum error of each function and the time per call,
+*  next to the float formulas by logf and expf. Fails if an error exceeds the limit given
+*  in Si7021_psychro.h.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "Si7021_psychro.h"
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#define MAGNUS_B          17.62
+#define MAGNUS_C          243.12
+#define MAGNUS_ES0        6.112
+#define WATER_VAPOUR_K    216.7
+#define KELVIN            273.15
+
+#define TEMP_CODE_MIN     2556         // -40 C
+#define TEMP_CODE_MAX     64093        // 125 C
+#define HUMI_CODE_MIN     3199         // 0.1 %RH
+#define HUMI_CODE_MAX     55574        // 100 %RH
+#define STEP              31           // codes between two points of the sweep
+#define HEAT_INDEX_MAX_C  50.0
+#define CALLS             1000000
+
+typedef struct error
+{
+  const char* name;
+  const char* unit;
+  double      limit;
+  double      max;
+  float       humidity;                // input of the maximum error
+  float       temperature;
+}error_t;
+
+static error_t errors[] =
+{
+  {"dew_point_Si7021",                 "C",      0.0001, 0, 0, 0},
+  {"dew_point_fixed_Si7021",           "C",      0.02,   0, 0, 0},
+  {"absolute_humidity_Si7021",         "%",      0.001,  0, 0, 0},
+  {"absolute_humidity_fixed_Si7021",   "%",      0.1,    0, 0, 0},   // above 1 g/m3
+  {"  under 1 g/m3",                   "g/m3",   0.001,  0, 0, 0},
+  {"heat_index_Si7021",                "C",      0.001,   0, 0, 0},
+  {"heat_index_fixed_Si7021",          "C",      0.15,   0, 0, 0}
+};
+
+/* the sink of the timed calls */
+static volatile float sink_f;
+static volatile int32_t sink_i;
+
+static double humidity(uint16_t code)
+{
+  double rh = 125.0 * code / 65536.0 - 6.0;
+
+  return (rh < 0) ? 0 : (rh > 100) ? 100 : rh;
+}
+
+static double temperature(uint16_t code)
+{
+  return 175.72 * code / 65536.0 - 46.85;
+}
+
+static double dew_point(double rh, double t)
+{
+  double gamma = log((rh < 0.1 ? 0.1 : rh) / 100) + MAGNUS_B * t / (MAGNUS_C + t);
+
+  return MAGNUS_C * gamma / (MAGNUS_B - gamma);
+}
+
+/* g/m3 */
+static double absolute_humidity(double rh, double t)
+{
+  return WATER_VAPOUR_K * rh / 100 * MAGNUS_ES0 * exp(MAGNUS_B * t / (MAGNUS_C + t)) /
+         (KELVIN + t);
+}
+
+/* NWS heat index in F; 'branch' tells the formula: Steadman, regression, adjusted by 2, 3 */
+static double heat_index_f(double rh, double t, int* branch)
+{
+  double hi = 0.5 * (t + 61.0 + (t - 68.0) * 1.2 + rh * 0.094);
+
+  *branch = 0;
+
+  if((hi + t) / 2 < 80.0)
+    return hi;
+
+  *branch = 1;
+
+  hi = -42.379 + 2.04901523 * t + 10.14333127 * rh - 0.22475541 * t * rh
+       - 6.83783e-3 * t * t - 5.481717e-2 * rh * rh + 1.22874e-3 * t * t * rh
+       + 8.5282e-4 * t * rh * rh - 1.99e-6 * t * t * rh * rh;
+
+  if(rh < 13.0 && t >= 80.0 && t <= 112.0)
+  {
+    *branch = 2;
+    hi -= (13.0 - rh) / 4 * sqrt((17.0 - fabs(t - 95.0)) / 17);
+  }
+  else if(rh > 85.0 && t >= 80.0 && t <= 87.0)
+  {
+    *branch = 3;
+    hi += (rh - 85.0) / 10 * (87.0 - t) / 5;
+  }
+
+  return hi;
+}
+
+/*
+*  Heat index in C; 'near_switch' is set if the inputs rounded to 0.01 may select another
+*  formula, where the algorithm is discontinuous.
+*/
+static double heat_index(double rh, double t, int* near_switch)
+{
+  int a, b, i;
+  double hi = heat_index_f(rh, t * 9 / 5 + 32, &a);
+
+  *near_switch = 0;
+
+  for(i = 0; i < 4; i++)
+  {
+    heat_index_f(rh + ((i & 1) ? 0.01 : -0.01), (t + ((i & 2) ? 0.01 : -0.01)) * 9 / 5 + 32, &b);
+    *near_switch |= (a != b);
+  }
+
+  return (hi - 32) * 5 / 9;
+}
+
+static void note(error_t* e, double error, double rh, double t)
+{
+  if(fabs(error) > e->max)
+  {
+    e->max = fabs(error);
+    e->humidity = (float)rh;
+    e->temperature = (float)t;
+  }
+}
+
+static void sweep(void)
+{
+  uint32_t h, c;
+  double rh, t, ref;
+  int near_switch;
+
+  for(c = TEMP_CODE_MIN; c <= TEMP_CODE_MAX; c += STEP)
+  {
+    for(h = HUMI_CODE_MIN; h <= HUMI_CODE_MAX; h += STEP)
+    {
+      rh = humidity((uint16_t)h);
+      t = temperature((uint16_t)c);
+
+      ref = dew_point(rh, t);
+      note(&errors[0], dew_point_Si7021((float)rh, (float)t) - ref, rh, t);
+      note(&errors[1], dew_point_fixed_Si7021((uint16_t)h, (uint16_t)c) / 100.0 - ref, rh, t);
+
+      /* relative, the integer version absolute under 1 g/m3 */
+      ref = absolute_humidity(rh, t);
+
+      if(ref > 0)
+        note(&errors[2], (absolute_humidity_Si7021((float)rh, (float)t) - ref) / ref * 100,
+             rh, t);
+
+      if(ref > 1)
+        note(&errors[3], (absolute_humidity_fixed_Si7021((uint16_t)h, (uint16_t)c) / 1000.0 -
+             ref) / ref * 100, rh, t);
+      else
+        note(&errors[4], absolute_humidity_fixed_Si7021((uint16_t)h, (uint16_t)c) / 1000.0 -
+             ref, rh, t);
+
+      if(t > HEAT_INDEX_MAX_C)
+        continue;
+
+      ref = heat_index(rh, t, &near_switch);
+      note(&errors[5], heat_index_Si7021((float)rh, (float)t) - ref, rh, t);
+
+      if(!near_switch)
+        note(&errors[6], heat_index_fixed_Si7021((uint16_t)h, (uint16_t)c) / 100.0 - ref, rh, t);
+    }
+  }
+}
+
+static double seconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the codes and values of the i-th timed call, spread over the range */
+#define CODE_H(i)    ((uint16_t)(HUMI_CODE_MIN + ((i) * 7919u) % (HUMI_CODE_MAX - HUMI_CODE_MIN)))
+#define CODE_T(i)    ((uint16_t)(TEMP_CODE_MIN + ((i) * 104729u) % (TEMP_CODE_MAX - TEMP_CODE_MIN)))
+#define VALUE_H(i)   ((float)(CODE_H(i) >> 9))
+#define VALUE_T(i)   ((float)(CODE_T(i) >> 9) - 40.0f)
+
+#define TIME(name, expr)                                                \
+  do {                                                                  \
+    uint32_t i;                                                         \
+    double start = seconds();                                           \
+    for(i = 0; i < CALLS; i++)                                          \
+      expr;                                                             \
+    printf("  %-34s %6.1f ns\n", name, (seconds() - start) * 1e9 / CALLS); \
+  } while(0)
+
+/* Magnus dew point and absolute humidity in float by logf and expf */
+static float dew_point_libm(float rh, float t)
+{
+  float gamma = logf(rh / 100) + 17.62f * t / (243.12f + t);
+
+  return 243.12f * gamma / (17.62f - gamma);
+}
+
+static float absolute_humidity_libm(float rh, float t)
+{
+  return 216.7f * rh / 100 * 6.112f * expf(17.62f * t / (243.12f + t)) / (273.15f + t);
+}
+
+static void timing(void)
+{
+  printf("time per call:\n");
+  TIME("dew point, logf", sink_f = dew_point_libm(VALUE_H(i) + 0.1f, VALUE_T(i)));
+  TIME("dew_point_Si7021", sink_f = dew_point_Si7021(VALUE_H(i), VALUE_T(i)));
+  TIME("dew_point_fixed_Si7021", sink_i = dew_point_fixed_Si7021(CODE_H(i), CODE_T(i)));
+  TIME("absolute humidity, expf", sink_f = absolute_humidity_libm(VALUE_H(i), VALUE_T(i)));
+  TIME("absolute_humidity_Si7021", sink_f = absolute_humidity_Si7021(VALUE_H(i), VALUE_T(i)));
+  TIME("absolute_humidity_fixed_Si7021",
+       sink_i = (int32_t)absolute_humidity_fixed_Si7021(CODE_H(i), CODE_T(i)));
+  TIME("heat_index_Si7021", sink_f = heat_index_Si7021(VALUE_H(i), VALUE_T(i)));
+  TIME("heat_index_fixed_Si7021", sink_i = heat_index_fixed_Si7021(CODE_H(i), CODE_T(i)));
+}
+
+int main(void)
+{
+  uint32_t failed = 0;
+  uint8_t i;
+
+  sweep();
+
+  printf("maximum error (limit) at RH, T:\n");
+
+  for(i = 0; i < sizeof(errors) / sizeof(errors[0]); i++)
+  {
+    printf("  %-34s %9.5f %-6s (%g) at %6.2f %%, %7.2f C\n", errors[i].name, errors[i].max,
+           errors[i].unit, errors[i].limit, errors[i].humidity, errors[i].temperature);
+
+    if(errors[i].max > errors[i].limit)
+      failed++;
+  }
+
+  timing();
+
+  printf("bench_psychro: %s\n", failed ? "FAILED" : "OK");
+
+  return failed ? 1 : 0;
+}
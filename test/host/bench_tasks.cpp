@@ -0,0 +1,331 @@
+/*
+*  Benchmark of the resumable operations (Si7021_task.h) and their coroutine front-end
+*  (Si7021_coro.hpp): 500 sensors, each on its own fake bus, sample back to back for 10
+*  virtual seconds at mixed resolutions, stepped on one stack at 1 ms ticks. Prints the
+*  samples per virtual second, the CPU time of the steps and the memory of an operation in
+*  flight. Also checks that a coroutine started long after the last poll by Loop::start
+*  waits for its conversion, and that an exception thrown in a task reaches the awaiting
+*  task and Task::result. Fails if an operation fails or a sample carries wrong codes.
+*/
+#include "Si7021_coro.hpp"
+
+extern "C"
+{
+#include "fake_Si7021.h"
+}
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#define SENSORS          500
+#define DURATION_MS      10000
+#define CONVERSION_US    5000          // sensor conversion, shorter than the maximum time
+
+static const Si7021_resolution_t resolutions[4] = {H12_T14, H8_T12, H10_T13, H11_T11};
+
+/* coroutine frames are the only heap allocations of the timed loops */
+static size_t frame_bytes = 0;
+static size_t frames = 0;
+static size_t live_frames = 0;
+
+void* operator new(size_t size)
+{
+  void* p = malloc(size);
+
+  if(p == nullptr)
+    throw std::bad_alloc();
+
+  frame_bytes += size;
+  frames++;
+  live_frames++;
+
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  live_frames--;
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  live_frames--;
+  free(p);
+}
+
+struct Bench
+{
+  std::vector<fake_bus_t>   fakes;
+  std::vector<Si7021_bus_t> buses;
+  std::vector<Si7021_t>     devs;
+  uint32_t                  samples = 0;
+  uint32_t                  errors = 0;
+
+  Bench() : fakes(SENSORS), buses(SENSORS), devs(SENSORS)
+  {
+    uint16_t i;
+
+    fake_time_us = 0;
+
+    for(i = 0; i < SENSORS; i++)
+    {
+      fake_bus_init(&fakes[i], 1);
+      fakes[i].transfer_us = 0;
+      fakes[i].sensors[0].conversion_us = CONVERSION_US;
+
+      buses[i] = Si7021_bus_t{};
+      buses[i].transfer = fake_transfer;
+      buses[i].select = fake_select;
+      buses[i].ctx = &fakes[i];
+      buses[i].now_ms = fake_now_ms;
+      buses[i].now_us = fake_now_us;
+      buses[i].channels = FAKE_CHANNELS;
+      buses[i].active_channel = SI7021_NO_CHANNEL;
+
+      attach_Si7021(&devs[i], &buses[i], 0);
+    }
+  }
+
+  void check(uint16_t i, const Si7021_sample_t& sample)
+  {
+    if(sample.humi_code != fakes[i].sensors[0].rh_code ||
+       sample.temp_code != fakes[i].sensors[0].temp_code)
+      errors++;
+    else
+      samples++;
+  }
+};
+
+static double seconds(void)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+         .count();
+}
+
+/* C tasks: a resolution task, then sample tasks restarted as soon as they finish */
+static uint32_t bench_c(void)
+{
+  Bench b;
+  std::vector<Si7021_resolution_task_t> setup(SENSORS);
+  std::vector<Si7021_sample_task_t> sample(SENSORS);
+  std::vector<uint8_t> sampling(SENSORS, 0);
+  uint64_t steps = 0;
+  uint32_t now;
+  uint16_t i;
+  int8_t rv;
+  double start;
+
+  for(i = 0; i < SENSORS; i++)
+  {
+    resolution_task_init_Si7021(&setup[i], &b.devs[i], resolutions[i % 4], 0, nullptr);
+    sample_task_init_Si7021(&sample[i], &b.devs[i], 0, nullptr);
+  }
+
+  start = seconds();
+
+  for(now = 0; now < DURATION_MS; now++)
+  {
+    fake_time_us = (uint64_t)now * 1000;
+
+    for(i = 0; i < SENSORS; i++)
+    {
+      Si7021_job_t* job = sampling[i] ? &sample[i].job : &setup[i].job;
+
+      while((int32_t)(now - job->wake) >= 0)
+      {
+        steps++;
+        rv = job->step(job, now);
+
+        if(rv == SI7021_STEP_WAIT)
+          break;
+
+        if(rv < 0)
+        {
+          b.errors++;
+          break;
+        }
+
+        b.check(i, sampling[i] ? sample[i].sample : setup[i].sample.sample);
+        sampling[i] = 1;
+        job = &sample[i].job;
+        job->wake = now;
+      }
+    }
+  }
+
+  start = seconds() - start;
+
+  printf("C tasks     %8.0f %12.0f %9.0f   %u B (sample), %u B (resolution + sample)\n",
+         b.samples * 1000.0 / DURATION_MS, b.samples / start, start * 1e9 / steps,
+         (unsigned)sizeof(Si7021_sample_task_t), (unsigned)sizeof(Si7021_resolution_task_t));
+
+  return b.errors;
+}
+
+static si7021::Task<int8_t> worker(si7021::Loop& loop, Bench& b, uint16_t i)
+{
+  Si7021_sample_t sample;
+
+  if(co_await si7021::set_resolution(loop, &b.devs[i], resolutions[i % 4]) < 0)
+    co_return -1;
+
+  for(;;)
+  {
+    if(co_await si7021::sample(loop, &b.devs[i], sample) < 0)
+      co_return -1;
+
+    b.check(i, sample);
+  }
+}
+
+/* coroutines: one endless task per sensor */
+static uint32_t bench_coro(void)
+{
+  Bench b;
+  si7021::Loop loop;
+  std::vector<si7021::Task<int8_t>> workers;
+  size_t bytes, count, live;
+  uint32_t now;
+  uint16_t i;
+  double start;
+
+  workers.reserve(SENSORS);
+
+  bytes = frame_bytes;
+  count = frames;
+  live = live_frames;
+
+  for(i = 0; i < SENSORS; i++)
+  {
+    workers.push_back(worker(loop, b, i));
+    loop.start(workers.back(), 0);
+  }
+
+  start = seconds();
+
+  for(now = 0; now < DURATION_MS; now++)
+  {
+    fake_time_us = (uint64_t)now * 1000;
+    loop.poll(now, nullptr);
+  }
+
+  start = seconds() - start;
+
+  for(i = 0; i < SENSORS; i++)
+  {
+    if(workers[i].done())
+      b.errors++;
+  }
+
+  printf("coroutines  %8.0f %12.0f %9s   %.1f frames per sensor, %.0f B each (heap)\n",
+         b.samples * 1000.0 / DURATION_MS, b.samples / start, "-",
+         (double)(live_frames - live) / SENSORS, (double)(frame_bytes - bytes) / (frames - count));
+
+  return b.errors;
+}
+
+/* a task started after an idle period counts its waits from the start, not the last poll */
+static uint32_t late_start(void)
+{
+  Bench b;
+  si7021::Loop loop;
+  Si7021_sample_t sample;
+  uint32_t now;
+
+  loop.poll(0, nullptr);
+
+  now = 1000;
+  fake_time_us = (uint64_t)now * 1000;
+
+  si7021::Task<int8_t> task = si7021::sample(loop, &b.devs[0], sample);
+  loop.start(task, now);
+
+  while(!task.done() && now < 1100)
+  {
+    now++;
+    fake_time_us = (uint64_t)now * 1000;
+    loop.poll(now, nullptr);
+  }
+
+  if(!task.done() || task.result() != 0 || b.fakes[0].sensors[0].transfers != 2)
+  {
+    printf("late start: sampling failed\n");
+    return 1;
+  }
+
+  return 0;
+}
+
+static si7021::Task<int8_t> throwing(si7021::Loop& loop)
+{
+  co_await loop.sleep_until(loop.now() + 1);
+
+  throw std::runtime_error("bus lost");
+
+  co_return 0;
+}
+
+static si7021::Task<int8_t> catching(si7021::Loop& loop)
+{
+  try
+  {
+    co_return co_await throwing(loop);
+  }
+  catch(const std::runtime_error&)
+  {
+    co_return -2;
+  }
+}
+
+/* an exception is not lost in the loop */
+static uint32_t exceptions(void)
+{
+  si7021::Loop loop;
+  uint32_t errors = 0;
+
+  si7021::Task<int8_t> caught = catching(loop);
+  si7021::Task<int8_t> thrown = throwing(loop);
+
+  loop.start(caught, 0);
+  loop.start(thrown, 0);
+  loop.poll(1, nullptr);
+
+  if(!caught.done() || caught.result() != -2)
+    errors++;
+
+  try
+  {
+    thrown.result();
+    errors++;
+  }
+  catch(const std::runtime_error&)
+  {
+  }
+
+  if(errors)
+    printf("exceptions: not rethrown\n");
+
+  return errors;
+}
+
+int main(void)
+{
+  uint32_t errors = 0;
+
+  printf("%u sensors, %u virtual s\n", SENSORS, DURATION_MS / 1000);
+  printf("            samples/s  samples/CPU s  ns/step   memory in flight\n");
+
+  errors += bench_c();
+  errors += bench_coro();
+  errors += late_start();
+  errors += exceptions();
+
+  printf("bench_tasks: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
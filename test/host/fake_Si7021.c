@@ -0,0 +1,236 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "fake_Si7021.h"
+#include <time.h>
+
+uint64_t fake_time_us = 0;
+
+static uint8_t real_time = 0;
+
+static uint8_t crc8(uint8_t crc, uint8_t data);
+static uint64_t now_us(void);
+static void spend(uint32_t us);
+static void put_code(const Si7021_msg_t* msg, uint16_t code);
+static int8_t answer(fake_Si7021_t* sensor, const Si7021_msg_t* msg);
+static void command(fake_Si7021_t* sensor, const Si7021_msg_t* msg);
+
+static uint8_t crc8(uint8_t crc, uint8_t data)
+{
+  uint8_t i;
+
+  crc ^= data;
+
+  for(i = 0; i < 8; i++)
+    crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x31) : (uint8_t)(crc << 1);
+
+  return crc;
+}
+
+static uint64_t now_us(void)
+{
+  struct timespec ts;
+
+  if(!real_time)
+    return fake_time_us;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/* time taken by the bus or the sensor */
+static void spend(uint32_t us)
+{
+  struct timespec ts = {us / 1000000, (long)(us % 1000000) * 1000L};
+
+  if(real_time)
+    nanosleep(&ts, NULL);
+  else
+    fake_time_us += us;
+}
+
+/* measurement code, with checksum if 3 bytes are read */
+static void put_code(const Si7021_msg_t* msg, uint16_t code)
+{
+  msg->buf[0] = (uint8_t)(code >> 8);
+  msg->buf[1] = (uint8_t)code;
+
+  if(msg->len > 2)
+    msg->buf[2] = crc8(crc8(0, msg->buf[0]), msg->buf[1]);
+}
+
+static void command(fake_Si7021_t* sensor, const Si7021_msg_t* msg)
+{
+  sensor->command[0] = msg->buf[0];
+  sensor->command[1] = (msg->len > 1) ? msg->buf[1] : 0;
+
+  switch(msg->buf[0])
+  {
+    case W_RHT_U_reg:    sensor->user_register_1 = msg->buf[1]; break;
+    case W_Heater_C_reg: sensor->heater_control_register = msg->buf[1]; break;
+
+    case Si7021_Reset:
+      sensor->user_register_1 = SI7021_USER_REG_1_DEFAULT;
+      sensor->heater_control_register = 0;
+      sensor->pending = 0;
+      break;
+
+    case Humi_NHM:
+    case Temp_NHM:
+      sensor->pending = 1;
+      sensor->ready_us = now_us() + sensor->conversion_us;
+      sensor->conversions++;
+      break;
+
+    default:
+      break;
+  }
+}
+
+static int8_t answer(fake_Si7021_t* sensor, const Si7021_msg_t* msg)
+{
+  uint8_t crc = 0;
+  uint8_t i;
+
+  switch(sensor->command[0])
+  {
+    case Humi_HM:
+    case Temp_HM:
+      /* the clock is stretched for the conversion */
+      spend(sensor->conversion_us);
+      sensor->conversions++;
+      put_code(msg, (sensor->command[0] == Humi_HM) ? sensor->rh_code : sensor->temp_code);
+      break;
+
+    case Humi_NHM:
+    case Temp_NHM:
+      if(!sensor->pending || (int64_t)(now_us() - sensor->ready_us) < 0)
+        return SI7021_NACK;
+
+      sensor->pending = 0;
+      put_code(msg, (sensor->command[0] == Humi_NHM) ? sensor->rh_code : sensor->temp_code);
+      break;
+
+    case Temp_AH:        put_code(msg, sensor->temp_code); break;
+    case R_RHT_U_reg:    msg->buf[0] = sensor->user_register_1; break;
+    case R_Heater_C_reg: msg->buf[0] = sensor->heater_control_register; break;
+    case R_Firm_rev1:    msg->buf[0] = 0x20; break;
+
+    case R_ID_Byte11:
+      for(i = 0; i < 4 && 2 * i + 1 < msg->len; i++)
+      {
+        msg->buf[2 * i] = (uint8_t)(sensor->serial_a >> (24 - 8 * i));
+        crc = crc8(crc, msg->buf[2 * i]);
+        msg->buf[2 * i + 1] = crc;
+      }
+      break;
+
+    case R_ID_Byte21:
+      for(i = 0; i < 2 && 3 * i + 2 < msg->len; i++)
+      {
+        msg->buf[3 * i] = (uint8_t)(sensor->serial_b >> (24 - 16 * i));
+        msg->buf[3 * i + 1] = (uint8_t)(sensor->serial_b >> (16 - 16 * i));
+        crc = crc8(crc8(crc, msg->buf[3 * i]), msg->buf[3 * i + 1]);
+        msg->buf[3 * i + 2] = crc;
+      }
+      break;
+
+    default:
+      return -1;
+  }
+
+  return 0;
+}
+
+void fake_bus_init(fake_bus_t* bus, uint8_t count)
+{
+  uint8_t i;
+
+  for(i = 0; i < FAKE_CHANNELS; i++)
+  {
+    fake_Si7021_t* sensor = &(bus->sensors[i]);
+
+    sensor->present = (i < count);
+    sensor->user_register_1 = SI7021_USER_REG_1_DEFAULT;
+    sensor->heater_control_register = 0;
+    sensor->rh_code = (uint16_t)(0x7000 + 0x100 * i);
+    sensor->temp_code = (uint16_t)(0x6000 + 0x100 * i);
+    sensor->serial_a = 0x15FF0000u + i;
+    sensor->serial_b = 0x15FFFF00u + i;
+    sensor->conversion_us = 20000;
+    sensor->command[0] = 0;
+    sensor->pending = 0;
+    sensor->conversions = 0;
+    sensor->transfers = 0;
+  }
+
+  bus->channel = 0;
+  bus->transfer_us = 100;
+  bus->busy = 0;
+  bus->overlaps = 0;
+}
+
+void fake_set_real_time(uint8_t on)
+{
+  real_time = on;
+}
+
+int8_t fake_select(void* ctx, uint8_t channel)
+{
+  fake_bus_t* bus = (fake_bus_t*)ctx;
+
+  if(channel >= FAKE_CHANNELS)
+    return -1;
+
+  bus->channel = channel;
+
+  return 0;
+}
+
+int8_t fake_transfer(void* ctx, uint16_t addr, Si7021_msg_t* msgs, uint8_t count)
+{
+  fake_bus_t* bus = (fake_bus_t*)ctx;
+  fake_Si7021_t* sensor = &(bus->sensors[bus->channel]);
+  int8_t rv = 0;
+  uint8_t i;
+
+  /* a second transfer at the same time means the bus lock failed */
+  if(__atomic_add_fetch(&(bus->busy), 1, __ATOMIC_ACQ_REL) > 1)
+    __atomic_add_fetch(&(bus->overlaps), 1, __ATOMIC_RELAXED);
+
+  spend(bus->transfer_us);
+
+  /* the address is not acknowledged during a No Hold Master conversion */
+  if(addr != 0x40 || !sensor->present ||
+     (sensor->pending && (int64_t)(now_us() - sensor->ready_us) < 0))
+    rv = SI7021_NACK;
+
+  for(i = 0; i < count && rv == 0; i++)
+  {
+    if(msgs[i].dir == I2C_Msg_Write)
+      command(sensor, &msgs[i]);
+    else
+      rv = answer(sensor, &msgs[i]);
+  }
+
+  sensor->transfers++;
+
+  __atomic_sub_fetch(&(bus->busy), 1, __ATOMIC_ACQ_REL);
+
+  return rv;
+}
+
+uint32_t fake_now_ms(void)
+{
+  return (uint32_t)(now_us() / 1000);
+}
+
+uint32_t fake_now_us(void)
+{
+  return (uint32_t)now_us();
+}
+
+void fake_delay_ms(uint32_t ms)
+{
+  spend(ms * 1000);
+}
@@ -0,0 +1,63 @@
+#ifndef FAKE_SI7021_H_
+#define FAKE_SI7021_H_
+
+#include "Si7021_driver.h"
+
+/*
+*  Simulated Si7021 sensors behind a simulated I2C bus with a multiplexer, for the host
+*  tests. The bus functions plug into a Si7021_bus_t:
+*
+*      fake_bus_t fake;
+*      Si7021_bus_t bus = {.transfer = fake_transfer, .select = fake_select, .ctx = &fake,
+*                          .now_ms = fake_now_ms, .now_us = fake_now_us,
+*                          .delay_ms = fake_delay_ms, .channels = FAKE_CHANNELS,
+*                          .active_channel = SI7021_NO_CHANNEL};
+*
+*  Time is virtual by default: transfers and conversions advance fake_time_us, so the tests
+*  are deterministic. In real time mode (fake_set_real_time) they sleep instead and the
+*  clock is CLOCK_MONOTONIC, which is used by the multi-threaded tests.
+*/
+
+#define FAKE_CHANNELS           8      // multiplexer channels of a fake bus
+
+typedef struct fake_Si7021
+{
+  uint8_t  present;                    // 0: the address is not acknowledged
+  uint8_t  user_register_1;
+  uint8_t  heater_control_register;
+  uint16_t rh_code;                    // humidity code returned by the conversions
+  uint16_t temp_code;                  // temperature code returned by the conversions
+  uint32_t serial_a;
+  uint32_t serial_b;
+  uint32_t conversion_us;              // duration of a humidity conversion
+  uint8_t  command[2];                 // last command written
+  uint8_t  pending;                    // No Hold Master conversion started, not read yet;
+                                       // the address is not acknowledged until it is done
+  uint64_t ready_us;                   // end of the No Hold Master conversion
+  uint32_t conversions;                // number of conversions
+  uint32_t transfers;                  // number of transfers addressed to the sensor
+}fake_Si7021_t;
+
+typedef struct fake_bus
+{
+  fake_Si7021_t sensors[FAKE_CHANNELS];// sensor on each multiplexer channel
+  uint8_t  channel;                    // selected channel
+  uint32_t transfer_us;                // bus time of a transfer
+  uint32_t busy;                       // transfers in progress
+  uint32_t overlaps;                   // transfers started while another was in progress
+}fake_bus_t;
+
+extern uint64_t fake_time_us;          // virtual time
+
+/* sensors present on the first 'count' channels with distinct codes and serial numbers */
+void fake_bus_init(fake_bus_t* bus, uint8_t count);
+void fake_set_real_time(uint8_t on);
+
+int8_t fake_transfer(void* ctx, uint16_t addr, Si7021_msg_t* msgs, uint8_t count);
+int8_t fake_select(void* ctx, uint8_t channel);
+
+uint32_t fake_now_ms(void);
+uint32_t fake_now_us(void);
+void fake_delay_ms(uint32_t ms);
+
+#endif /* FAKE_SI7021_H_ */
@@ -0,0 +1,63 @@
+#ifndef FAKE_STM32F4XX_HAL_H_
+#define FAKE_STM32F4XX_HAL_H_
+
+/*
+*  The part of the STM32 HAL and CMSIS used by Si7021_port_stm32.c, for the host tests. The
+*  core registers are read through functions, so the simulated CPU time advances with every
+*  access, see test_stm32_time.c.
+*/
+
+#include <stdint.h>
+
+typedef struct
+{
+  uint32_t ErrorCode;
+}I2C_HandleTypeDef;
+
+typedef enum
+{
+  HAL_OK,
+  HAL_ERROR,
+  HAL_BUSY,
+  HAL_TIMEOUT
+}HAL_StatusTypeDef;
+
+#define I2C_MEMADD_SIZE_8BIT       1u
+#define I2C_MEMADD_SIZE_16BIT      2u
+#define HAL_I2C_ERROR_AF           4u
+#define PWR_MAINREGULATOR_ON       0u
+#define PWR_SLEEPENTRY_WFI         1u
+#define SCB_ICSR_PENDSTSET_Msk     (1u << 26)
+
+typedef struct
+{
+  uint32_t CTRL, LOAD, VAL, CALIB;
+}SysTick_Type;
+
+typedef struct
+{
+  uint32_t ICSR;
+}SCB_Type;
+
+#define SysTick                    (fake_systick())
+#define SCB                        (fake_scb())
+
+SysTick_Type* fake_systick(void);
+SCB_Type* fake_scb(void);
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t mem_addr,
+                                   uint16_t mem_size, uint8_t* data, uint16_t size,
+                                   uint32_t timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef* hi2c, uint16_t addr, uint8_t* data,
+                                          uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef* hi2c, uint16_t addr, uint8_t* data,
+                                         uint16_t size, uint32_t timeout);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef* hi2c);
+void HAL_PWR_EnterSLEEPMode(uint32_t regulator, uint8_t entry);
+uint32_t HAL_GetTick(void);
+uint32_t HAL_GetTickFreq(void);
+void HAL_Delay(uint32_t ms);
+
+extern uint32_t SystemCoreClock;
+
+#endif /* FAKE_STM32F4XX_HAL_H_ */
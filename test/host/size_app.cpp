@@ -0,0 +1,57 @@
+/*
+*  Minimal application for the code size comparison of bench_hpp: sets the resolution and
+*  reads a sample by the C API (SIZE_C_API) or by Si7021.hpp. Both are linked with the
+*  unused sections removed against the same bus, 'make size' prints the text sizes.
+*/
+#ifdef SIZE_C_API
+extern "C"
+{
+#include "Si7021_driver.h"
+}
+#else
+#include "Si7021.hpp"
+#endif
+
+/* the bus of the board, not inlined into the driver */
+extern "C" __attribute__((noinline)) int8_t board_transfer(void* ctx, uint16_t addr,
+                                                            Si7021_msg_t* msgs, uint8_t count)
+{
+  (void)ctx;
+  (void)addr;
+
+  for(uint8_t i = 0; i < count; i++)
+  {
+    if(msgs[i].dir == I2C_Msg_Read)
+      msgs[i].buf[0] = (uint8_t)msgs[i].len;
+  }
+
+  return 0;
+}
+
+static Si7021_bus_t bus = {};
+
+int main()
+{
+  Si7021_sample_t sample = {};
+
+  bus.transfer = board_transfer;
+  bus.active_channel = SI7021_NO_CHANNEL;
+
+#ifdef SIZE_C_API
+  Si7021_t dev;
+
+  attach_Si7021(&dev, &bus, 0);
+
+  if(set_resolution_Si7021(&dev, H11_T11) < 0 || r_sample_Si7021(&dev, &sample) < 0)
+    return 1;
+
+  return (int)code_to_humidity_Si7021(sample.humi_code);
+#else
+  si7021::Sensor<si7021::CBus, si7021::Resolution::H11_T11> sensor{{&bus}};
+
+  if(sensor.init() < 0 || sensor.read(sample) < 0)
+    return 1;
+
+  return (int)sensor.humidity(sample.humi_code);
+#endif
+}
@@ -0,0 +1,162 @@
+/*
+*  Stress test of the bus locks (Si7021_port_pthread.c): threads sharing sensors on several
+*  fake buses measure, reconfigure and read the latest samples at the same time. Fails if
+*  two transfers overlap on a bus, a sample or snapshot carries the codes of another sensor,
+*  or a local register copy differs from the sensor. Prints the throughput by the number of
+*  buses: the buses work in parallel, so it scales with them.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "fake_Si7021.h"
+#include "Si7021_port_pthread.h"
+#include <stdio.h>
+#include <time.h>
+
+#define MAX_BUSES           4
+#define SENSORS_PER_BUS     4
+#define THREADS_PER_SENSOR  2
+#define SAMPLES_PER_THREAD  125
+
+typedef struct worker
+{
+  pthread_t      thread;
+  Si7021_t*      dev;
+  fake_Si7021_t* sensor;
+  uint8_t        id;
+  uint32_t       errors;
+}worker_t;
+
+static fake_bus_t fakes[MAX_BUSES];
+static Si7021_bus_t buses[MAX_BUSES];
+static pthread_mutex_t mutexes[MAX_BUSES];
+static Si7021_t devs[MAX_BUSES][SENSORS_PER_BUS];
+static worker_t workers[MAX_BUSES * SENSORS_PER_BUS * THREADS_PER_SENSOR];
+
+static void* work(void* arg)
+{
+  worker_t* w = (worker_t*)arg;
+  Si7021_sample_t sample;
+  uint16_t i;
+
+  for(i = 0; i < SAMPLES_PER_THREAD; i++)
+  {
+    if(r_sample_Si7021(w->dev, &sample) < 0 ||
+       sample.humi_code != w->sensor->rh_code || sample.temp_code != w->sensor->temp_code)
+      w->errors++;
+
+    /* lock-free reader, never sees a torn or foreign sample */
+    if(latest_Si7021(w->dev, &sample) == 0 &&
+       (sample.humi_code != w->sensor->rh_code || sample.temp_code != w->sensor->temp_code))
+      w->errors++;
+
+    /* the other thread of the sensor changes it as well */
+    if(i % 8 == w->id % 8 &&
+       set_resolution_Si7021(w->dev, (i & 8) ? H11_T11 : H12_T14) < 0)
+      w->errors++;
+  }
+
+  return NULL;
+}
+
+static double seconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* returns the number of errors and the samples per second */
+static uint32_t run(uint8_t bus_count, double* rate)
+{
+  uint32_t errors = 0;
+  uint16_t count = 0;
+  uint16_t i;
+  uint8_t b, s, t;
+  double start;
+
+  *rate = 0;
+
+  for(b = 0; b < bus_count; b++)
+  {
+    fake_bus_init(&fakes[b], SENSORS_PER_BUS);
+    fakes[b].transfer_us = 50;
+
+    for(s = 0; s < SENSORS_PER_BUS; s++)
+      fakes[b].sensors[s].conversion_us = 500;
+
+    buses[b] = (Si7021_bus_t){.transfer = fake_transfer, .select = fake_select,
+                              .ctx = &fakes[b], .now_ms = fake_now_ms,
+                              .channels = FAKE_CHANNELS, .active_channel = SI7021_NO_CHANNEL};
+
+    if(Si7021_pthread_lock_init(&buses[b], &mutexes[b]) < 0)
+      return 1;
+
+    for(s = 0; s < SENSORS_PER_BUS; s++)
+    {
+      attach_Si7021(&devs[b][s], &buses[b], s);
+
+      for(t = 0; t < THREADS_PER_SENSOR; t++, count++)
+        workers[count] = (worker_t){.dev = &devs[b][s], .sensor = &fakes[b].sensors[s],
+                                    .id = t};
+    }
+  }
+
+  start = seconds();
+
+  for(i = 0; i < count; i++)
+    pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+
+  for(i = 0; i < count; i++)
+  {
+    pthread_join(workers[i].thread, NULL);
+    errors += workers[i].errors;
+  }
+
+  *rate = count * SAMPLES_PER_THREAD / (seconds() - start);
+
+  for(b = 0; b < bus_count; b++)
+  {
+    errors += fakes[b].overlaps;
+
+    for(s = 0; s < SENSORS_PER_BUS; s++)
+    {
+      if(devs[b][s].user_register_1 != fakes[b].sensors[s].user_register_1)
+        errors++;
+    }
+
+    pthread_mutex_destroy(&mutexes[b]);
+  }
+
+  return errors;
+}
+
+int main(void)
+{
+  uint32_t errors = 0;
+  uint32_t e;
+  double rate, base = 0;
+  uint8_t buses_used;
+
+  fake_set_real_time(1);
+
+  printf("buses threads  samples/s  speedup  errors\n");
+
+  for(buses_used = 1; buses_used <= MAX_BUSES; buses_used *= 2)
+  {
+    e = run(buses_used, &rate);
+    errors += e;
+
+    if(buses_used == 1)
+      base = rate;
+
+    printf("%5u %7u %10.0f %8.2f %7lu\n", buses_used,
+           buses_used * SENSORS_PER_BUS * THREADS_PER_SENSOR, rate, rate / base,
+           (unsigned long)e);
+  }
+
+  printf("stress_pthread: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
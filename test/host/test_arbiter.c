@@ -0,0 +1,213 @@
+/*
+*  Test of the bus arbiter (Si7021_arbiter.c) with competing devices on one simulated bus:
+*  measurement jobs of four sensors behind the multiplexer, two of them on the same sensor,
+*  share the bus with a latency-sensitive device polled every 5 ms at a higher priority.
+*  Runs in virtual time, the transfers and conversions advance the clock. Fails if a job
+*  fails or reads the result of another job, and if a start while the sensor is busy with
+*  a conversion of another master is not retried. Prints the worst lateness of the periodic
+*  device with the arbiter and with blocking Hold Master reads in the same loop.
+*/
+#include "fake_Si7021.h"
+#include "Si7021_arbiter.h"
+#include <stdio.h>
+
+static uint32_t errors = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if(!(cond))                                                         \
+    {                                                                   \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      errors++;                                                         \
+    }                                                                   \
+  } while(0)
+
+#define SENSORS          4
+#define MEASUREMENTS     25            // per job
+#define DEVICE_PERIOD    5             // ms
+#define DEVICE_POLLS     200
+
+typedef struct periodic
+{
+  Si7021_job_t job;
+  uint32_t     polls;
+  uint32_t     max_late;               // ms
+}periodic_t;
+
+static fake_bus_t fake;
+static Si7021_bus_t bus;
+static Si7021_t devs[SENSORS];
+static Si7021_arbiter_t arb;
+
+/* the jobs of the sensors, the last one measures sensor 0 as well */
+static Si7021_measure_job_t jobs[SENSORS + 1];
+static uint32_t counts[SENSORS + 1];
+
+static void setup(void)
+{
+  uint8_t i;
+
+  fake_time_us = 0;
+  fake_bus_init(&fake, SENSORS);
+  bus = (Si7021_bus_t){.transfer = fake_transfer, .select = fake_select, .ctx = &fake,
+                       .now_ms = fake_now_ms, .now_us = fake_now_us,
+                       .channels = FAKE_CHANNELS, .active_channel = SI7021_NO_CHANNEL};
+
+  for(i = 0; i < SENSORS; i++)
+    attach_Si7021(&devs[i], &bus, i);
+}
+
+static void measured(Si7021_job_t* job, int8_t result)
+{
+  Si7021_measure_job_t* mjob = (Si7021_measure_job_t*)job;
+  fake_Si7021_t* sensor = &fake.sensors[mjob->dev->channel];
+  uint32_t* count = (uint32_t*)job->ctx;
+
+  CHECK(result == SI7021_STEP_DONE);
+  CHECK(mjob->code == ((mjob->type == Humidity) ? sensor->rh_code : sensor->temp_code));
+
+  if(++(*count) < MEASUREMENTS)
+    arbiter_submit_Si7021(&arb, job, fake_now_ms());
+}
+
+/* a device on the same bus that needs service every DEVICE_PERIOD ms */
+static int8_t periodic_step(Si7021_job_t* job, uint32_t now)
+{
+  periodic_t* dev = (periodic_t*)job;
+
+  if(now - job->wake > dev->max_late)
+    dev->max_late = now - job->wake;
+
+  if(++dev->polls >= DEVICE_POLLS)
+    return SI7021_STEP_DONE;
+
+  job->wake += DEVICE_PERIOD;
+
+  return SI7021_STEP_WAIT;
+}
+
+/* runs the queue, the clock jumps to the next wake time when no job is ready */
+static void run(void)
+{
+  Si7021_arbiter_stats_t stats;
+  uint32_t now, wake = 0;
+
+  for(;;)
+  {
+    now = fake_now_ms();
+    arbiter_poll_Si7021(&arb, now, &wake);
+
+    /* the depth after the completion callbacks, which submit the jobs again */
+    arbiter_stats_Si7021(&arb, &stats);
+
+    if(stats.depth == 0)
+      break;
+
+    if((int32_t)(wake - now) > 0)
+      fake_time_us = (uint64_t)wake * 1000;
+  }
+}
+
+static uint32_t test_arbiter(void)
+{
+  periodic_t device = {.job = {.step = periodic_step, .priority = 10}};
+  Si7021_arbiter_stats_t stats;
+  uint8_t i;
+
+  setup();
+  arbiter_init_Si7021(&arb, &bus, 10);
+
+  for(i = 0; i <= SENSORS; i++)
+  {
+    measure_job_init_Si7021(&jobs[i], &devs[i % SENSORS],
+                            (i < SENSORS) ? Humidity : Temperature, 0, measured);
+    jobs[i].job.ctx = &counts[i];
+    counts[i] = 0;
+    arbiter_submit_Si7021(&arb, &jobs[i].job, 0);
+  }
+
+  arbiter_submit_Si7021(&arb, &device.job, 0);
+
+  run();
+
+  for(i = 0; i <= SENSORS; i++)
+    CHECK(counts[i] == MEASUREMENTS);
+
+  CHECK(device.polls == DEVICE_POLLS);
+  CHECK(fake.sensors[0].conversions == 2 * MEASUREMENTS);
+
+  arbiter_stats_Si7021(&arb, &stats);
+  CHECK(stats.depth == 0);
+  CHECK(stats.max_depth == SENSORS + 2);
+
+  return device.max_late;
+}
+
+/* the sensor is converting for another master (a second handle), the start is retried */
+static void test_busy(void)
+{
+  Si7021_t other;
+
+  setup();
+  arbiter_init_Si7021(&arb, &bus, 0);
+  attach_Si7021(&other, &bus, 0);
+
+  CHECK(start_measurement_Si7021(&other, Humidity) == 0);
+  CHECK(start_measurement_Si7021(&devs[0], Temperature) == SI7021_NACK);
+
+  measure_job_init_Si7021(&jobs[0], &devs[0], Temperature, 0, measured);
+  jobs[0].job.ctx = &counts[0];
+  counts[0] = MEASUREMENTS - 1;
+  arbiter_submit_Si7021(&arb, &jobs[0].job, fake_now_ms());
+
+  run();
+
+  CHECK(counts[0] == MEASUREMENTS);
+  CHECK(fake.sensors[0].conversions == 2);
+}
+
+/* the same periodic device served between blocking Hold Master reads */
+static uint32_t blocking(void)
+{
+  uint32_t next = 0, polls = 0, max_late = 0;
+  uint32_t now;
+  uint8_t i = 0;
+  float value;
+
+  setup();
+
+  while(polls < DEVICE_POLLS)
+  {
+    now = fake_now_ms();
+
+    if((int32_t)(now - next) >= 0)
+    {
+      if(now - next > max_late)
+        max_late = now - next;
+
+      next += DEVICE_PERIOD;
+      polls++;
+    }
+    else
+      CHECK(r_single_Si7021(&devs[i++ % SENSORS], &value, Humidity) == 0);
+  }
+
+  return max_late;
+}
+
+int main(void)
+{
+  uint32_t late;
+
+  late = test_arbiter();
+  test_busy();
+
+  printf("worst lateness of a %u ms device: %lu ms with the arbiter, %lu ms with blocking reads\n",
+         DEVICE_PERIOD, (unsigned long)late, (unsigned long)blocking());
+
+  CHECK(late <= 1);
+
+  printf("test_arbiter: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+/*
+*  Test of the request coalescing of r_single_Si7021: humidity requests made one after the
+*  other start a conversion each, also without a clock or within one tick of it, requests
+*  waiting for the bus during an RH conversion are merged into it, and the coalesce window
+*  serves temperature requests by Temp_AH only if the bus has a clock.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "fake_Si7021.h"
+#include "Si7021_port_pthread.h"
+#include <stdio.h>
+#include <time.h>
+
+static uint32_t errors = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if(!(cond))                                                         \
+    {                                                                   \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      errors++;                                                         \
+    }                                                                   \
+  } while(0)
+
+static fake_bus_t fake;
+static Si7021_bus_t bus;
+static Si7021_t dev;
+
+static void setup(uint32_t (*now_ms)(void))
+{
+  fake_bus_init(&fake, 1);
+  bus = (Si7021_bus_t){.transfer = fake_transfer, .select = fake_select, .ctx = &fake,
+                       .now_ms = now_ms, .channels = FAKE_CHANNELS,
+                       .active_channel = SI7021_NO_CHANNEL};
+  attach_Si7021(&dev, &bus, 0);
+}
+
+/* a clock that does not advance, as a coarse tick between two requests */
+static uint32_t still_ms(void)
+{
+  return 1000;
+}
+
+static void test_sequential(void)
+{
+  float value;
+
+  /* no clock: the bus time is always 0 */
+  setup(NULL);
+  CHECK(r_single_Si7021(&dev, &value, Humidity) == 0);
+  CHECK(r_single_Si7021(&dev, &value, Humidity) == 0);
+  CHECK(fake.sensors[0].conversions == 2);
+
+  /* both requests within the same tick */
+  setup(still_ms);
+  CHECK(r_single_Si7021(&dev, &value, Humidity) == 0);
+  CHECK(r_single_Si7021(&dev, &value, Humidity) == 0);
+  CHECK(fake.sensors[0].conversions == 2);
+}
+
+static void test_window(void)
+{
+  float value;
+
+  /* temperature served by Temp_AH within the window */
+  setup(fake_now_ms);
+  set_coalesce_window_Si7021(&dev, 100);
+  CHECK(r_single_Si7021(&dev, &value, Humidity) == 0);
+  CHECK(r_single_Si7021(&dev, &value, Temperature) == 0);
+  CHECK(fake.sensors[0].conversions == 1);
+  CHECK(fake.sensors[0].command[0] == Temp_AH);
+
+  /* and measured after it */
+  fake_time_us += 200000;
+  CHECK(r_single_Si7021(&dev, &value, Temperature) == 0);
+  CHECK(fake.sensors[0].conversions == 2);
+  CHECK(fake.sensors[0].command[0] == Temp_HM);
+
+  /* the window is not used without a clock */
+  setup(NULL);
+  set_coalesce_window_Si7021(&dev, 100);
+  CHECK(r_single_Si7021(&dev, &value, Humidity) == 0);
+  CHECK(r_single_Si7021(&dev, &value, Temperature) == 0);
+  CHECK(fake.sensors[0].conversions == 2);
+  CHECK(fake.sensors[0].command[0] == Temp_HM);
+}
+
+static void* request(void* arg)
+{
+  float value;
+
+  if(r_single_Si7021(&dev, &value, *(Si7021_measurement_type_t*)arg) < 0)
+    errors++;
+
+  return NULL;
+}
+
+static void test_merge(Si7021_measurement_type_t second)
+{
+  Si7021_measurement_type_t first = Humidity;
+  struct timespec delay = {0, 10 * 1000000L};
+  pthread_mutex_t mutex;
+  pthread_t a, b;
+
+  /* the second request waits for the bus during the 50 ms conversion of the first one */
+  fake_set_real_time(1);
+  setup(NULL);
+  fake.sensors[0].conversion_us = 50000;
+  Si7021_pthread_lock_init(&bus, &mutex);
+
+  pthread_create(&a, NULL, request, &first);
+  nanosleep(&delay, NULL);
+  pthread_create(&b, NULL, request, &second);
+  pthread_join(a, NULL);
+  pthread_join(b, NULL);
+
+  CHECK(fake.sensors[0].conversions == 1);
+  CHECK(fake.sensors[0].command[0] == ((second == Humidity) ? Humi_HM : Temp_AH));
+
+  pthread_mutex_destroy(&mutex);
+  fake_set_real_time(0);
+}
+
+int main(void)
+{
+  test_sequential();
+  test_window();
+  test_merge(Humidity);
+  test_merge(Temperature);
+
+  printf("test_coalesce: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
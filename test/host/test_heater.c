@@ -0,0 +1,196 @@
+/*
+*  Test of the heater profiles (Si7021_heater.c) against a simulated sensor in virtual time:
+*  the heater is switched at the times of the profile with the current of each pulse, the
+*  samples measured meanwhile are flagged heated or cooling, a failed write is retried
+*  without shifting the profile, and a stop disables the heater. Each time the bus lock is
+*  released during a profile, a sample another thread could take must be flagged.
+*/
+#include "fake_Si7021.h"
+#include "Si7021_heater.h"
+#include <stdio.h>
+
+static uint32_t errors = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if(!(cond))                                                         \
+    {                                                                   \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      errors++;                                                         \
+    }                                                                   \
+  } while(0)
+
+#define SAMPLE_PERIOD    10            // ms
+#define LENGTH           3
+
+static const Si7021_heater_pulse_t profile[LENGTH] =
+{
+  {9,  500, 1000},
+  {27, 200, 1500},
+  {51, 100, 3000}
+};
+
+static fake_bus_t fake;
+static Si7021_bus_t bus;
+static Si7021_t dev;
+static Si7021_heater_t heater;
+static uint32_t depth = 0;
+static uint32_t releases = 0;
+static uint8_t heated = 0;             // the heater of the profile was switched on
+static uint32_t untagged = 0;          // releases where a sample would not be flagged
+
+static void lock(void* mutex)
+{
+  (void)mutex;
+
+  depth++;
+}
+
+/* another thread may take the bus now */
+static void unlock(void* mutex)
+{
+  (void)mutex;
+
+  if(--depth != 0)
+    return;
+
+  releases++;
+
+  if(fake.sensors[0].user_register_1 & (1 << HTRE))
+    heated = 1;
+
+  if(heated && heater.pulses < heater.length && !(dev.sample_flags & SI7021_SAMPLE_COOLING) &&
+     !(dev.user_register_1 & (1 << HTRE)))
+    untagged++;
+}
+
+static void setup(void)
+{
+  fake_time_us = 0;
+  fake_bus_init(&fake, 1);
+  fake.transfer_us = 0;
+  fake.sensors[0].conversion_us = 0;
+  bus = (Si7021_bus_t){.transfer = fake_transfer, .select = fake_select, .ctx = &fake,
+                       .now_ms = fake_now_ms, .lock = lock, .unlock = unlock,
+                       .channels = FAKE_CHANNELS, .active_channel = SI7021_NO_CHANNEL};
+  attach_Si7021(&dev, &bus, 0);
+  heater_init_Si7021(&heater, &dev);
+  heated = 0;
+  untagged = 0;
+}
+
+/* flags expected at 'now', the profile started at 0 */
+static uint8_t expected(uint32_t now)
+{
+  uint32_t start = 0;
+  uint8_t i;
+
+  for(i = 0; i < LENGTH; i++)
+  {
+    if(now < start + profile[i].on_time)
+      return SI7021_SAMPLE_HEATED;
+    if(now < start + profile[i].on_time + profile[i].cool_time)
+      return SI7021_SAMPLE_COOLING;
+
+    start += profile[i].on_time + profile[i].cool_time;
+  }
+
+  return 0;
+}
+
+/* polls when due and samples every SAMPLE_PERIOD ms until 'end' */
+static void run(uint32_t end, uint8_t check)
+{
+  Si7021_sample_t sample;
+  uint32_t now, wake = fake_now_ms();
+
+  for(now = fake_now_ms(); now < end; now++)
+  {
+    fake_time_us = (uint64_t)now * 1000;
+
+    if((int32_t)(now - wake) >= 0)
+      heater_poll_Si7021(&heater, now, &wake);
+
+    if(now % SAMPLE_PERIOD == 0 && r_sample_Si7021(&dev, &sample) == 0 && check &&
+       sample.flags != expected(now))
+    {
+      printf("sample at %lu ms: flags %u, expected %u\n", (unsigned long)now, sample.flags,
+             expected(now));
+      errors++;
+    }
+  }
+}
+
+static void test_profile(void)
+{
+  uint32_t end = 0;
+  uint8_t i;
+
+  for(i = 0; i < LENGTH; i++)
+    end += profile[i].on_time + profile[i].cool_time;
+
+  setup();
+  CHECK(heater_start_Si7021(&heater, profile, LENGTH, 0) == 0);
+  CHECK(heater_start_Si7021(&heater, profile, LENGTH, 0) == -1);
+
+  /* the current of the last pulse is in the register */
+  run(end - profile[LENGTH - 1].cool_time, 1);
+  CHECK((fake.sensors[0].heater_control_register & 0x0F) ==
+        (dev.heater_control_register & 0x0F));
+  CHECK(heater.pulses == LENGTH - 1);
+
+  run(end + 1000, 1);
+  CHECK(heater.pulses == LENGTH);
+  CHECK(heater_poll_Si7021(&heater, fake_now_ms(), NULL) == 0);
+  CHECK(!(fake.sensors[0].user_register_1 & (1 << HTRE)));
+  CHECK(dev.sample_flags == 0);
+  CHECK(heater.failed == 0);
+
+  CHECK(heated && releases > 0);
+  CHECK(untagged == 0);
+}
+
+/* the sensor does not answer at the end of the first pulse, the rest keeps its times */
+static void test_retry(void)
+{
+  setup();
+  CHECK(heater_start_Si7021(&heater, profile, LENGTH, 0) == 0);
+  run(profile[0].on_time, 1);
+
+  fake.sensors[0].present = 0;
+  run(profile[0].on_time + 5, 0);
+  CHECK(heater.failed > 0);
+  CHECK(fake.sensors[0].user_register_1 & (1 << HTRE));
+
+  /* not flagged cooling while the heater is still on */
+  CHECK(!(dev.sample_flags & SI7021_SAMPLE_COOLING));
+
+  fake.sensors[0].present = 1;
+  run(profile[0].on_time + profile[0].cool_time + profile[1].on_time / 2, 1);
+  CHECK(heater.pulses == 1);
+  CHECK(untagged == 0);
+}
+
+static void test_stop(void)
+{
+  setup();
+  CHECK(heater_start_Si7021(&heater, profile, LENGTH, 0) == 0);
+  run(profile[0].on_time / 2, 1);
+
+  CHECK(heater_stop_Si7021(&heater) == 0);
+  CHECK(!(fake.sensors[0].user_register_1 & (1 << HTRE)));
+  CHECK(dev.sample_flags == 0);
+  CHECK(heater_poll_Si7021(&heater, fake_now_ms(), NULL) == 0);
+  CHECK(heater_stop_Si7021(&heater) == 0);
+}
+
+int main(void)
+{
+  test_profile();
+  test_retry();
+  test_stop();
+
+  printf("test_heater: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,273 @@
+/*
+*  Test of the compressed sample history (Si7021_history.c): traces of different dynamics
+*  are appended and read back by sequence number, every sample must come back with its
+*  codes, timestamp and resolution. Prints the bytes per stored sample of each trace. Also
+*  checks the overwriting of the oldest blocks, and a reader thread streaming the history
+*  while a writer appends, both under the bus lock as the CLI does.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "Si7021_history.h"
+#include "Si7021_port_pthread.h"
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+
+static uint32_t errors = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if(!(cond))                                                         \
+    {                                                                   \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      errors++;                                                         \
+    }                                                                   \
+  } while(0)
+
+#define BLOCKS           1024
+#define SAMPLES          4000
+#define STREAMED         50000
+
+typedef void (*trace_t)(uint32_t i, Si7021_sample_t* sample);
+
+static Si7021_history_block_t blocks[BLOCKS];
+static Si7021_history_t history;
+static Si7021_sample_t input[SAMPLES];
+static uint32_t seed = 1;
+
+static uint32_t noise(uint32_t range)
+{
+  seed = seed * 1103515245u + 12345u;
+
+  return (seed >> 16) % range;
+}
+
+/* codes of a resolution, the bits below it are zero */
+static void set_codes(Si7021_sample_t* sample, double rh, double t, uint8_t humi_zero,
+                      uint8_t temp_zero)
+{
+  sample->humi_code = (uint16_t)((uint16_t)((rh + 6) * 65536 / 125) >> humi_zero << humi_zero);
+  sample->temp_code = (uint16_t)((uint16_t)((t + 46.85) * 65536 / 175.72) >> temp_zero <<
+                                 temp_zero);
+}
+
+/* room climate at H12_T14 every second with jitter: slow drifts and sensor noise */
+static void room(uint32_t i, Si7021_sample_t* sample)
+{
+  sample->timestamp = i * 1000 + noise(3);
+  sample->resolution = H12_T14;
+  set_codes(sample, 45 + 5 * sin(i / 3000.0) + noise(3) * 0.03,
+            21 + 2 * sin(i / 5000.0) + noise(3) * 0.01, 4, 2);
+}
+
+/* fast changes at H8_T12, 100 ms period */
+static void transient(uint32_t i, Si7021_sample_t* sample)
+{
+  sample->timestamp = i * 100;
+  sample->resolution = H8_T12;
+  set_codes(sample, 50 + 40 * sin(i / 50.0), 30 + 20 * sin(i / 70.0), 8, 4);
+}
+
+/* full scale noise at irregular intervals and a resolution change every 100 samples */
+static void random_walk(uint32_t i, Si7021_sample_t* sample)
+{
+  sample->timestamp = i * 500 + noise(400);
+  sample->resolution = ((i / 100) & 1) ? H11_T11 : H12_T14;
+  sample->humi_code = (uint16_t)noise(65536);
+  sample->temp_code = (uint16_t)noise(65536);
+}
+
+static void make(trace_t trace, uint32_t i, Si7021_sample_t* sample)
+{
+  sample->status = 0;
+  sample->start_us = 0;
+  sample->end_us = 0;
+  sample->flags = 0;
+  trace(i, sample);
+}
+
+static void round_trip(const char* name, trace_t trace)
+{
+  Si7021_history_cursor_t cursor;
+  Si7021_sample_t out;
+  uint32_t i, bytes;
+
+  history_init_Si7021(&history, blocks, BLOCKS);
+  seed = 1;
+
+  for(i = 0; i < SAMPLES; i++)
+  {
+    make(trace, i, &input[i]);
+    CHECK(history_append_Si7021(&history, &input[i]) == 0);
+  }
+
+  CHECK(history.first_seq == 0 && history.next_seq == SAMPLES);
+  CHECK(history_seek_Si7021(&history, &cursor, 0) == 0);
+
+  for(i = 0; i < SAMPLES; i++)
+  {
+    if(history_next_Si7021(&history, &cursor, &out) != 0 ||
+       out.humi_code != input[i].humi_code || out.temp_code != input[i].temp_code ||
+       out.timestamp != input[i].timestamp || out.resolution != input[i].resolution)
+    {
+      printf("%s: sample %lu differs\n", name, (unsigned long)i);
+      errors++;
+      break;
+    }
+  }
+
+  CHECK(history_next_Si7021(&history, &cursor, &out) == -1);
+
+  /* a seek into a block decodes from its first sample */
+  CHECK(history_seek_Si7021(&history, &cursor, SAMPLES / 2) == 0);
+  CHECK(history_next_Si7021(&history, &cursor, &out) == 0 &&
+        out.timestamp == input[SAMPLES / 2].timestamp);
+
+  bytes = history.used * sizeof(Si7021_history_block_t);
+  printf("%-12s %5u %8lu %12.2f\n", name, SAMPLES, (unsigned long)bytes, (double)bytes / SAMPLES);
+}
+
+static void test_overwrite(void)
+{
+  Si7021_history_cursor_t cursor;
+  Si7021_sample_t sample;
+  uint32_t i;
+
+  history_init_Si7021(&history, blocks, 4);
+  seed = 1;
+
+  for(i = 0; i < SAMPLES; i++)
+  {
+    make(random_walk, i, &sample);
+    history_append_Si7021(&history, &sample);
+
+    if(i == 10)
+      CHECK(history_seek_Si7021(&history, &cursor, 0) == 0);
+  }
+
+  CHECK(history.used == 4);
+  CHECK(history.first_seq > 0 && history.next_seq == SAMPLES);
+
+  /* the cursor points to an overwritten block */
+  CHECK(history_next_Si7021(&history, &cursor, &sample) == -1);
+
+  /* a seek before the oldest sample starts at it */
+  CHECK(history_seek_Si7021(&history, &cursor, 0) == 0);
+  CHECK(cursor.seq == history.first_seq);
+  CHECK(history_seek_Si7021(&history, &cursor, SAMPLES) == -1);
+}
+
+static Si7021_bus_t bus;
+static uint32_t written = 0;
+
+/* a sample that tells its sequence number */
+static void numbered(uint32_t i, Si7021_sample_t* sample)
+{
+  sample->timestamp = i * 10;
+  sample->resolution = H12_T14;
+  sample->humi_code = (uint16_t)(i << 4);
+  sample->temp_code = (uint16_t)((i >> 12) << 2);
+}
+
+static void* write_history(void* arg)
+{
+  Si7021_sample_t sample;
+  uint32_t i;
+
+  (void)arg;
+
+  for(i = 0; i < STREAMED; i++)
+  {
+    make(numbered, i, &sample);
+
+    lock_bus_Si7021(&bus);
+    history_append_Si7021(&history, &sample);
+    unlock_bus_Si7021(&bus);
+
+    /* an acquisition task waits for its next sample */
+    sched_yield();
+  }
+
+  __atomic_store_n(&written, 1, __ATOMIC_RELEASE);
+
+  return NULL;
+}
+
+/* streams the history as the 'y' command, one sample per lock */
+static void test_stream(void)
+{
+  Si7021_history_cursor_t cursor;
+  Si7021_sample_t in, out;
+  pthread_mutex_t mutex;
+  pthread_t writer;
+  struct timespec flush = {0, 2000000L};
+  uint32_t reads = 0, seeks = 0;
+  uint8_t started = 0;
+  int8_t rv;
+
+  history_init_Si7021(&history, blocks, 8);
+  bus = (Si7021_bus_t){0};
+  Si7021_pthread_lock_init(&bus, &mutex);
+  pthread_create(&writer, NULL, write_history, NULL);
+
+  /* until the last sample is read */
+  while(!__atomic_load_n(&written, __ATOMIC_ACQUIRE) || cursor.seq != STREAMED)
+  {
+    lock_bus_Si7021(&bus);
+
+    /* the next sample was overwritten before it was read, continue at the oldest one */
+    if(started && cursor.seq < history.first_seq)
+    {
+      history_seek_Si7021(&history, &cursor, 0);
+      seeks++;
+    }
+    else if(!started && history_seek_Si7021(&history, &cursor, 0) == 0)
+      started = 1;
+
+    /* fails until the writer appends the next sample */
+    rv = started ? history_next_Si7021(&history, &cursor, &out) : -1;
+
+    unlock_bus_Si7021(&bus);
+
+    if(rv < 0)
+    {
+      sched_yield();
+      continue;
+    }
+
+    make(numbered, cursor.seq - 1, &in);
+
+    if(out.humi_code != in.humi_code || out.temp_code != in.temp_code ||
+       out.timestamp != in.timestamp)
+      errors++;
+
+    /* a chunk of the output is sent, the writer goes on */
+    if(++reads % 1000 == 0)
+      nanosleep(&flush, NULL);
+  }
+
+  pthread_join(writer, NULL);
+  pthread_mutex_destroy(&mutex);
+
+  CHECK(reads > 0);
+  printf("streamed %lu samples while appending, overtaken by the writer %lu times\n",
+         (unsigned long)reads, (unsigned long)seeks);
+}
+
+int main(void)
+{
+  printf("trace        samples   bytes bytes/sample\n");
+  round_trip("room", room);
+  round_trip("transient", transient);
+  round_trip("random", random_walk);
+  printf("(a sample is %u bytes, two floats and a timestamp 12 bytes)\n",
+         (unsigned)sizeof(Si7021_sample_t));
+
+  test_overwrite();
+  test_stream();
+
+  printf("test_history: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,186 @@
+/*
+*  Test of the latest sample snapshot (latest_Si7021, r_latest_Si7021): a writer thread
+*  publishes samples as fast as it can while reader threads copy the snapshot. Every
+*  published sample has matching codes and timestamp, so a reader that sees fields of two
+*  samples (a torn read) fails the test. Prints how many plain copies of the snapshot,
+*  without the sequence check, are torn in the same run. Also checks that r_latest_Si7021
+*  serves a sample within its maximum age only if the bus has a clock.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "fake_Si7021.h"
+#include "Si7021_port_pthread.h"
+#include <stdio.h>
+
+static uint32_t errors = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if(!(cond))                                                         \
+    {                                                                   \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      errors++;                                                         \
+    }                                                                   \
+  } while(0)
+
+#define READERS          3
+#define PUBLISHES        300000
+
+typedef struct reader
+{
+  pthread_t thread;
+  uint8_t   plain;                     // copy without the sequence check
+  uint32_t  reads;
+  uint32_t  torn;
+}reader_t;
+
+static fake_bus_t fake;
+static Si7021_bus_t bus;
+static Si7021_t dev;
+static uint32_t done = 0;
+
+static void setup(uint32_t (*now_ms)(void))
+{
+  fake_time_us = 0;
+  fake_bus_init(&fake, 1);
+  fake.transfer_us = 0;
+  fake.sensors[0].conversion_us = 0;
+  bus = (Si7021_bus_t){.transfer = fake_transfer, .select = fake_select, .ctx = &fake,
+                       .now_ms = now_ms, .channels = FAKE_CHANNELS,
+                       .active_channel = SI7021_NO_CHANNEL};
+  attach_Si7021(&dev, &bus, 0);
+}
+
+/* the codes and the timestamp of the i-th sample, each field tells the sample it belongs to */
+static uint16_t rh_code(uint32_t i)
+{
+  return (uint16_t)((i & 0x3FFF) << 2);
+}
+
+static uint8_t consistent(const Si7021_sample_t* sample)
+{
+  return sample->temp_code == (uint16_t)(sample->humi_code ^ 0xFFFC) &&
+         rh_code(sample->timestamp) == sample->humi_code &&
+         sample->end_us == sample->timestamp * 1000;
+}
+
+static void* write_samples(void* arg)
+{
+  Si7021_sample_t sample;
+  uint32_t i;
+
+  (void)arg;
+
+  for(i = 1; i <= PUBLISHES; i++)
+  {
+    /* the writer is the only user of the fake bus and its clock */
+    fake_time_us = (uint64_t)i * 1000;
+    fake.sensors[0].rh_code = rh_code(i);
+    fake.sensors[0].temp_code = rh_code(i) ^ 0xFFFC;
+
+    if(r_sample_Si7021(&dev, &sample) != 0)
+      errors++;
+  }
+
+  __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+
+  return NULL;
+}
+
+static void* read_samples(void* arg)
+{
+  reader_t* r = (reader_t*)arg;
+  volatile Si7021_sample_t* snapshot = &dev.snapshot;
+  Si7021_sample_t sample;
+
+  while(!__atomic_load_n(&done, __ATOMIC_ACQUIRE))
+  {
+    if(r->plain)
+    {
+      sample.humi_code = snapshot->humi_code;
+      sample.temp_code = snapshot->temp_code;
+      sample.timestamp = snapshot->timestamp;
+      sample.end_us = snapshot->end_us;
+    }
+    else if(latest_Si7021(&dev, &sample) != 0)
+      continue;
+
+    if(sample.timestamp == 0)
+      continue;
+
+    r->reads++;
+
+    if(!consistent(&sample))
+      r->torn++;
+  }
+
+  return NULL;
+}
+
+static void test_torn(void)
+{
+  reader_t readers[READERS + 1] = {{0}};
+  pthread_mutex_t mutex;
+  pthread_t writer;
+  uint8_t i;
+
+  setup(fake_now_ms);
+  bus.now_us = fake_now_us;
+  Si7021_pthread_lock_init(&bus, &mutex);
+
+  readers[READERS].plain = 1;
+
+  for(i = 0; i <= READERS; i++)
+    pthread_create(&readers[i].thread, NULL, read_samples, &readers[i]);
+
+  pthread_create(&writer, NULL, write_samples, NULL);
+  pthread_join(writer, NULL);
+
+  for(i = 0; i <= READERS; i++)
+    pthread_join(readers[i].thread, NULL);
+
+  for(i = 0; i < READERS; i++)
+  {
+    CHECK(readers[i].reads > 0);
+    CHECK(readers[i].torn == 0);
+  }
+
+  CHECK((dev.snapshot_seq & 1) == 0);
+
+  printf("%u readers, %u publishes: %lu reads, 0 torn; %lu plain copies, %lu torn\n",
+         READERS, PUBLISHES, (unsigned long)(readers[0].reads + readers[1].reads +
+         readers[2].reads), (unsigned long)readers[READERS].reads,
+         (unsigned long)readers[READERS].torn);
+
+  pthread_mutex_destroy(&mutex);
+}
+
+static void test_max_age(void)
+{
+  Si7021_sample_t sample;
+
+  /* served from the snapshot within the maximum age, measured after it */
+  setup(fake_now_ms);
+  CHECK(r_latest_Si7021(&dev, 100, &sample) == 0);
+  CHECK(r_latest_Si7021(&dev, 100, &sample) == 0);
+  CHECK(fake.sensors[0].conversions == 1);
+  fake_time_us += 200000;
+  CHECK(r_latest_Si7021(&dev, 100, &sample) == 0);
+  CHECK(fake.sensors[0].conversions == 2);
+
+  /* without a clock the age is unknown, each call measures */
+  setup(NULL);
+  CHECK(r_latest_Si7021(&dev, 100, &sample) == 0);
+  CHECK(r_latest_Si7021(&dev, 100, &sample) == 0);
+  CHECK(fake.sensors[0].conversions == 2);
+}
+
+int main(void)
+{
+  test_max_age();
+  test_torn();
+
+  printf("test_latest: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,210 @@
+/*
+*  Test of the low power acquisition (Si7021_power.c) against a simulated sensor in virtual
+*  time: lowpower_sample_Si7021 sleeps for the conversion, polls a late sensor and gives up
+*  on a dead one, and a Hold Master measurement aborts a started No Hold Master conversion.
+*  Also simulates the timeline of the MCU, the bus and the sensor over a sampling period and
+*  compares the charge with energy_estimate_Si7021, in Sleep mode (the default model) and in
+*  Stop mode. Prints the charge per sample and the average current of each configuration.
+*/
+#include "fake_Si7021.h"
+#include "Si7021_power.h"
+#include <stdio.h>
+
+static uint32_t errors = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if(!(cond))                                                         \
+    {                                                                   \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      errors++;                                                         \
+    }                                                                   \
+  } while(0)
+
+#define PERIOD           1000          // ms
+#define SAMPLES          100
+#define TRANSFER_US      465           // half of the bus time of a sample at 100 kHz
+#define TOLERANCE        10            // % between the simulation and the estimate
+
+/* time spent in each state */
+typedef struct timeline
+{
+  uint64_t sleep_us;                   // MCU sleeping, running otherwise
+  uint64_t bus_us;                     // a bus line low: transfers and clock stretching
+}timeline_t;
+
+static fake_bus_t fake;
+static Si7021_bus_t bus;
+static Si7021_t dev;
+static timeline_t timeline;
+
+static int8_t timed_transfer(void* ctx, uint16_t addr, Si7021_msg_t* msgs, uint8_t count)
+{
+  uint64_t start = fake_time_us;
+  int8_t rv = fake_transfer(ctx, addr, msgs, count);
+
+  timeline.bus_us += fake_time_us - start;
+
+  return rv;
+}
+
+static void virtual_sleep(void* ctx, uint32_t ms)
+{
+  (void)ctx;
+
+  fake_time_us += (uint64_t)ms * 1000;
+  timeline.sleep_us += (uint64_t)ms * 1000;
+}
+
+static void setup(Si7021_resolution_t resolution)
+{
+  fake_time_us = 0;
+  fake_bus_init(&fake, 1);
+  fake.transfer_us = TRANSFER_US;
+  bus = (Si7021_bus_t){.transfer = timed_transfer, .select = fake_select, .ctx = &fake,
+                       .now_ms = fake_now_ms, .now_us = fake_now_us,
+                       .delay_ms = fake_delay_ms, .channels = FAKE_CHANNELS,
+                       .active_channel = SI7021_NO_CHANNEL};
+  attach_Si7021(&dev, &bus, 0);
+  set_resolution_Si7021(&dev, resolution);
+
+  /* the conversion of the datasheet, RH and temperature */
+  fake.sensors[0].conversion_us = conversion_time_Si7021(&dev, Humidity);
+  timeline = (timeline_t){0, 0};
+}
+
+static void test_lowpower(void)
+{
+  Si7021_lowpower_t lp;
+  Si7021_sample_t sample;
+
+  setup(H12_T14);
+  lowpower_init_Si7021(&lp, &dev, virtual_sleep, NULL);
+
+  /* the sleep is rounded up to ms, the conversion is done when the MCU wakes up */
+  CHECK(lowpower_sample_Si7021(&lp, &sample) == 0);
+  CHECK(sample.humi_code == fake.sensors[0].rh_code &&
+        sample.temp_code == fake.sensors[0].temp_code);
+  CHECK(lp.samples == 1 && lp.polls == 0);
+  CHECK(lp.slept == (conversion_time_Si7021(&dev, Humidity) + 999) / 1000);
+  CHECK(fake.sensors[0].conversions == 1);
+
+  /* a slow sensor is polled every ms */
+  fake.sensors[0].conversion_us += 2500;
+  CHECK(lowpower_sample_Si7021(&lp, &sample) == 0);
+  CHECK(lp.samples == 2 && lp.polls > 0);
+
+  /* a conversion that does not finish */
+  fake.sensors[0].conversion_us = 1000000;
+  CHECK(lowpower_sample_Si7021(&lp, &sample) == -1);
+  CHECK(lp.samples == 2);
+}
+
+/*
+*  A Hold Master measurement after a No Hold Master conversion that was not fetched replaces
+*  it, there is nothing to fetch. The sensor does not acknowledge during the conversion.
+*/
+static void test_abort(void)
+{
+  Si7021_sample_t sample;
+  float value;
+
+  setup(H12_T14);
+  CHECK(start_measurement_Si7021(&dev, Humidity) == 0);
+  CHECK(r_single_Si7021(&dev, &value, Temperature) == -1);
+  fake_time_us += 100000;
+  CHECK(r_single_Si7021(&dev, &value, Temperature) == 0);
+  CHECK(fetch_sample_Si7021(&dev, &sample) == -1);
+
+  CHECK(start_measurement_Si7021(&dev, Humidity) == 0);
+  fake_time_us += 100000;
+  CHECK(r_single_Si7021(&dev, &value, Humidity) == 0);
+  CHECK(fetch_sample_Si7021(&dev, &sample) == -1);
+}
+
+/* charge in nC of the timeline of 'samples' periods */
+static uint64_t charge(const Si7021_energy_model_t* model, uint32_t samples)
+{
+  uint64_t total = (uint64_t)samples * PERIOD * 1000;
+  uint64_t conversion = (uint64_t)samples * conversion_time_Si7021(&dev, Humidity);
+  uint64_t temp = (uint64_t)samples * conversion_time_Si7021(&dev, Temperature);
+  uint64_t pc;
+
+  pc = (uint64_t)model->run_current * (total - timeline.sleep_us) +
+       (uint64_t)model->sleep_current * timeline.sleep_us +
+       (uint64_t)model->pullup_current * timeline.bus_us +
+       (uint64_t)model->rh_current * (conversion - temp) +
+       (uint64_t)model->temp_current * temp +
+       model->standby_current * (total - conversion) / 1000;
+
+  return pc / 1000;
+}
+
+static void simulate(const char* name, const Si7021_energy_model_t* model,
+                     Si7021_acquisition_t mode, Si7021_resolution_t resolution)
+{
+  static const char* modes[] = {"Hold Master", "sleep"};
+  Si7021_lowpower_t lp;
+  Si7021_sample_t sample;
+  Si7021_energy_t energy;
+  uint64_t simulated, end;
+  uint32_t i;
+
+  setup(resolution);
+  lowpower_init_Si7021(&lp, &dev, virtual_sleep, NULL);
+
+  for(i = 0; i < SAMPLES; i++)
+  {
+    if(mode == Acquire_Sleep)
+      CHECK(lowpower_sample_Si7021(&lp, &sample) == 0);
+    else
+      CHECK(r_sample_Si7021(&dev, &sample) == 0);
+
+    /* the rest of the period in sleep */
+    end = (uint64_t)(i + 1) * PERIOD * 1000;
+    timeline.sleep_us += end - fake_time_us;
+    fake_time_us = end;
+  }
+
+  simulated = charge(model, SAMPLES) / SAMPLES;
+  energy_estimate_Si7021(model, &dev, mode, PERIOD, &energy);
+
+  printf("%-6s %-12s %-8s %10.2f %10.2f %12.1f\n", name, modes[mode],
+         (resolution == H12_T14) ? "H12_T14" : "H8_T12", simulated / 1000.0,
+         energy.total / 1000.0, simulated / (double)PERIOD);
+
+  CHECK(simulated * 100 <= (uint64_t)energy.total * (100 + TOLERANCE) &&
+        simulated * 100 >= (uint64_t)energy.total * (100 - TOLERANCE));
+}
+
+int main(void)
+{
+  Si7021_energy_model_t model = SI7021_ENERGY_MODEL_DEFAULT;
+  Si7021_energy_t hold, lowpower;
+
+  test_lowpower();
+  test_abort();
+
+  printf("sample every %u ms    mode         res.    simulated  estimate  average uA\n"
+         "                                           uC/sample  uC/sample\n", PERIOD);
+  simulate("Sleep", &model, Acquire_Hold_Master, H12_T14);
+  simulate("Sleep", &model, Acquire_Sleep, H12_T14);
+  simulate("Sleep", &model, Acquire_Sleep, H8_T12);
+
+  /* the default model is the WFI Sleep mode of Si7021_stm32_sleep, a sample during the
+     period is cheaper without the clock stretching */
+  setup(H12_T14);
+  energy_estimate_Si7021(&model, &dev, Acquire_Hold_Master, 0, &hold);
+  energy_estimate_Si7021(&model, &dev, Acquire_Sleep, 0, &lowpower);
+  CHECK(lowpower.total < hold.total);
+  CHECK(lowpower.mcu * 3 > lowpower.total);
+
+  model.sleep_current = 5;
+  simulate("Stop", &model, Acquire_Hold_Master, H12_T14);
+  simulate("Stop", &model, Acquire_Sleep, H12_T14);
+  simulate("Stop", &model, Acquire_Sleep, H8_T12);
+
+  printf("test_power: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
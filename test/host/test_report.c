@@ -0,0 +1,203 @@
+/*
+*  Test of the change reporting (Si7021_report.c) against a simulated sensor in virtual
+*  time: the measurement schedule does not drift when the polls are late, a stable reading
+*  backs off to the maximum period and is reported at the heartbeat, a change restores the
+*  base period, and a failed measurement is retried after the base period. Also checks the
+*  counters read by another thread under the bus lock while the reporter is polled.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "fake_Si7021.h"
+#include "Si7021_report.h"
+#include "Si7021_port_pthread.h"
+#include <stdio.h>
+
+static uint32_t errors = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if(!(cond))                                                         \
+    {                                                                   \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      errors++;                                                         \
+    }                                                                   \
+  } while(0)
+
+#define PERIOD           1000          // ms
+#define POLLS            1000
+#define MAX_LATE         7             // ms, lateness of a poll
+
+static fake_bus_t fake;
+static Si7021_bus_t bus;
+static Si7021_t dev;
+static Si7021_reporter_t rep;
+static uint32_t reports = 0;
+static uint32_t seed = 1;
+
+static void setup(void)
+{
+  fake_time_us = 0;
+  fake_bus_init(&fake, 1);
+  fake.transfer_us = 0;
+  fake.sensors[0].conversion_us = 0;
+  bus = (Si7021_bus_t){.transfer = fake_transfer, .select = fake_select, .ctx = &fake,
+                       .now_ms = fake_now_ms, .channels = FAKE_CHANNELS,
+                       .active_channel = SI7021_NO_CHANNEL};
+  attach_Si7021(&dev, &bus, 0);
+  report_init_Si7021(&rep, &dev, PERIOD, NULL, NULL);
+}
+
+static uint32_t lateness(void)
+{
+  seed = seed * 1103515245u + 12345u;
+
+  return (seed >> 16) % (MAX_LATE + 1);
+}
+
+/* polls at each wake time, late by up to MAX_LATE ms, until 'end' */
+static void run(uint32_t end, void (*at_poll)(uint32_t now))
+{
+  uint32_t now = fake_now_ms();
+  uint32_t wake = now;
+
+  while((int32_t)(end - now) > 0)
+  {
+    if(at_poll != NULL)
+      at_poll(now);
+
+    report_poll_Si7021(&rep, now, &wake);
+    now = wake + lateness();
+    fake_time_us = (uint64_t)now * 1000;
+  }
+}
+
+/* every sample differs, so every measurement is reported */
+static void change(uint32_t now)
+{
+  fake.sensors[0].rh_code = (uint16_t)(0x4000 + (now & 0xFFF) * 4);
+}
+
+static void test_drift(void)
+{
+  uint32_t now;
+
+  setup();
+  run(POLLS * PERIOD, change);
+
+  /* late polls, but one measurement per period */
+  CHECK(rep.measured == POLLS);
+  CHECK(rep.reported == POLLS);
+  CHECK(rep.next == POLLS * PERIOD);
+
+  /* a poll late by more than a period skips the missed measurements */
+  now = fake_now_ms() + 3500;
+  fake_time_us = (uint64_t)now * 1000;
+  change(now);
+  CHECK(report_poll_Si7021(&rep, now, NULL) == 1);
+  CHECK(rep.measured == POLLS + 1);
+  CHECK(rep.next == now + PERIOD);
+}
+
+static void test_backoff(void)
+{
+  uint32_t start;
+
+  setup();
+  report_set_deadband_Si7021(&rep, 50, 10, 60000);
+  report_set_backoff_Si7021(&rep, 16 * PERIOD);
+
+  /* stable: reported once, then measured at 2, 4, 8, 16, 16 .. s */
+  run(60000, NULL);
+  CHECK(rep.reported == 1);
+  CHECK(rep.period == 16 * PERIOD);
+  CHECK(rep.measured == 1 + 4 + (60000 - 31000 + 16 * PERIOD - 1) / (16 * PERIOD));
+
+  /* the heartbeat reports the stable reading */
+  run(61000, NULL);
+  CHECK(rep.reported == 2);
+
+  /* a change beyond the deadband restores the base period */
+  fake.sensors[0].rh_code += 0x200;
+  start = rep.next;
+  run(start + MAX_LATE + 1, NULL);
+  CHECK(rep.reported == 3);
+  CHECK(rep.period == PERIOD);
+  CHECK(rep.next == start + PERIOD);
+}
+
+static void test_failure(void)
+{
+  setup();
+  report_set_backoff_Si7021(&rep, 16 * PERIOD);
+  fake.sensors[0].present = 0;
+
+  run(5 * PERIOD, NULL);
+  CHECK(rep.failed == 5);
+  CHECK(rep.measured == 0);
+
+  fake.sensors[0].present = 1;
+  run(6 * PERIOD, NULL);
+  CHECK(rep.measured == 1 && rep.reported == 1);
+}
+
+static uint32_t polled = 0;
+
+static void* read_counters(void* arg)
+{
+  (void)arg;
+
+  do
+  {
+    lock_bus_Si7021(&bus);
+
+    /* every measurement is counted as reported or suppressed */
+    if(rep.measured != rep.reported + rep.suppressed)
+      errors++;
+
+    unlock_bus_Si7021(&bus);
+  }
+  while(!__atomic_load_n(&polled, __ATOMIC_ACQUIRE));
+
+  return NULL;
+}
+
+static void count_report(void* ctx, const Si7021_sample_t* sample)
+{
+  (void)ctx;
+  (void)sample;
+
+  reports++;
+}
+
+static void test_concurrent(void)
+{
+  pthread_mutex_t mutex;
+  pthread_t reader;
+
+  setup();
+  report_init_Si7021(&rep, &dev, PERIOD, count_report, NULL);
+  report_set_deadband_Si7021(&rep, 50, 10, 0);
+  Si7021_pthread_lock_init(&bus, &mutex);
+
+  pthread_create(&reader, NULL, read_counters, NULL);
+  run(20000 * PERIOD, change);
+  __atomic_store_n(&polled, 1, __ATOMIC_RELEASE);
+  pthread_join(reader, NULL);
+
+  CHECK(rep.measured == 20000);
+  CHECK(reports == rep.reported);
+
+  pthread_mutex_destroy(&mutex);
+}
+
+int main(void)
+{
+  test_drift();
+  test_backoff();
+  test_failure();
+  test_concurrent();
+
+  printf("test_report: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+/*
+*  Test of the microsecond clock of the STM32 port (Si7021_stm32_now_us) against a simulated
+*  Cortex-M core at 168 MHz with a 1 ms HAL tick: every register access takes some cycles
+*  and the tick interrupt is served between them, unless masked. Each result must lie
+*  between the time of the call and of its return, and never go back: with calls every few
+*  cycles across the ticks, after idle periods longer than a wrap of the 32 bit cycle
+*  counter, with the tick interrupt masked, and across the wrap of HAL_GetTick() * 1000.
+*  Prints the jitter of timestamps taken every ms, measured by Si7021_jitter.c.
+*/
+#include "stm32f4xx_hal.h"
+#include "Si7021_port_stm32.h"
+#include "Si7021_jitter.h"
+#include <stdio.h>
+
+static uint32_t errors = 0;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if(!(cond))                                                         \
+    {                                                                   \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      errors++;                                                         \
+    }                                                                   \
+  } while(0)
+
+#define CLOCK_MHZ        168
+#define RELOAD           (CLOCK_MHZ * 1000 - 1)  // SysTick reload of a 1 ms tick
+#define ACCESS_CYCLES    40            // maximum cycles of a register access
+#define CALLS            1000000
+
+uint32_t SystemCoreClock = CLOCK_MHZ * 1000000;
+
+static uint64_t cycles = 0;            // CPU time
+static uint64_t served = 0;            // tick interrupts served
+static uint32_t tick_offset = 0;       // HAL tick at cycle 0
+static uint8_t masked = 0;             // the tick interrupt is held off
+static uint32_t seed = 1;
+static SysTick_Type systick;
+static SCB_Type scb;
+
+static uint32_t noise(uint32_t range)
+{
+  seed = seed * 1103515245u + 12345u;
+
+  return (seed >> 16) % range;
+}
+
+/* a register access, the pending tick interrupt is served after it */
+static void access(void)
+{
+  cycles += 1 + noise(ACCESS_CYCLES);
+
+  if(!masked)
+    served = cycles / (RELOAD + 1);
+}
+
+SysTick_Type* fake_systick(void)
+{
+  access();
+  systick.LOAD = RELOAD;
+  systick.VAL = RELOAD - (uint32_t)(cycles % (RELOAD + 1));
+
+  return &systick;
+}
+
+SCB_Type* fake_scb(void)
+{
+  access();
+  scb.ICSR = (cycles / (RELOAD + 1) > served) ? SCB_ICSR_PENDSTSET_Msk : 0;
+
+  return &scb;
+}
+
+uint32_t HAL_GetTick(void)
+{
+  access();
+
+  return tick_offset + (uint32_t)served;
+}
+
+uint32_t HAL_GetTickFreq(void)
+{
+  return 1;
+}
+
+/* not used by the clock */
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t mem_addr,
+                                   uint16_t mem_size, uint8_t* data, uint16_t size,
+                                   uint32_t timeout)
+{
+  (void)hi2c; (void)addr; (void)mem_addr; (void)mem_size; (void)data; (void)size; (void)timeout;
+
+  return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef* hi2c, uint16_t addr, uint8_t* data,
+                                          uint16_t size, uint32_t timeout)
+{
+  (void)hi2c; (void)addr; (void)data; (void)size; (void)timeout;
+
+  return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef* hi2c, uint16_t addr, uint8_t* data,
+                                         uint16_t size, uint32_t timeout)
+{
+  (void)hi2c; (void)addr; (void)data; (void)size; (void)timeout;
+
+  return HAL_ERROR;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef* hi2c)
+{
+  (void)hi2c;
+
+  return 0;
+}
+
+void HAL_PWR_EnterSLEEPMode(uint32_t regulator, uint8_t entry)
+{
+  (void)regulator;
+  (void)entry;
+}
+
+void HAL_Delay(uint32_t ms)
+{
+  (void)ms;
+}
+
+/* exact time in us at 'at', as the clock counts it */
+static uint32_t exact_us(uint64_t at)
+{
+  return tick_offset * 1000 + (uint32_t)(at / CLOCK_MHZ);
+}
+
+static uint32_t last = 0;
+static uint8_t has_last = 0;
+
+/* a call of the clock, its result shall be within the call and not before the last one */
+static uint32_t call(void)
+{
+  uint64_t start = cycles;
+  uint32_t us = Si7021_stm32_now_us();
+  uint32_t from = exact_us(start);
+
+  if((uint32_t)(us - from) > (uint32_t)(exact_us(cycles) - from) ||
+     (has_last && (int32_t)(us - last) < 0))
+  {
+    if(errors++ < 10)
+      printf("%lu us at %llu cycles\n", (unsigned long)us, (unsigned long long)start);
+  }
+
+  last = us;
+  has_last = 1;
+
+  return us;
+}
+
+static void reset(uint32_t offset)
+{
+  cycles = 0;
+  served = 0;
+  tick_offset = offset;
+  masked = 0;
+  has_last = 0;
+}
+
+/* back to back calls and short gaps across many ticks */
+static void test_frequent(void)
+{
+  uint32_t i;
+
+  reset(0);
+
+  for(i = 0; i < CALLS; i++)
+  {
+    call();
+    cycles += noise(3000);
+  }
+}
+
+/* idle for a minute between the calls, longer than a wrap of the cycle counter at 168 MHz */
+static void test_idle(void)
+{
+  uint32_t i;
+
+  reset(0);
+
+  for(i = 0; i < 100; i++)
+  {
+    call();
+    cycles += 60ULL * SystemCoreClock + noise(RELOAD);
+    served = cycles / (RELOAD + 1);
+  }
+}
+
+/* called with the tick interrupt masked around the tick, e.g. under a critical section */
+static void test_masked(void)
+{
+  uint32_t i;
+
+  reset(0);
+
+  for(i = 1; i < 10000; i++)
+  {
+    cycles = (uint64_t)i * (RELOAD + 1) - noise(2000);
+    served = cycles / (RELOAD + 1);
+    masked = 1;
+    call();
+    cycles += noise(4000);
+    call();
+    masked = 0;
+    call();
+  }
+}
+
+/* HAL_GetTick() * 1000 wraps at 2^32 us, 71.6 minutes */
+static void test_wrap(void)
+{
+  uint32_t i;
+
+  reset(0xFFFFFFFFu / 1000 - 10);
+
+  for(i = 0; i < 100000; i++)
+  {
+    call();
+    cycles += noise(1000);
+  }
+
+  CHECK(last < 1000000);
+}
+
+/* timestamps of samples due every ms, taken a few cycles late */
+static void test_jitter(void)
+{
+  Si7021_jitter_t jit;
+  Si7021_sample_t sample = {0};
+  uint32_t i;
+
+  reset(12345);
+  jitter_init_Si7021(&jit, 1000, 1);
+
+  for(i = 0; i < 100000; i++)
+  {
+    cycles = (uint64_t)i * CLOCK_MHZ * 1000 + noise(100);
+    served = cycles / (RELOAD + 1);
+    sample.start_us = call();
+    sample.end_us = sample.start_us;
+    jitter_add_Si7021(&jit, &sample);
+  }
+
+  printf("timestamps every 1000 us: min %ld us, max %+ld us, %lu periods\n",
+         (long)jit.min_dev, (long)jit.max_dev, (unsigned long)jit.count);
+  CHECK(jitter_max_Si7021(&jit) <= 1);
+}
+
+int main(void)
+{
+  test_frequent();
+  test_idle();
+  test_masked();
+  test_wrap();
+  test_jitter();
+
+  printf("test_stm32_time: %s\n", errors ? "FAILED" : "OK");
+
+  return errors ? 1 : 0;
+}